@@ -1,6 +1,8 @@
 #include "pch.h"
 #include "AtexDecompress.h"
 #include "AtexAsm.h"
+#include "TaskPool.h"
+#include <bit>
 
 int ImgFmt(unsigned int Format)
 {
@@ -12,7 +14,85 @@ int ImgFmt(unsigned int Format)
     return ImageFormats[Format];
 }
 
-void AtexDecompress(unsigned int* InputBuffer, unsigned int BufferSize, unsigned int ImageFormat, const SImageDescriptor& ImageDescriptor, unsigned int* OutBuffer)
+// The bit-packed passes (AtexSubCode2-5) share one bit cursor and each depends on the blocks the
+// previous ones claimed, so they have to run in order. The raw copy that follows them reads its
+// words in block order, but where each block's words are is just the number of unclaimed blocks
+// before it, so large images split that copy over the TaskPool.
+namespace
+{
+    constexpr int ParallelCopyBlockCount = 16384; // 512x512 and larger
+    constexpr int CopyChunkBlocks = 4096;         // Multiple of 32 so chunks start on a mask word
+
+    inline bool IsRawBlock(const unsigned int* Mask, int x)
+    {
+        return !(Mask[x >> 5] & 1u << (x & 31));
+    }
+
+    int CountRawBlocks(const unsigned int* Mask, int First, int Last)
+    {
+        int Count = 0;
+        int x = First;
+        for (; x < Last && (x & 31); x++)
+            Count += IsRawBlock(Mask, x);
+        for (; x + 32 <= Last; x += 32)
+            Count += 32 - std::popcount(Mask[x >> 5]);
+        for (; x < Last; x++)
+            Count += IsRawBlock(Mask, x);
+        return Count;
+    }
+
+    // One of the raw copies: WordsPerBlock words from the input for each block not set in Mask,
+    // written at OutOffset in the block
+    struct RawCopy
+    {
+        const unsigned int* Mask;
+        int OutOffset;
+        int WordsPerBlock;
+    };
+
+    const unsigned int* CopyRawBlocks(unsigned int* OutBuffer, int BlockSize, const RawCopy& Copy, int First,
+                                      int Last, const unsigned int* Source)
+    {
+        unsigned int* BufferVar = OutBuffer + (size_t)First * BlockSize + Copy.OutOffset;
+        for (int x = First; x < Last; x++)
+        {
+            if (IsRawBlock(Copy.Mask, x))
+            {
+                BufferVar[0] = Source[0];
+                if (Copy.WordsPerBlock == 2)
+                    BufferVar[1] = Source[1];
+                Source += Copy.WordsPerBlock;
+            }
+            BufferVar += BlockSize;
+        }
+        return Source;
+    }
+
+    void CopyRawBlocks(unsigned int* OutBuffer, int BlockSize, int BlockCount, const RawCopy* Copies, int CopyCount,
+                       const unsigned int* Source)
+    {
+        if (BlockCount < ParallelCopyBlockCount)
+        {
+            for (int i = 0; i < CopyCount; i++)
+                Source = CopyRawBlocks(OutBuffer, BlockSize, Copies[i], 0, BlockCount, Source);
+            return;
+        }
+
+        TaskGroup Tasks;
+        for (int i = 0; i < CopyCount; i++)
+        {
+            for (int First = 0; First < BlockCount; First += CopyChunkBlocks)
+            {
+                const int Last = std::min(First + CopyChunkBlocks, BlockCount);
+                Tasks.run([=, &Copy = Copies[i]] { CopyRawBlocks(OutBuffer, BlockSize, Copy, First, Last, Source); });
+                Source += (size_t)CountRawBlocks(Copies[i].Mask, First, Last) * Copies[i].WordsPerBlock;
+            }
+        }
+        Tasks.wait();
+    }
+}
+
+void AtexDecompress(unsigned int* InputBuffer, unsigned int BufferSize, unsigned int ImageFormat, const SImageDescriptor& ImageDescriptor, unsigned int* OutBuffer, unsigned int* Tables)
 {
     unsigned int HeaderSize = 12;
 
@@ -45,7 +125,7 @@ void AtexDecompress(unsigned int* InputBuffer, unsigned int BufferSize, unsigned
         return;
     }
 
-    unsigned int* DcmpBuffer1 = new unsigned int[BlockCount];
+    unsigned int* DcmpBuffer1 = Tables ? Tables : new unsigned int[BlockCount];
     unsigned int* DcmpBuffer2 = DcmpBuffer1 + BlockCount / 2;
     memset(DcmpBuffer1, 0, BlockCount * 4);
 
@@ -110,48 +190,18 @@ void AtexDecompress(unsigned int* InputBuffer, unsigned int BufferSize, unsigned
 
     [[maybe_unused]] unsigned int* DataEnd = InputBuffer + ((HeaderSize + DataSize) >> 2);
 
-    if ((AlphaDataSize || AlphaDataSize2) && BlockCount)
+    RawCopy Copies[3];
+    int CopyCount = 0;
+    if (AlphaDataSize || AlphaDataSize2)
     {
-        unsigned int* BufferVar = OutBuffer;
-
-        for (int x = 0; x < BlockCount; x++)
-        {
-            if (! (DcmpBuffer1[x >> 5] & 1 << x))
-            {
-                BufferVar[0] = ImageData.DataPos[0];
-                BufferVar[1] = ImageData.DataPos[1];
-                ImageData.DataPos += 2;
-            }
-            BufferVar += BlockSize;
-        }
+        Copies[CopyCount++] = {DcmpBuffer1, 0, 2};
     }
-
-    if (ColorDataSize && BlockCount)
+    if (ColorDataSize)
     {
-        unsigned int* BufferVar = OutBuffer + AlphaDataSize2 + AlphaDataSize;
-
-        for (int x = 0; x < BlockCount; x++)
-        {
-            if (! (DcmpBuffer2[x >> 5] & 1 << x))
-            {
-                BufferVar[0] = ImageData.DataPos[0];
-                ImageData.DataPos++;
-            }
-            BufferVar += BlockSize;
-        }
-
-        BufferVar = OutBuffer + AlphaDataSize2 + AlphaDataSize + 1;
-
-        for (int x = 0; x < BlockCount; x++)
-        {
-            if (! (DcmpBuffer2[x >> 5] & 1 << x))
-            {
-                BufferVar[0] = ImageData.DataPos[0];
-                ImageData.DataPos++;
-            }
-            BufferVar += BlockSize;
-        }
+        Copies[CopyCount++] = {DcmpBuffer2, AlphaDataSize2 + AlphaDataSize, 1};
+        Copies[CopyCount++] = {DcmpBuffer2, AlphaDataSize2 + AlphaDataSize + 1, 1};
     }
+    CopyRawBlocks(OutBuffer, BlockSize, BlockCount, Copies, CopyCount, ImageData.DataPos);
 
     if (CompressionCode & 0x10 && ImageData.xres == 256 && ImageData.yres == 256 &&
         (ImageFormat == 0x10 || ImageFormat == 0x11))
@@ -159,5 +209,8 @@ void AtexDecompress(unsigned int* InputBuffer, unsigned int BufferSize, unsigned
         AtexSubCode7_Cpp(OutBuffer, BlockCount);
     }
 
-    delete[] (unsigned char*)DcmpBuffer1;
+    if (! Tables)
+    {
+        delete[] DcmpBuffer1;
+    }
 }
\ No newline at end of file
@@ -43,5 +43,7 @@ constexpr unsigned char byte_79053D[] = {
     0x0,  0x1, 0x0,  0x1, 0x0,  0x1, 0x0,  0x1, 0x0,  0x1, 0x0,  0x1, 0x0,  0x1, 0x0};
 
 int DecompressAtex(int a, int b, int imageformat, int d, int e, int f, int g);
+// tables, if given, holds one word per 4x4 block for the masks of the decompressed blocks, otherwise
+// they are allocated for the call
 void AtexDecompress(unsigned int* input, unsigned int unknown, unsigned int imageformat,
-                    const SImageDescriptor& ImageDescriptor, unsigned int* output);
+                    const SImageDescriptor& ImageDescriptor, unsigned int* output, unsigned int* tables = nullptr);
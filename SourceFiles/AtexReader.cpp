@@ -1,6 +1,7 @@
 
 #include "pch.h"
 #include "AtexDecompress.h"
+#include "TaskPool.h"
 
 #pragma pack(1)
 
@@ -22,16 +23,16 @@ struct DXT5Alpha
     __int64 table;
 };
 
-std::vector<RGBA> ProcessDXT1(unsigned char* data, int xr, int yr)
+std::vector<RGBA> ProcessDXT1Reference(const unsigned char* data, int xr, int yr)
 {
     DXT1Color* coltable = new DXT1Color[xr * yr / 16];
     unsigned int* blocktable = new unsigned int[xr * yr / 16];
 
-    unsigned int* d = (unsigned int*)data;
+    const unsigned int* d = (const unsigned int*)data;
 
     for (int x = 0; x < xr * yr / 16; x++)
     {
-        coltable[x] = *(DXT1Color*)&d[x * 2];
+        coltable[x] = *(const DXT1Color*)&d[x * 2];
         blocktable[x] = d[x * 2 + 1];
     }
 
@@ -89,18 +90,18 @@ std::vector<RGBA> ProcessDXT1(unsigned char* data, int xr, int yr)
     return image;
 }
 
-std::vector<RGBA> ProcessDXT3(unsigned char* data, int xr, int yr)
+std::vector<RGBA> ProcessDXT3Reference(const unsigned char* data, int xr, int yr)
 {
     DXT1Color* coltable = new DXT1Color[xr * yr / 16];
     __int64* alphatable = new __int64[xr * yr / 16];
     unsigned int* blocktable = new unsigned int[xr * yr / 16];
 
-    unsigned int* d = (unsigned int*)data;
+    const unsigned int* d = (const unsigned int*)data;
 
     for (int x = 0; x < xr * yr / 16; x++)
     {
-        alphatable[x] = ((__int64*)d)[x * 2];
-        coltable[x] = *(DXT1Color*)&d[x * 4 + 2];
+        alphatable[x] = ((const __int64*)d)[x * 2];
+        coltable[x] = *(const DXT1Color*)&d[x * 4 + 2];
         blocktable[x] = d[x * 4 + 3];
     }
 
@@ -149,18 +150,18 @@ std::vector<RGBA> ProcessDXT3(unsigned char* data, int xr, int yr)
     return image;
 }
 
-std::vector<RGBA> ProcessDXT5(unsigned char* data, int xr, int yr)
+std::vector<RGBA> ProcessDXT5Reference(const unsigned char* data, int xr, int yr)
 {
     DXT1Color* coltable = new DXT1Color[xr * yr / 16];
     DXT5Alpha* alphatable = new DXT5Alpha[xr * yr / 16];
     unsigned int* blocktable = new unsigned int[xr * yr / 16];
 
-    unsigned int* d = (unsigned int*)data;
+    const unsigned int* d = (const unsigned int*)data;
 
     for (int x = 0; x < xr * yr / 16; x++)
     {
-        alphatable[x] = *(DXT5Alpha*)&(((__int64*)d)[x * 2]);
-        coltable[x] = *(DXT1Color*)&d[x * 4 + 2];
+        alphatable[x] = *(const DXT5Alpha*)&(((const __int64*)d)[x * 2]);
+        coltable[x] = *(const DXT1Color*)&d[x * 4 + 2];
         blocktable[x] = d[x * 4 + 3];
     }
 
@@ -228,84 +229,547 @@ std::vector<RGBA> ProcessDXT5(unsigned char* data, int xr, int yr)
     return image;
 }
 
-#include <vector>
+#pragma pack()
 
-DatTexture ProcessImageFile(unsigned char* img, int size)
-{
-    int id1, id2;
+// Block decoders. They produce exactly what the Reference functions above produce, but decode a
+// whole 4x4 block at a time straight into the output rows, with integer palette math. x86 CPUs
+// with SSE4.1 look up a whole row of texels with a single byte shuffle.
 
-    id1 = ((unsigned int*)img)[0];
-    id2 = ((unsigned int*)img)[1];
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define ATEX_READER_SSE41 1
+#include <smmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define ATEX_READER_TARGET_SSE41
+#else
+#define ATEX_READER_TARGET_SSE41 __attribute__((target("sse4.1")))
+#endif
+#endif
 
-    if (id1 != 'XTTA' && id1 != 'XETA')
+namespace
+{
+    enum class BlockAlpha
     {
-        return DatTexture();
+        None,     // BC1
+        Explicit, // BC2, 4 bits per texel
+        Interpolated // BC3, 3 bit indices into 8 alpha values
+    };
+
+    // x / 3 for 0 <= x <= 765, the range of the interpolated palette sums
+    inline uint32_t Div3(uint32_t x)
+    {
+        return (x * 0xAAABu) >> 17;
     }
 
-    if ((id2 & 0xffffff) != 'TXD')
+    inline uint32_t PackRGBA(uint32_t r, uint32_t g, uint32_t b, uint32_t a)
     {
-        return DatTexture();
+        return r | (g << 8) | (b << 16) | (a << 24);
     }
 
-    int cmptype = id2 >> 24;
+    // Colour palette of a block the way the Reference decoders build it: 5:6:5 expanded by
+    // shifting, without replicating the high bits, and the interpolated entries truncated.
+    // BC2 and BC3 blocks always use the four colour mode.
+    inline void DecodeColorPalette(uint32_t colors, bool bc1, uint32_t palette[4])
+    {
+        const uint32_t c1 = colors & 0xFFFF;
+        const uint32_t c2 = colors >> 16;
 
-    SImageDescriptor r;
-    r.xres = *(unsigned short*)(img + 8);
-    r.yres = *(unsigned short*)(img + 10);
-    r.Data = img;
-    r.imageformat = 0xf;
-    r.a = size;
-    r.b = 6;
-    r.c = 0;
+        const uint32_t r0 = (c1 & 31) << 3, g0 = ((c1 >> 5) & 63) << 2, b0 = (c1 >> 11) << 3;
+        const uint32_t r1 = (c2 & 31) << 3, g1 = ((c2 >> 5) & 63) << 2, b1 = (c2 >> 11) << 3;
 
-    std::vector<RGBA> output(r.xres * r.yres);
-    r.image = (unsigned char*)output.data();
+        palette[0] = PackRGBA(r0, g0, b0, 255);
+        palette[1] = PackRGBA(r1, g1, b1, 255);
 
-    std::vector<RGBA> image;
+        if (!bc1 || c1 > c2)
+        {
+            palette[2] = PackRGBA(Div3(r0 * 2 + r1), Div3(g0 * 2 + g1), Div3(b0 * 2 + b1), 255);
+            palette[3] = PackRGBA(Div3(r0 + r1 * 2), Div3(g0 + g1 * 2), Div3(b0 + b1 * 2), 255);
+        }
+        else
+        {
+            palette[2] = PackRGBA((r0 + r1) >> 1, (g0 + g1) >> 1, (b0 + b1) >> 1, 255);
+            palette[3] = 0;
+        }
+    }
+
+    inline void DecodeAlphaPalette(uint32_t a0, uint32_t a1, uint8_t palette[8])
+    {
+        palette[0] = (uint8_t)a0;
+        palette[1] = (uint8_t)a1;
 
-    TextureType tex_type = TextureType::BC1;
+        if (a0 > a1)
+        {
+            for (uint32_t z = 0; z < 6; z++)
+                palette[z + 2] = (uint8_t)(((6 - z) * a0 + (z + 1) * a1) / 7);
+        }
+        else
+        {
+            for (uint32_t z = 0; z < 4; z++)
+                palette[z + 2] = (uint8_t)(((4 - z) * a0 + (z + 1) * a1) / 5);
+            palette[6] = 0;
+            palette[7] = 255;
+        }
+    }
 
-    switch (cmptype)
+    // A decoded block header: the colour palette, the 2 bit selectors, and for BC2/BC3 the alpha bits
+    struct BlockHeader
     {
-    case '1':
-        AtexDecompress((unsigned int*)img, size, 0xf, r, (unsigned int*)output.data());
-        image = ProcessDXT1((unsigned char*)output.data(), r.xres, r.yres);
-        tex_type = TextureType::BC1;
-        break;
-    case '2':
-    case '3':
-    case 'N':
-        AtexDecompress((unsigned int*)img, size, 0x11, r, (unsigned int*)output.data());
-        image = ProcessDXT3((unsigned char*)output.data(), r.xres, r.yres);
-        if (cmptype == 'N')
+        uint32_t colors[4];
+        uint32_t selectors;
+        uint64_t alphaBits;
+        uint8_t alphaPalette[8];
+    };
+
+    template <BlockAlpha Alpha>
+    inline void ReadBlock(const unsigned char* block, BlockHeader& header)
+    {
+        uint32_t colors;
+        if constexpr (Alpha == BlockAlpha::None)
         {
-            tex_type = TextureType::NormalMap;
+            memcpy(&colors, block, 4);
+            memcpy(&header.selectors, block + 4, 4);
         }
         else
         {
-			tex_type = TextureType::BC3;
+            memcpy(&header.alphaBits, block, 8);
+            memcpy(&colors, block + 8, 4);
+            memcpy(&header.selectors, block + 12, 4);
+        }
+
+        DecodeColorPalette(colors, Alpha == BlockAlpha::None, header.colors);
+
+        if constexpr (Alpha == BlockAlpha::Interpolated)
+        {
+            DecodeAlphaPalette(block[0], block[1], header.alphaPalette);
+            header.alphaBits >>= 16;
+        }
+    }
+
+    template <BlockAlpha Alpha>
+    void DecodeBlockScalar(const BlockHeader& header, RGBA* dst, int pitch)
+    {
+        uint32_t t = header.selectors;
+        uint64_t k = header.alphaBits;
+
+        for (int b = 0; b < 4; b++, dst += pitch)
+        {
+            for (int a = 0; a < 4; a++)
+            {
+                uint32_t texel = header.colors[t & 3];
+                t >>= 2;
+
+                if constexpr (Alpha == BlockAlpha::Explicit)
+                {
+                    texel = (texel & 0x00FFFFFF) | (uint32_t)((k & 15) << 28);
+                    k >>= 4;
+                }
+                else if constexpr (Alpha == BlockAlpha::Interpolated)
+                {
+                    texel = (texel & 0x00FFFFFF) | ((uint32_t)header.alphaPalette[k & 7] << 24);
+                    k >>= 3;
+                }
+
+                dst[a].dw = texel;
+            }
+        }
+    }
+
+#ifdef ATEX_READER_SSE41
+    // For each byte of selectors (one row of a block), the pshufb mask that picks the four
+    // texels' colours out of a 16 byte palette
+    struct ColorShuffleTable
+    {
+        alignas(16) uint8_t masks[256][16];
+
+        ColorShuffleTable()
+        {
+            for (int row = 0; row < 256; row++)
+                for (int texel = 0; texel < 4; texel++)
+                    for (int byte = 0; byte < 4; byte++)
+                        masks[row][texel * 4 + byte] = (uint8_t)(((row >> (texel * 2)) & 3) * 4 + byte);
+        }
+    };
+
+    const ColorShuffleTable s_ColorShuffles;
+
+    bool CpuHasSSE41()
+    {
+#ifdef _MSC_VER
+        int info[4];
+        __cpuid(info, 1);
+        return (info[2] & (1 << 19)) != 0;
+#else
+        return __builtin_cpu_supports("sse4.1");
+#endif
+    }
+
+    const bool s_UseSSE41 = CpuHasSSE41();
+
+    template <BlockAlpha Alpha>
+    ATEX_READER_TARGET_SSE41 void DecodeBlockSSE41(const BlockHeader& header, RGBA* dst, int pitch)
+    {
+        const __m128i palette = _mm_loadu_si128((const __m128i*)header.colors);
+        const __m128i rgbMask = _mm_set1_epi32(0x00FFFFFF);
+        __m128i alphaPalette = _mm_setzero_si128();
+        if constexpr (Alpha == BlockAlpha::Interpolated)
+            alphaPalette = _mm_loadl_epi64((const __m128i*)header.alphaPalette);
+
+        for (int b = 0; b < 4; b++, dst += pitch)
+        {
+            const uint32_t rowSelectors = (header.selectors >> (b * 8)) & 0xFF;
+            __m128i texels =
+                _mm_shuffle_epi8(palette, _mm_load_si128((const __m128i*)s_ColorShuffles.masks[rowSelectors]));
+
+            if constexpr (Alpha == BlockAlpha::Explicit)
+            {
+                // Four nibbles, one byte each, moved to the top of their texel: (n << 4) << 24
+                const uint32_t bits = (uint32_t)(header.alphaBits >> (b * 16)) & 0xFFFF;
+                const uint32_t nibbles = (bits & 0xF) | ((bits & 0xF0) << 4) | ((bits & 0xF00) << 8) | ((bits & 0xF000) << 12);
+                const __m128i alpha = _mm_slli_epi32(_mm_cvtepu8_epi32(_mm_cvtsi32_si128((int)nibbles)), 28);
+                texels = _mm_or_si128(_mm_and_si128(texels, rgbMask), alpha);
+            }
+            else if constexpr (Alpha == BlockAlpha::Interpolated)
+            {
+                // Shuffle each texel's alpha into its top byte, 0x80 zeroes the other three
+                const uint32_t bits = (uint32_t)(header.alphaBits >> (b * 12)) & 0xFFF;
+                const uint32_t indices = (bits & 7) | ((bits & 0x38) << 5) | ((bits & 0x1C0) << 10) | ((bits & 0xE00) << 15);
+                const __m128i mask = _mm_or_si128(_mm_slli_epi32(_mm_cvtepu8_epi32(_mm_cvtsi32_si128((int)indices)), 24),
+                                                  _mm_set1_epi32(0x00808080));
+                texels = _mm_or_si128(_mm_and_si128(texels, rgbMask), _mm_shuffle_epi8(alphaPalette, mask));
+            }
+
+            _mm_storeu_si128((__m128i*)dst, texels);
+        }
+    }
+#endif
+
+    // Images with at least this many blocks are decoded in bands of rows on the TaskPool
+    constexpr int ParallelDecodeBlockCount = 16384; // 512x512 and larger
+    constexpr int DecodeBandBlocks = 4096;
+
+    template <BlockAlpha Alpha>
+    void DecodeBlockRows(const unsigned char* data, RGBA* image, int xr, int firstRow, int lastRow)
+    {
+        constexpr int blockSize = Alpha == BlockAlpha::None ? 8 : 16;
+
+        const int blocksX = xr / 4;
+        BlockHeader header;
+        for (int y = firstRow; y < lastRow; y++)
+        {
+            for (int x = 0; x < blocksX; x++)
+            {
+                ReadBlock<Alpha>(data + (size_t)(y * blocksX + x) * blockSize, header);
+
+                RGBA* dst = image + (size_t)y * 4 * xr + x * 4;
+#ifdef ATEX_READER_SSE41
+                if (s_UseSSE41)
+                {
+                    DecodeBlockSSE41<Alpha>(header, dst, xr);
+                    continue;
+                }
+#endif
+                DecodeBlockScalar<Alpha>(header, dst, xr);
+            }
+        }
+    }
+
+    template <BlockAlpha Alpha>
+    void DecodeBlocks(const unsigned char* data, int xr, int yr, RGBA* image)
+    {
+        // Texels the blocks don't cover (sizes that aren't a multiple of 4) are zero. The buffer may
+        // be reused from an earlier texture, so they have to be cleared.
+        if ((xr | yr) & 3)
+            memset(image, 0, (size_t)xr * yr * sizeof(RGBA));
+
+        const int blocksX = xr / 4;
+        const int blocksY = yr / 4;
+        if (blocksX * blocksY < ParallelDecodeBlockCount)
+        {
+            DecodeBlockRows<Alpha>(data, image, xr, 0, blocksY);
+            return;
+        }
+
+        const int bandRows = std::max(1, DecodeBandBlocks / blocksX);
+        TaskGroup tasks;
+        for (int firstRow = 0; firstRow < blocksY; firstRow += bandRows)
+        {
+            const int lastRow = std::min(firstRow + bandRows, blocksY);
+            tasks.run([=] { DecodeBlockRows<Alpha>(data, image, xr, firstRow, lastRow); });
+        }
+        tasks.wait();
+    }
+
+    template <BlockAlpha Alpha>
+    std::vector<RGBA> DecodeBlocks(const unsigned char* data, int xr, int yr)
+    {
+        std::vector<RGBA> image(xr * yr);
+        DecodeBlocks<Alpha>(data, xr, yr, image.data());
+        return image;
+    }
+}
+
+std::vector<RGBA> ProcessDXT1(const unsigned char* data, int xr, int yr)
+{
+    return DecodeBlocks<BlockAlpha::None>(data, xr, yr);
+}
+
+std::vector<RGBA> ProcessDXT3(const unsigned char* data, int xr, int yr)
+{
+    return DecodeBlocks<BlockAlpha::Explicit>(data, xr, yr);
+}
+
+std::vector<RGBA> ProcessDXT5(const unsigned char* data, int xr, int yr)
+{
+    return DecodeBlocks<BlockAlpha::Interpolated>(data, xr, yr);
+}
+
+void ProcessDXT1(const unsigned char* data, int xr, int yr, RGBA* image)
+{
+    DecodeBlocks<BlockAlpha::None>(data, xr, yr, image);
+}
+
+void ProcessDXT3(const unsigned char* data, int xr, int yr, RGBA* image)
+{
+    DecodeBlocks<BlockAlpha::Explicit>(data, xr, yr, image);
+}
+
+void ProcessDXT5(const unsigned char* data, int xr, int yr, RGBA* image)
+{
+    DecodeBlocks<BlockAlpha::Interpolated>(data, xr, yr, image);
+}
+
+namespace
+{
+    // What the ATEX/ATTX header says about a texture, shared by ProcessImageFile and ProcessImageFileBlocks
+    struct ImageFileHeader
+    {
+        int width;
+        int height;
+        unsigned int imageformat; // AtexDecompress format
+        BlockFormat block_format;
+        TextureType texture_type;
+        bool premultiply_alpha;
+    };
+
+    bool ReadImageFileHeader(const unsigned char* img, int size, ImageFileHeader& header)
+    {
+        if (size < 12)
+            return false;
+
+        int id1, id2;
+
+        id1 = ((const unsigned int*)img)[0];
+        id2 = ((const unsigned int*)img)[1];
+
+        if (id1 != 'XTTA' && id1 != 'XETA')
+        {
+            return false;
         }
+
+        if ((id2 & 0xffffff) != 'TXD')
+        {
+            return false;
+        }
+
+        int cmptype = id2 >> 24;
+
+        header.premultiply_alpha = false;
+
+        switch (cmptype)
+        {
+        case '1':
+            header.imageformat = 0xf;
+            header.block_format = BlockFormat::BC1;
+            header.texture_type = TextureType::BC1;
+            break;
+        case '2':
+        case '3':
+        case 'N':
+            header.imageformat = 0x11;
+            header.block_format = BlockFormat::BC2;
+            header.texture_type = cmptype == 'N' ? TextureType::NormalMap : TextureType::BC3;
+            break;
+        case '4':
+        case '5':
+            header.imageformat = 0x13;
+            header.block_format = BlockFormat::BC3;
+            header.texture_type = TextureType::BC5;
+            break;
+        case 'L':
+            header.imageformat = 0x12;
+            header.block_format = BlockFormat::BC3;
+            header.texture_type = TextureType::BC5;
+            header.premultiply_alpha = true;
+            break;
+        default:
+            return false;
+        }
+
+        header.width = *(const unsigned short*)(img + 8);
+        header.height = *(const unsigned short*)(img + 10);
+        return true;
+    }
+
+    SImageDescriptor GetImageDescriptor(unsigned char* img, int size, const ImageFileHeader& header)
+    {
+        SImageDescriptor r;
+        r.xres = header.width;
+        r.yres = header.height;
+        r.Data = img;
+        r.imageformat = 0xf;
+        r.a = size;
+        r.b = 6;
+        r.c = 0;
+        return r;
+    }
+
+    // AtexDecompress writes a whole block for every 16 texels, and uses one word per block for its tables.
+    // Images under 16 texels have no blocks, AtexDecompress returns without touching either.
+    size_t GetAtexBlockStreamSize(const ImageFileHeader& header)
+    {
+        return (size_t)(header.width * header.height / 16) * (header.block_format == BlockFormat::BC1 ? 8 : 16);
+    }
+
+    size_t GetAtexTableSize(const ImageFileHeader& header)
+    {
+        return (size_t)(header.width * header.height / 16) * sizeof(unsigned int);
+    }
+}
+
+DatCompressedTexture ProcessImageFileBlocks(unsigned char* img, int size)
+{
+    ImageFileHeader header;
+    if (! ReadImageFileHeader(img, size, header))
+    {
+        return DatCompressedTexture();
+    }
+
+    DatCompressedTexture texture;
+    texture.block_format = header.block_format;
+    texture.texture_type = header.texture_type;
+    texture.premultiply_alpha = header.premultiply_alpha;
+
+    SImageDescriptor r = GetImageDescriptor(img, size, header);
+
+    // AtexDecompress may use the whole RGBA sized buffer, only the blocks are kept
+    texture.blocks.resize(r.xres * r.yres * sizeof(RGBA));
+    r.image = texture.blocks.data();
+    AtexDecompress((unsigned int*)img, size, header.imageformat, r, (unsigned int*)texture.blocks.data());
+
+    texture.width = r.xres;
+    texture.height = r.yres;
+    texture.blocks.resize((size_t)(r.xres / 4) * (r.yres / 4) * texture.block_size());
+
+    return texture;
+}
+
+DatTextureInfo QueryImageFile(const unsigned char* img, int size)
+{
+    ImageFileHeader header;
+    if (! ReadImageFileHeader(img, size, header) || header.width == 0 || header.height == 0)
+    {
+        return DatTextureInfo();
+    }
+
+    DatTextureInfo info;
+    info.width = header.width;
+    info.height = header.height;
+    info.texture_type = header.texture_type;
+    info.texel_count = (size_t)header.width * header.height;
+    info.scratch_size = GetAtexBlockStreamSize(header) + GetAtexTableSize(header);
+    return info;
+}
+
+bool ProcessImageFile(unsigned char* img, int size, RGBA* texels, size_t texel_capacity, unsigned char* scratch,
+                      size_t scratch_size)
+{
+    ImageFileHeader header;
+    if (! ReadImageFileHeader(img, size, header) || header.width == 0 || header.height == 0)
+    {
+        return false;
+    }
+
+    const size_t block_stream_size = GetAtexBlockStreamSize(header);
+    if (texel_capacity < (size_t)header.width * header.height ||
+        scratch_size < block_stream_size + GetAtexTableSize(header))
+    {
+        return false;
+    }
+
+    // The block stream first, AtexDecompress's tables after it. Both are whole words, the table
+    // stays aligned as long as scratch is.
+    unsigned int* blocks = (unsigned int*)scratch;
+    unsigned int* tables = (unsigned int*)(scratch + block_stream_size);
+
+    // Blocks the compressed passes claim but don't fill are left as they are, zero in a new buffer
+    if (block_stream_size)
+    {
+        memset(scratch, 0, block_stream_size);
+    }
+
+    SImageDescriptor r = GetImageDescriptor(img, size, header);
+    r.image = scratch;
+    AtexDecompress((unsigned int*)img, size, header.imageformat, r, blocks, tables);
+
+    switch (header.block_format)
+    {
+    case BlockFormat::BC1:
+        ProcessDXT1(scratch, header.width, header.height, texels);
+        break;
+    case BlockFormat::BC2:
+        ProcessDXT3(scratch, header.width, header.height, texels);
         break;
-    case '4':
-    case '5':
-        AtexDecompress((unsigned int*)img, size, 0x13, r, (unsigned int*)output.data());
-        image = ProcessDXT5((unsigned char*)output.data(), r.xres, r.yres);
-        tex_type = TextureType::BC5;
+    case BlockFormat::BC3:
+        ProcessDXT5(scratch, header.width, header.height, texels);
         break;
-    case 'L':
-        AtexDecompress((unsigned int*)img, size, 0x12, r, (unsigned int*)output.data());
-        image = ProcessDXT5((unsigned char*)output.data(), r.xres, r.yres);
-        for (int x = 0; x < r.xres * r.yres; x++)
+    }
+
+    if (header.premultiply_alpha)
+    {
+        for (int x = 0; x < header.width * header.height; x++)
         {
-            image[x].r = (image[x].r * image[x].a) / 255;
-            image[x].g = (image[x].g * image[x].a) / 255;
-            image[x].b = (image[x].b * image[x].a) / 255;
+            texels[x].r = (texels[x].r * texels[x].a) / 255;
+            texels[x].g = (texels[x].g * texels[x].a) / 255;
+            texels[x].b = (texels[x].b * texels[x].a) / 255;
         }
-        tex_type = TextureType::BC5;
-        break;
-    default:
+    }
+
+    return true;
+}
+
+bool ProcessImageFile(unsigned char* img, int size, DatTexture& texture, std::vector<unsigned char>& scratch)
+{
+    texture.width = 0;
+    texture.height = 0;
+
+    const DatTextureInfo info = QueryImageFile(img, size);
+    if (info.width == 0)
+    {
+        return false;
+    }
+
+    // resize() only reallocates when the buffers have to grow, a reused buffer keeps its capacity
+    texture.rgba_data.resize(info.texel_count);
+    scratch.resize(info.scratch_size);
+    if (! ProcessImageFile(img, size, texture.rgba_data.data(), texture.rgba_data.size(), scratch.data(), scratch.size()))
+    {
+        return false;
+    }
+
+    texture.width = info.width;
+    texture.height = info.height;
+    texture.texture_type = info.texture_type;
+    return true;
+}
+
+DatTexture ProcessImageFile(unsigned char* img, int size)
+{
+    DatTexture texture{};
+    std::vector<unsigned char> scratch;
+    if (! ProcessImageFile(img, size, texture, scratch))
+    {
         return DatTexture();
     }
 
-    return DatTexture(r.xres, r.yres, image, tex_type);
+    return texture;
 }
@@ -29,4 +29,72 @@ struct DatTexture
     TextureType texture_type;
 };
 
+// D3D block compression format of a DatCompressedTexture
+enum class BlockFormat
+{
+    BC1, // DXT1, 8 bytes per block
+    BC2, // DXT3, 16 bytes per block
+    BC3  // DXT5, 16 bytes per block
+};
+
+// An ATEX/ATTX texture after AtexDecompress has rebuilt its block stream, before it is decoded to RGBA.
+// Blocks are stored row by row, (width / 4) * (height / 4) of them. GPUs and DDS files can use them
+// as they are, which is 4-8x smaller than the RGBA image and skips re-encoding it.
+struct DatCompressedTexture
+{
+    int width = 0;
+    int height = 0;
+    BlockFormat block_format = BlockFormat::BC1;
+    TextureType texture_type = TextureType::BC1; // Same as ProcessImageFile returns
+    // 'L' textures: ProcessImageFile multiplies the colour by alpha after decoding, the blocks aren't premultiplied
+    bool premultiply_alpha = false;
+    std::vector<unsigned char> blocks;
+
+    int block_size() const { return block_format == BlockFormat::BC1 ? 8 : 16; }
+    size_t row_pitch() const { return (size_t)(width / 4) * block_size(); }
+};
+
+// Size of an ATEX/ATTX texture and of the buffers ProcessImageFile needs to decode it without allocating
+struct DatTextureInfo
+{
+    int width = 0; // 0 for the files ProcessImageFile rejects
+    int height = 0;
+    TextureType texture_type = TextureType::BC1;
+    size_t texel_count = 0;  // RGBA texels of the decoded image
+    size_t scratch_size = 0; // Bytes for the block stream and AtexDecompress's tables
+};
+
+// Reads the header only, to size the buffers for the ProcessImageFile overloads below
+DatTextureInfo QueryImageFile(const unsigned char* img, int size);
+
 DatTexture ProcessImageFile(unsigned char* img, int size);
+
+// Decodes into caller owned buffers: texels must hold texel_count texels and scratch, which has to be
+// 4 byte aligned, scratch_size bytes (see QueryImageFile). Doesn't allocate, apart from TaskPool tasks
+// for large images. Returns false if the file isn't supported or a buffer is too small.
+bool ProcessImageFile(unsigned char* img, int size, RGBA* texels, size_t texel_capacity, unsigned char* scratch,
+                      size_t scratch_size);
+
+// Same, growing texture.rgba_data and scratch as needed. A worker that keeps both between files only
+// allocates when a texture is larger than any it decoded before.
+bool ProcessImageFile(unsigned char* img, int size, DatTexture& texture, std::vector<unsigned char>& scratch);
+
+// Runs AtexDecompress only. Returns an empty texture (no blocks) for the same files ProcessImageFile rejects.
+DatCompressedTexture ProcessImageFileBlocks(unsigned char* img, int size);
+
+// Decode the BC1 (DXT1), BC2 (DXT3) and BC3 (DXT5) block stream AtexDecompress produces into an
+// xr * yr RGBA image, a 4x4 block at a time. Uses SSE4.1 when the CPU has it.
+std::vector<RGBA> ProcessDXT1(const unsigned char* data, int xr, int yr);
+std::vector<RGBA> ProcessDXT3(const unsigned char* data, int xr, int yr);
+std::vector<RGBA> ProcessDXT5(const unsigned char* data, int xr, int yr);
+
+// Same, into an xr * yr image the caller owns
+void ProcessDXT1(const unsigned char* data, int xr, int yr, RGBA* image);
+void ProcessDXT3(const unsigned char* data, int xr, int yr, RGBA* image);
+void ProcessDXT5(const unsigned char* data, int xr, int yr, RGBA* image);
+
+// The original texel at a time decoders. Kept as the reference the block decoders have to match
+// bit for bit, see Benchmarks/BlockDecodeBenchmark.h.
+std::vector<RGBA> ProcessDXT1Reference(const unsigned char* data, int xr, int yr);
+std::vector<RGBA> ProcessDXT3Reference(const unsigned char* data, int xr, int yr);
+std::vector<RGBA> ProcessDXT5Reference(const unsigned char* data, int xr, int yr);
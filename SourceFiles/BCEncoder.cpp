@@ -0,0 +1,559 @@
+#include "pch.h"
+#include "BCEncoder.h"
+#include "TaskPool.h"
+
+namespace
+{
+    // Images with at least this many blocks are encoded on the TaskPool, in jobs of about JobBlocks
+    constexpr size_t ParallelBlockCount = 4096;
+    constexpr size_t JobBlocks = 1024;
+
+    // Texels of BC1 blocks below this alpha are left transparent
+    constexpr uint8_t AlphaThreshold = 128;
+
+    struct Vec3
+    {
+        float r, g, b;
+
+        Vec3 operator+(const Vec3& o) const { return {r + o.r, g + o.g, b + o.b}; }
+        Vec3 operator-(const Vec3& o) const { return {r - o.r, g - o.g, b - o.b}; }
+        Vec3 operator*(float s) const { return {r * s, g * s, b * s}; }
+        float Dot(const Vec3& o) const { return r * o.r + g * o.g + b * o.b; }
+    };
+
+    Vec3 Clamp255(const Vec3& v)
+    {
+        return {std::clamp(v.r, 0.0f, 255.0f), std::clamp(v.g, 0.0f, 255.0f), std::clamp(v.b, 0.0f, 255.0f)};
+    }
+
+    // RGB565, and the colour it decodes to
+    struct Endpoint
+    {
+        uint16_t packed;
+        int r, g, b;
+    };
+
+    Endpoint Quantize(const Vec3& color)
+    {
+        const Vec3 c = Clamp255(color);
+        const int r5 = (int)(c.r * 31.0f / 255.0f + 0.5f);
+        const int g6 = (int)(c.g * 63.0f / 255.0f + 0.5f);
+        const int b5 = (int)(c.b * 31.0f / 255.0f + 0.5f);
+        return {(uint16_t)((r5 << 11) | (g6 << 5) | b5), (r5 << 3) | (r5 >> 2), (g6 << 2) | (g6 >> 4), (b5 << 3) | (b5 >> 2)};
+    }
+
+    Vec3 ToVec3(const Endpoint& e) { return {(float)e.r, (float)e.g, (float)e.b}; }
+
+    // The block's texels, clamped at the right and bottom edges of the image
+    void LoadBlock(const RGBA* texels, int width, int height, int blockX, int blockY, RGBA block[16])
+    {
+        for (int y = 0; y < 4; y++)
+        {
+            const RGBA* row = texels + (size_t)std::min(blockY * 4 + y, height - 1) * width;
+            for (int x = 0; x < 4; x++)
+                block[y * 4 + x] = row[std::min(blockX * 4 + x, width - 1)];
+        }
+    }
+
+    Vec3 PrincipalAxis(const Vec3* points, int count)
+    {
+        Vec3 mean{0, 0, 0};
+        for (int i = 0; i < count; i++)
+            mean = mean + points[i];
+        mean = mean * (1.0f / count);
+
+        float rr = 0, rg = 0, rb = 0, gg = 0, gb = 0, bb = 0;
+        for (int i = 0; i < count; i++)
+        {
+            const Vec3 d = points[i] - mean;
+            rr += d.r * d.r, rg += d.r * d.g, rb += d.r * d.b;
+            gg += d.g * d.g, gb += d.g * d.b, bb += d.b * d.b;
+        }
+
+        // Power iteration, starting from the luminance direction
+        Vec3 axis{0.3f, 0.6f, 0.1f};
+        for (int iteration = 0; iteration < 8; iteration++)
+        {
+            const Vec3 next{rr * axis.r + rg * axis.g + rb * axis.b, rg * axis.r + gg * axis.g + gb * axis.b,
+                            rb * axis.r + gb * axis.g + bb * axis.b};
+            const float length = std::max({std::abs(next.r), std::abs(next.g), std::abs(next.b)});
+            if (length < 1e-6f)
+                break;
+            axis = next * (1.0f / length);
+        }
+        return axis;
+    }
+
+    // Least squares endpoints for points that are weights[i] * a + (1 - weights[i]) * b
+    bool SolveEndpoints(const Vec3* points, const float* weights, int count, Vec3& a, Vec3& b)
+    {
+        float aa = 0, bb = 0, ab = 0;
+        Vec3 ax{0, 0, 0};
+        Vec3 bx{0, 0, 0};
+        for (int i = 0; i < count; i++)
+        {
+            const float alpha = weights[i];
+            const float beta = 1.0f - alpha;
+            aa += alpha * alpha, bb += beta * beta, ab += alpha * beta;
+            ax = ax + points[i] * alpha;
+            bx = bx + points[i] * beta;
+        }
+
+        const float det = aa * bb - ab * ab;
+        if (std::abs(det) < 1e-6f)
+            return false;
+
+        a = Clamp255((ax * bb - bx * ab) * (1.0f / det));
+        b = Clamp255((bx * aa - ax * ab) * (1.0f / det));
+        return true;
+    }
+
+    void FitRange(const Vec3* points, int count, Vec3& a, Vec3& b)
+    {
+        Vec3 lo{255, 255, 255};
+        Vec3 hi{0, 0, 0};
+        Vec3 mean{0, 0, 0};
+        for (int i = 0; i < count; i++)
+        {
+            lo = {std::min(lo.r, points[i].r), std::min(lo.g, points[i].g), std::min(lo.b, points[i].b)};
+            hi = {std::max(hi.r, points[i].r), std::max(hi.g, points[i].g), std::max(hi.b, points[i].b)};
+            mean = mean + points[i];
+        }
+        mean = mean * (1.0f / count);
+
+        // Pull the corners in a little, the extremes are rarely worth an endpoint of their own
+        const Vec3 inset = (hi - lo) * (1.0f / 16.0f);
+        lo = lo + inset;
+        hi = hi - inset;
+
+        // Pick the box diagonal the colours lie along
+        float rg = 0, bg = 0;
+        for (int i = 0; i < count; i++)
+        {
+            const Vec3 d = points[i] - mean;
+            rg += d.r * d.g;
+            bg += d.b * d.g;
+        }
+        if (rg < 0)
+            std::swap(lo.r, hi.r);
+        if (bg < 0)
+            std::swap(lo.b, hi.b);
+
+        a = hi;
+        b = lo;
+    }
+
+    void FitPrincipalAxis(const Vec3* points, int count, bool threeColor, Vec3& a, Vec3& b)
+    {
+        const Vec3 axis = PrincipalAxis(points, count);
+        int minIndex = 0;
+        int maxIndex = 0;
+        float minT = FLT_MAX;
+        float maxT = -FLT_MAX;
+        for (int i = 0; i < count; i++)
+        {
+            const float t = points[i].Dot(axis);
+            if (t < minT)
+                minT = t, minIndex = i;
+            if (t > maxT)
+                maxT = t, maxIndex = i;
+        }
+
+        a = points[maxIndex];
+        b = points[minIndex];
+        if (maxT - minT < 1e-3f)
+            return;
+
+        // One least squares pass with the indices the extremes give
+        const int steps = threeColor ? 2 : 3;
+        float weights[16];
+        for (int i = 0; i < count; i++)
+        {
+            const float t = (points[i].Dot(axis) - minT) / (maxT - minT);
+            weights[i] = std::round(t * steps) / steps;
+        }
+
+        Vec3 refinedA, refinedB;
+        if (SolveEndpoints(points, weights, count, refinedA, refinedB))
+        {
+            a = refinedA;
+            b = refinedB;
+        }
+    }
+
+    void FitCluster(const Vec3* points, int count, bool threeColor, Vec3& a, Vec3& b)
+    {
+        const Vec3 axis = PrincipalAxis(points, count);
+
+        // Sorted from the a end of the axis to the b end
+        int order[16];
+        for (int i = 0; i < count; i++)
+            order[i] = i;
+        std::sort(order, order + count, [&](int x, int y) { return points[x].Dot(axis) > points[y].Dot(axis); });
+
+        Vec3 prefix[17];
+        prefix[0] = {0, 0, 0};
+        for (int i = 0; i < count; i++)
+            prefix[i + 1] = prefix[i] + points[order[i]];
+
+        FitPrincipalAxis(points, count, threeColor, a, b);
+        float bestError = FLT_MAX;
+
+        // Every split of the sorted colours into clusters that share an index, the endpoints of
+        // each split solved in closed form from the cluster sums
+        const auto evaluate = [&](float aa, float bb, float ab, const Vec3& ax, const Vec3& bx) {
+            const float det = aa * bb - ab * ab;
+            if (std::abs(det) < 1e-6f)
+                return;
+
+            const Vec3 qa = ToVec3(Quantize((ax * bb - bx * ab) * (1.0f / det)));
+            const Vec3 qb = ToVec3(Quantize((bx * aa - ax * ab) * (1.0f / det)));
+            const float error = aa * qa.Dot(qa) + bb * qb.Dot(qb) + 2 * ab * qa.Dot(qb) - 2 * (qa.Dot(ax) + qb.Dot(bx));
+            if (error < bestError)
+            {
+                bestError = error;
+                a = qa;
+                b = qb;
+            }
+        };
+
+        if (threeColor)
+        {
+            for (int c0 = 0; c0 <= count; c0++)
+            {
+                for (int c1 = 0; c0 + c1 <= count; c1++)
+                {
+                    const int c2 = count - c0 - c1;
+                    const Vec3 s0 = prefix[c0];
+                    const Vec3 s1 = prefix[c0 + c1] - prefix[c0];
+                    const Vec3 s2 = prefix[count] - prefix[c0 + c1];
+                    evaluate(c0 + c1 * 0.25f, c2 + c1 * 0.25f, c1 * 0.25f, s0 + s1 * 0.5f, s2 + s1 * 0.5f);
+                }
+            }
+            return;
+        }
+
+        for (int c0 = 0; c0 <= count; c0++)
+        {
+            for (int c1 = 0; c0 + c1 <= count; c1++)
+            {
+                for (int c2 = 0; c0 + c1 + c2 <= count; c2++)
+                {
+                    const int c3 = count - c0 - c1 - c2;
+                    const Vec3 s0 = prefix[c0];
+                    const Vec3 s1 = prefix[c0 + c1] - prefix[c0];
+                    const Vec3 s2 = prefix[c0 + c1 + c2] - prefix[c0 + c1];
+                    const Vec3 s3 = prefix[count] - prefix[c0 + c1 + c2];
+                    evaluate(c0 + c1 * (4.0f / 9) + c2 * (1.0f / 9), c3 + c1 * (1.0f / 9) + c2 * (4.0f / 9),
+                             (c1 + c2) * (2.0f / 9), s0 + s1 * (2.0f / 3) + s2 * (1.0f / 3),
+                             s3 + s1 * (1.0f / 3) + s2 * (2.0f / 3));
+                }
+            }
+        }
+    }
+
+    void PutColorBlock(uint16_t c0, uint16_t c1, uint32_t indices, uint8_t* out)
+    {
+        out[0] = (uint8_t)c0, out[1] = (uint8_t)(c0 >> 8);
+        out[2] = (uint8_t)c1, out[3] = (uint8_t)(c1 >> 8);
+        out[4] = (uint8_t)indices, out[5] = (uint8_t)(indices >> 8);
+        out[6] = (uint8_t)(indices >> 16), out[7] = (uint8_t)(indices >> 24);
+    }
+
+    // BC1 colour block, also the colour half of BC3. With allowTransparent, texels below AlphaThreshold
+    // switch the block to 3 colour mode, where index 3 is transparent.
+    void EncodeColorBlock(const RGBA block[16], bool allowTransparent, BCQuality quality, uint8_t* out)
+    {
+        Vec3 points[16];
+        bool transparent[16] = {};
+        int count = 0;
+        for (int i = 0; i < 16; i++)
+        {
+            if (allowTransparent && block[i].a < AlphaThreshold)
+                transparent[i] = true;
+            else
+                points[count++] = {(float)block[i].c[2], (float)block[i].c[1], (float)block[i].c[0]};
+        }
+
+        if (count == 0)
+        {
+            PutColorBlock(0, 0, 0xffffffff, out);
+            return;
+        }
+
+        const bool threeColor = count < 16;
+
+        Vec3 a, b;
+        switch (quality)
+        {
+        case BCQuality::Fast:
+            FitRange(points, count, a, b);
+            break;
+        case BCQuality::Normal:
+            FitPrincipalAxis(points, count, threeColor, a, b);
+            break;
+        default:
+            FitCluster(points, count, threeColor, a, b);
+            break;
+        }
+
+        Endpoint e0 = Quantize(a);
+        Endpoint e1 = Quantize(b);
+
+        // 4 colour blocks need c0 > c1, 3 colour blocks c0 <= c1
+        if (threeColor ? e0.packed > e1.packed : e0.packed < e1.packed)
+            std::swap(e0, e1);
+
+        // Same interpolation as the ProcessDXT decoders
+        int palette[4][3] = {{e0.r, e0.g, e0.b}, {e1.r, e1.g, e1.b}};
+        int paletteSize;
+        if (!threeColor && e0.packed != e1.packed)
+        {
+            paletteSize = 4;
+            for (int c = 0; c < 3; c++)
+            {
+                palette[2][c] = (palette[0][c] * 2 + palette[1][c]) / 3;
+                palette[3][c] = (palette[0][c] + palette[1][c] * 2) / 3;
+            }
+        }
+        else
+        {
+            // With c0 == c1 an opaque block is in 3 colour mode too, where all but index 3 work
+            paletteSize = 3;
+            for (int c = 0; c < 3; c++)
+                palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+        }
+
+        uint32_t indices = 0;
+        for (int i = 0; i < 16; i++)
+        {
+            uint32_t index = 3;
+            if (!transparent[i])
+            {
+                const int r = block[i].c[2], g = block[i].c[1], bl = block[i].c[0];
+                int bestError = INT_MAX;
+                for (int p = 0; p < paletteSize; p++)
+                {
+                    const int dr = r - palette[p][0], dg = g - palette[p][1], db = bl - palette[p][2];
+                    const int error = dr * dr + dg * dg + db * db;
+                    if (error < bestError)
+                        bestError = error, index = p;
+                }
+            }
+            indices |= index << (2 * i);
+        }
+
+        PutColorBlock(e0.packed, e1.packed, indices, out);
+    }
+
+    // Error of the best indices for an interpolated (BC3 alpha, BC4/5) block with endpoints e0 and e1.
+    // e0 > e1 is the 8 value mode, otherwise 6 values plus 0 and 255.
+    int FitChannelBlock(const uint8_t values[16], int e0, int e1, uint64_t& indices)
+    {
+        int palette[8] = {e0, e1};
+        if (e0 > e1)
+        {
+            for (int i = 0; i < 6; i++)
+                palette[i + 2] = ((6 - i) * e0 + (i + 1) * e1) / 7;
+        }
+        else
+        {
+            for (int i = 0; i < 4; i++)
+                palette[i + 2] = ((4 - i) * e0 + (i + 1) * e1) / 5;
+            palette[6] = 0;
+            palette[7] = 255;
+        }
+
+        int total = 0;
+        indices = 0;
+        for (int i = 0; i < 16; i++)
+        {
+            int best = 0;
+            int bestError = INT_MAX;
+            for (int p = 0; p < 8; p++)
+            {
+                const int d = values[i] - palette[p];
+                if (d * d < bestError)
+                    bestError = d * d, best = p;
+            }
+            total += bestError;
+            indices |= (uint64_t)best << (3 * i);
+        }
+        return total;
+    }
+
+    void EncodeChannelBlock(const uint8_t values[16], BCQuality quality, uint8_t* out)
+    {
+        int lo = 255, hi = 0;
+        int innerLo = 255, innerHi = 0; // Ignoring 0 and 255, which the 6 value mode has for free
+        for (int i = 0; i < 16; i++)
+        {
+            lo = std::min<int>(lo, values[i]);
+            hi = std::max<int>(hi, values[i]);
+            if (values[i] != 0 && values[i] != 255)
+            {
+                innerLo = std::min<int>(innerLo, values[i]);
+                innerHi = std::max<int>(innerHi, values[i]);
+            }
+        }
+        if (innerLo > innerHi)
+            innerLo = innerHi = lo;
+
+        int bestE0 = hi, bestE1 = lo;
+        uint64_t bestIndices;
+        int bestError = FitChannelBlock(values, hi, lo, bestIndices);
+
+        const auto tryEndpoints = [&](int e0, int e1) {
+            uint64_t indices;
+            const int error = FitChannelBlock(values, e0, e1, indices);
+            if (error < bestError)
+                bestError = error, bestE0 = e0, bestE1 = e1, bestIndices = indices;
+        };
+
+        if (quality != BCQuality::Fast && bestError > 0)
+        {
+            tryEndpoints(innerLo, innerHi);
+
+            if (quality == BCQuality::High)
+            {
+                // Pull the endpoints of both modes in a little
+                for (int d0 = 0; d0 <= 3; d0++)
+                {
+                    for (int d1 = 0; d1 <= 3; d1++)
+                    {
+                        if (hi - d0 > lo + d1)
+                            tryEndpoints(hi - d0, lo + d1);
+                        if (innerLo + d0 <= innerHi - d1)
+                            tryEndpoints(innerLo + d0, innerHi - d1);
+                    }
+                }
+            }
+        }
+
+        out[0] = (uint8_t)bestE0;
+        out[1] = (uint8_t)bestE1;
+        for (int i = 0; i < 6; i++)
+            out[2 + i] = (uint8_t)(bestIndices >> (8 * i));
+    }
+
+    void EncodeBlock(const RGBA block[16], BCEncodeFormat format, BCQuality quality, uint8_t* out)
+    {
+        uint8_t values[16];
+        switch (format)
+        {
+        case BCEncodeFormat::BC1:
+            EncodeColorBlock(block, true, quality, out);
+            break;
+        case BCEncodeFormat::BC3:
+            for (int i = 0; i < 16; i++)
+                values[i] = block[i].a;
+            EncodeChannelBlock(values, quality, out);
+            EncodeColorBlock(block, false, quality, out + 8);
+            break;
+        case BCEncodeFormat::BC5:
+            for (int i = 0; i < 16; i++)
+                values[i] = block[i].c[2];
+            EncodeChannelBlock(values, quality, out);
+            for (int i = 0; i < 16; i++)
+                values[i] = block[i].c[1];
+            EncodeChannelBlock(values, quality, out + 8);
+            break;
+        }
+    }
+
+    void EncodeBlockRows(const RGBA* texels, int width, int height, BCEncodeFormat format, BCQuality quality,
+                         uint8_t* out, int firstRow, int lastRow)
+    {
+        const int blocksWide = (width + 3) / 4;
+        const size_t blockSize = GetBCBlockSize(format);
+        RGBA block[16];
+        for (int by = firstRow; by < lastRow; by++)
+        {
+            uint8_t* row = out + (size_t)by * blocksWide * blockSize;
+            for (int bx = 0; bx < blocksWide; bx++)
+            {
+                LoadBlock(texels, width, height, bx, by, block);
+                EncodeBlock(block, format, quality, row + bx * blockSize);
+            }
+        }
+    }
+
+    // Queues the block rows of one image on tasks in jobs of about JobBlocks blocks
+    void RunBlockRowJobs(TaskGroup& tasks, const RGBA* texels, int width, int height, BCEncodeFormat format,
+                         BCQuality quality, uint8_t* out)
+    {
+        const int blocksWide = (width + 3) / 4;
+        const int blocksHigh = (height + 3) / 4;
+        const int jobRows = (int)std::max<size_t>(1, JobBlocks / blocksWide);
+        for (int firstRow = 0; firstRow < blocksHigh; firstRow += jobRows)
+        {
+            const int lastRow = std::min(firstRow + jobRows, blocksHigh);
+            tasks.run([=] { EncodeBlockRows(texels, width, height, format, quality, out, firstRow, lastRow); });
+        }
+    }
+}
+
+size_t GetBCBlockSize(BCEncodeFormat format)
+{
+    return format == BCEncodeFormat::BC1 ? 8 : 16;
+}
+
+size_t GetBCEncodedSize(BCEncodeFormat format, int width, int height)
+{
+    if (width <= 0 || height <= 0)
+        return 0;
+    return (size_t)((width + 3) / 4) * ((height + 3) / 4) * GetBCBlockSize(format);
+}
+
+void EncodeBC(const RGBA* texels, int width, int height, BCEncodeFormat format, BCQuality quality, uint8_t* out)
+{
+    if (!texels || width <= 0 || height <= 0)
+        return;
+
+    const int blocksHigh = (height + 3) / 4;
+    if ((size_t)((width + 3) / 4) * blocksHigh < ParallelBlockCount)
+    {
+        EncodeBlockRows(texels, width, height, format, quality, out, 0, blocksHigh);
+        return;
+    }
+
+    TaskGroup tasks;
+    RunBlockRowJobs(tasks, texels, width, height, format, quality, out);
+    tasks.wait();
+}
+
+BCMipChain EncodeBCMipChain(const MipChain& chain, BCEncodeFormat format, BCQuality quality)
+{
+    BCMipChain result;
+    size_t totalSize = 0;
+    size_t totalBlocks = 0;
+    for (const MipLevel& level : chain.levels)
+    {
+        result.levelOffsets.push_back(totalSize);
+        totalSize += GetBCEncodedSize(format, level.width, level.height);
+        totalBlocks += (size_t)((level.width + 3) / 4) * ((level.height + 3) / 4);
+    }
+    result.blocks.resize(totalSize);
+
+    if (totalBlocks < ParallelBlockCount)
+    {
+        for (size_t i = 0; i < chain.levels.size(); i++)
+        {
+            const MipLevel& level = chain.levels[i];
+            EncodeBlockRows(chain.texels.data() + level.offset, level.width, level.height, format, quality,
+                            result.blocks.data() + result.levelOffsets[i], 0, (level.height + 3) / 4);
+        }
+        return result;
+    }
+
+    TaskGroup tasks;
+    for (size_t i = 0; i < chain.levels.size(); i++)
+    {
+        const MipLevel& level = chain.levels[i];
+        RunBlockRowJobs(tasks, chain.texels.data() + level.offset, level.width, level.height, format, quality,
+                        result.blocks.data() + result.levelOffsets[i]);
+    }
+    tasks.wait();
+
+    return result;
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include "AtexReader.h"
+#include "MipChain.h"
+#include <vector>
+
+// Block compressed formats BCEncoder can write. BC5 stores the red and green channels, for normal maps.
+enum class BCEncodeFormat
+{
+    BC1, // 8 bytes per block, colour with 1 bit alpha
+    BC3, // 16 bytes per block, colour and interpolated alpha
+    BC5  // 16 bytes per block, two interpolated channels
+};
+
+// How hard the encoder searches for the endpoints of each block
+enum class BCQuality
+{
+    Fast,   // Range fit: the corners of the colour bounding box
+    Normal, // Principal axis range fit refined by least squares
+    High    // Cluster fit: every ordering of the block's colours along the principal axis
+};
+
+// The encoded blocks of every level of a MipChain, back to back
+struct BCMipChain
+{
+    std::vector<uint8_t> blocks;
+    std::vector<size_t> levelOffsets; // Offset of each level's first block in blocks
+};
+
+size_t GetBCBlockSize(BCEncodeFormat format);
+
+// Bytes in the blocks of a width * height image, the partial blocks at the right and bottom edges included
+size_t GetBCEncodedSize(BCEncodeFormat format, int width, int height);
+
+// Encodes a width * height image of B8G8R8A8 texels (the DatTexture layout) to rows of 4x4 blocks in out,
+// which must hold GetBCEncodedSize bytes. Edge blocks repeat the last row and column. Large images are
+// encoded in bands of block rows on the TaskPool. Doesn't use D3D.
+void EncodeBC(const RGBA* texels, int width, int height, BCEncodeFormat format, BCQuality quality, uint8_t* out);
+
+// Encodes every level of chain, the blocks of all levels spread over the TaskPool together
+BCMipChain EncodeBCMipChain(const MipChain& chain, BCEncodeFormat format, BCQuality quality);
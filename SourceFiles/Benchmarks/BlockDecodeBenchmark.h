@@ -0,0 +1,174 @@
+#pragma once
+
+#include "../GWUnpacker.h"
+#include "../xentax.h"
+#include "../AtexDecompress.h"
+#include "../AtexReader.h"
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace GW::Benchmarks {
+
+/**
+ * @brief Results of RunBlockDecodeBenchmark for one block format.
+ */
+struct BlockDecodeFormatResult
+{
+    uint32_t textures = 0;
+    uint32_t mismatches = 0;         // Textures where the two decoders disagree, should always be 0
+    uint64_t texels = 0;
+    double blockSeconds = 0.0;       // ProcessDXT1/3/5
+    double referenceSeconds = 0.0;   // ProcessDXT1/3/5Reference
+
+    double BlockMTexelsPerSecond() const { return blockSeconds > 0.0 ? texels / blockSeconds / 1e6 : 0.0; }
+    double ReferenceMTexelsPerSecond() const { return referenceSeconds > 0.0 ? texels / referenceSeconds / 1e6 : 0.0; }
+};
+
+/**
+ * @brief Results of RunBlockDecodeBenchmark, indexed by BlockDecodeFormat.
+ */
+enum BlockDecodeFormat
+{
+    BlockDecodeBC1,
+    BlockDecodeBC2,
+    BlockDecodeBC3,
+    BlockDecodeFormatCount
+};
+
+using BlockDecodeBenchmarkResult = std::array<BlockDecodeFormatResult, BlockDecodeFormatCount>;
+
+inline const char* GetBlockDecodeFormatName(int format)
+{
+    static constexpr const char* names[] = { "BC1 (DXT1)", "BC2 (DXT3)", "BC3 (DXT5)" };
+    return format >= 0 && format < BlockDecodeFormatCount ? names[format] : "";
+}
+
+/**
+ * @brief Decodes the ATEX/ATTX textures of a memory-mapped DAT with both the block decoders and
+ * the original texel at a time decoders, timing each and checking that the output is identical.
+ *
+ * Only the BC1/BC2/BC3 decode step is timed, the ATEX decompression that produces the block
+ * stream runs once per texture outside of the timed region.
+ *
+ * @param dat DAT that has been read with readDat and mapped with mapDat.
+ * @param maxTextures Stop after this many textures, 0 for all of them.
+ * @param repetitions Number of times each texture is decoded by each decoder.
+ */
+inline BlockDecodeBenchmarkResult RunBlockDecodeBenchmark(GWDat& dat, uint32_t maxTextures = 0, int repetitions = 1)
+{
+    using Clock = std::chrono::steady_clock;
+    using Decoder = std::vector<RGBA> (*)(const unsigned char*, int, int);
+
+    BlockDecodeBenchmarkResult result{};
+    if (!dat.isMapped())
+        return result;
+
+    uint32_t texturesDecoded = 0;
+    std::vector<unsigned char> file;
+    std::vector<RGBA> blocks;
+
+    for (unsigned int i = 0; i < dat.getNumFiles(); i++)
+    {
+        if (maxTextures && texturesDecoded >= maxTextures)
+            break;
+
+        const std::span<const uint8_t> compressed = dat.getCompressedView(i);
+        if (compressed.size() < 12)
+            continue;
+
+        if (dat[i].a)
+        {
+            if (!UnpackGWDat(compressed.data(), (int)compressed.size(), file))
+                continue;
+        }
+        else
+        {
+            file.assign(compressed.begin(), compressed.end());
+        }
+
+        if (file.size() < 12)
+            continue;
+
+        // Same checks and AtexDecompress formats as ProcessImageFile
+        const unsigned int id1 = ((const unsigned int*)file.data())[0];
+        const unsigned int id2 = ((const unsigned int*)file.data())[1];
+        if ((id1 != 'XTTA' && id1 != 'XETA') || (id2 & 0xffffff) != 'TXD')
+            continue;
+
+        int format;
+        unsigned int imageformat;
+        Decoder block;
+        Decoder reference;
+        switch (id2 >> 24)
+        {
+        case '1':
+            format = BlockDecodeBC1, imageformat = 0xf, block = ProcessDXT1, reference = ProcessDXT1Reference;
+            break;
+        case '2':
+        case '3':
+        case 'N':
+            format = BlockDecodeBC2, imageformat = 0x11, block = ProcessDXT3, reference = ProcessDXT3Reference;
+            break;
+        case '4':
+        case '5':
+            format = BlockDecodeBC3, imageformat = 0x13, block = ProcessDXT5, reference = ProcessDXT5Reference;
+            break;
+        case 'L':
+            format = BlockDecodeBC3, imageformat = 0x12, block = ProcessDXT5, reference = ProcessDXT5Reference;
+            break;
+        default:
+            continue;
+        }
+
+        SImageDescriptor r;
+        r.xres = *(unsigned short*)(file.data() + 8);
+        r.yres = *(unsigned short*)(file.data() + 10);
+        r.Data = file.data();
+        r.imageformat = 0xf;
+        r.a = (int)file.size();
+        r.b = 6;
+        r.c = 0;
+        if (r.xres < 4 || r.yres < 4)
+            continue;
+
+        blocks.assign((size_t)r.xres * r.yres, RGBA{});
+        r.image = (unsigned char*)blocks.data();
+        AtexDecompress((unsigned int*)file.data(), (unsigned int)file.size(), imageformat, r, (unsigned int*)blocks.data());
+
+        auto& formatResult = result[format];
+        std::vector<RGBA> blockImage;
+        std::vector<RGBA> referenceImage;
+
+        for (int rep = 0; rep < repetitions; rep++)
+        {
+            const auto start = Clock::now();
+            referenceImage = reference((const unsigned char*)blocks.data(), r.xres, r.yres);
+            formatResult.referenceSeconds += std::chrono::duration<double>(Clock::now() - start).count();
+        }
+
+        for (int rep = 0; rep < repetitions; rep++)
+        {
+            const auto start = Clock::now();
+            blockImage = block((const unsigned char*)blocks.data(), r.xres, r.yres);
+            formatResult.blockSeconds += std::chrono::duration<double>(Clock::now() - start).count();
+        }
+
+        if (blockImage.size() != referenceImage.size() ||
+            std::memcmp(blockImage.data(), referenceImage.data(), blockImage.size() * sizeof(RGBA)) != 0)
+        {
+            formatResult.mismatches++;
+        }
+
+        formatResult.textures++;
+        formatResult.texels += (uint64_t)r.xres * r.yres * repetitions;
+        texturesDecoded++;
+    }
+
+    return result;
+}
+
+} // namespace GW::Benchmarks
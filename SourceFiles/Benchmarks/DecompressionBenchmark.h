@@ -0,0 +1,107 @@
+#pragma once
+
+#include "../GWUnpacker.h"
+#include "../xentax.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+namespace GW::Benchmarks {
+
+/**
+ * @brief Results of RunDecompressionBenchmark.
+ */
+struct DecompressionBenchmarkResult
+{
+    uint32_t filesDecoded = 0;
+    uint32_t mismatches = 0;         // Files where the two decoders disagree, should always be 0
+    uint64_t compressedBytes = 0;
+    uint64_t decompressedBytes = 0;
+    double fastSeconds = 0.0;        // UnpackGWDat
+    double referenceSeconds = 0.0;   // UnpackGWDatReference
+
+    double FastMBps() const { return fastSeconds > 0.0 ? decompressedBytes / fastSeconds / (1024.0 * 1024.0) : 0.0; }
+    double ReferenceMBps() const
+    {
+        return referenceSeconds > 0.0 ? decompressedBytes / referenceSeconds / (1024.0 * 1024.0) : 0.0;
+    }
+};
+
+/**
+ * @brief Decompresses the compressed entries of a memory-mapped DAT with both the table
+ * driven and the original decoder, timing each and checking that the output is identical.
+ *
+ * @param dat DAT that has been read with readDat and mapped with mapDat.
+ * @param maxFiles Stop after this many compressed entries, 0 for all of them.
+ * @param repetitions Number of times each file is decoded by each decoder.
+ */
+inline DecompressionBenchmarkResult RunDecompressionBenchmark(GWDat& dat, uint32_t maxFiles = 0,
+                                                              int repetitions = 1)
+{
+    using Clock = std::chrono::steady_clock;
+
+    DecompressionBenchmarkResult result;
+    if (!dat.isMapped())
+        return result;
+
+    for (unsigned int i = 0; i < dat.getNumFiles(); i++)
+    {
+        if (maxFiles && result.filesDecoded >= maxFiles)
+            break;
+
+        // Only compressed entries (a != 0) go through the Huffman decoder
+        if (dat[i].a == 0)
+            continue;
+
+        const std::span<const uint8_t> compressed = dat.getCompressedView(i);
+        if (compressed.size() < 12)
+            continue;
+
+        const unsigned char* input = compressed.data();
+        const int insize = (int)compressed.size();
+
+        unsigned char* fast = nullptr;
+        unsigned char* reference = nullptr;
+        int fastSize = 0;
+        int referenceSize = 0;
+
+        for (int r = 0; r < repetitions; r++)
+        {
+            delete[] reference;
+            const auto start = Clock::now();
+            UnpackGWDatReference(input, insize, reference, referenceSize);
+            result.referenceSeconds += std::chrono::duration<double>(Clock::now() - start).count();
+        }
+
+        for (int r = 0; r < repetitions; r++)
+        {
+            delete[] fast;
+            const auto start = Clock::now();
+            UnpackGWDat(input, insize, fast, fastSize);
+            result.fastSeconds += std::chrono::duration<double>(Clock::now() - start).count();
+        }
+
+        if ((fast == nullptr) != (reference == nullptr) || fastSize != referenceSize ||
+            (fast && std::memcmp(fast, reference, fastSize) != 0))
+        {
+            result.mismatches++;
+        }
+
+        if (reference)
+        {
+            result.compressedBytes += (uint64_t)insize * repetitions;
+            result.decompressedBytes += (uint64_t)referenceSize * repetitions;
+        }
+        result.filesDecoded++;
+
+        delete[] fast;
+        delete[] reference;
+    }
+
+    return result;
+}
+
+} // namespace GW::Benchmarks
@@ -0,0 +1,283 @@
+#pragma once
+
+#include "../AtexDecompress.h"
+#include "../AtexReader.h"
+#include "../MurmurHash3.h"
+#include "../TextureManager.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace GW::Benchmarks {
+
+/**
+ * @brief Texture formats reported by RunTextureDecodeBenchmark, the ATEX/ATTX compression types
+ * plus DDS.
+ */
+enum TextureDecodeFormat
+{
+    TextureDecodeDXT1,
+    TextureDecodeDXT3, // DXT2 and DXT3
+    TextureDecodeDXT5, // DXT4 and DXT5
+    TextureDecodeDXTL,
+    TextureDecodeDXTN,
+    TextureDecodeDXTA,
+    TextureDecodeDDS,
+    TextureDecodeFormatCount
+};
+
+inline const char* GetTextureDecodeFormatName(int format)
+{
+    static constexpr const char* names[] = { "DXT1", "DXT3", "DXT5", "DXTL", "DXTN", "DXTA", "DDS" };
+    return format >= 0 && format < TextureDecodeFormatCount ? names[format] : "";
+}
+
+/**
+ * @brief Results of RunTextureDecodeBenchmark for one format.
+ */
+struct TextureDecodeFormatResult
+{
+    uint32_t textures = 0;
+    uint32_t failed = 0;                // Files ProcessImageFile or the DDS decoder returned nothing for
+    uint64_t inputBytes = 0;            // Size of the blobs, times the repetitions
+    uint64_t texels = 0;
+    double decodeSeconds = 0.0;         // ProcessImageFile, or DecodeDDSTexture for DDS
+    double decompressSeconds = 0.0;     // ProcessImageFileBlocks, the AtexDecompress step of ProcessImageFile
+    double blockDecodeSeconds = 0.0;    // ProcessDXT1/3/5 on the blocks from ProcessImageFileBlocks
+
+    double MBps() const { return decodeSeconds > 0.0 ? inputBytes / decodeSeconds / (1024.0 * 1024.0) : 0.0; }
+    double TexturesPerSecond(int repetitions) const
+    {
+        return decodeSeconds > 0.0 ? (double)textures * repetitions / decodeSeconds : 0.0;
+    }
+};
+
+/**
+ * @brief Results of RunTextureDecodeBenchmark.
+ */
+struct TextureDecodeBenchmarkResult
+{
+    std::array<TextureDecodeFormatResult, TextureDecodeFormatCount> formats{};
+    uint32_t skipped = 0;               // Files that aren't ATEX, ATTX or DDS
+    uint32_t goldenMatches = 0;
+    uint32_t goldenMismatches = 0;      // Decoded output differs from the manifest or no longer decodes, should always be 0
+    uint32_t goldenMissing = 0;         // Textures that aren't in the manifest
+    uint32_t goldenNotFound = 0;        // Manifest entries with no texture file in the directory
+    bool manifestRead = false;          // False if the manifest couldn't be opened when checking against it
+    bool manifestWritten = false;
+};
+
+/**
+ * @brief Hash of a decoded texture as stored in the golden manifest.
+ */
+inline uint32_t HashDecodedTexture(const DatTexture& texture)
+{
+    uint32_t hash = 0;
+    MurmurHash3_x86_32(texture.rgba_data.data(), (int)(texture.rgba_data.size() * sizeof(RGBA)),
+                       (uint32_t)texture.width << 16 | (uint32_t)texture.height, &hash);
+    return hash;
+}
+
+/**
+ * @brief Format of a raw decompressed DAT entry, -1 if it isn't a texture.
+ */
+inline int GetTextureDecodeFormat(const std::vector<unsigned char>& blob)
+{
+    if (blob.size() < 12)
+        return -1;
+
+    const unsigned int id1 = ((const unsigned int*)blob.data())[0];
+    const unsigned int id2 = ((const unsigned int*)blob.data())[1];
+    if (id1 == ' SDD')
+        return TextureDecodeDDS;
+    if ((id1 != 'XTTA' && id1 != 'XETA') || (id2 & 0xffffff) != 'TXD')
+        return -1;
+
+    switch (id2 >> 24)
+    {
+    case '1': return TextureDecodeDXT1;
+    case '2':
+    case '3': return TextureDecodeDXT3;
+    case '4':
+    case '5': return TextureDecodeDXT5;
+    case 'L': return TextureDecodeDXTL;
+    case 'N': return TextureDecodeDXTN;
+    case 'A': return TextureDecodeDXTA;
+    default: return -1;
+    }
+}
+
+/**
+ * @brief Decodes every ATEX/ATTX/DDS blob in a directory, such as the files written by
+ * DATManager::save_raw_decompressed_data_to_file, and times each step of the texture path.
+ *
+ * The decoded texels of each file are hashed and compared with the golden manifest in the
+ * directory (golden_manifest.txt, one "<file name> <width> <height> <hash>" line per texture).
+ * With writeManifest the manifest is written from this run instead, to record a known good
+ * decoder before changing it. A manifest texture that fails to decode counts as a mismatch.
+ *
+ * @param directory Directory searched recursively for blobs.
+ * @param repetitions Number of times each step is run on each file.
+ * @param writeManifest Replace the manifest with the hashes of this run.
+ */
+inline TextureDecodeBenchmarkResult RunTextureDecodeBenchmark(const std::filesystem::path& directory,
+                                                              int repetitions = 1, bool writeManifest = false)
+{
+    using Clock = std::chrono::steady_clock;
+
+    TextureDecodeBenchmarkResult result;
+    const std::filesystem::path manifestPath = directory / "golden_manifest.txt";
+
+    struct GoldenEntry
+    {
+        int width;
+        int height;
+        uint32_t hash;
+    };
+
+    std::map<std::string, GoldenEntry> golden;
+    if (!writeManifest)
+    {
+        std::ifstream manifest(manifestPath);
+        result.manifestRead = manifest.is_open();
+        std::string line;
+        while (std::getline(manifest, line))
+        {
+            std::istringstream fields(line);
+            std::string name;
+            GoldenEntry entry;
+            if (fields >> name >> entry.width >> entry.height >> std::hex >> entry.hash)
+                golden[name] = entry;
+        }
+    }
+
+    // Sorted so the manifest is stable between runs
+    std::vector<std::filesystem::path> files;
+    std::error_code ec;
+    for (const auto& item : std::filesystem::recursive_directory_iterator(directory, ec))
+    {
+        if (item.is_regular_file(ec) && item.path() != manifestPath)
+            files.push_back(item.path());
+    }
+    std::sort(files.begin(), files.end());
+
+    std::map<std::string, GoldenEntry> written;
+    std::set<std::string> seen;
+    std::vector<unsigned char> blob;
+
+    for (const auto& path : files)
+    {
+        std::ifstream file(path, std::ios::binary);
+        blob.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+
+        const int format = GetTextureDecodeFormat(blob);
+        if (format < 0)
+        {
+            result.skipped++;
+            continue;
+        }
+
+        auto& formatResult = result.formats[format];
+        DatTexture texture{};
+
+        for (int rep = 0; rep < repetitions; rep++)
+        {
+            const auto start = Clock::now();
+            if (format == TextureDecodeDDS)
+            {
+                texture = DatTexture{};
+                DecodeDDSTexture(blob.data(), blob.size(), texture);
+            }
+            else
+            {
+                texture = ProcessImageFile(blob.data(), (int)blob.size());
+            }
+            formatResult.decodeSeconds += std::chrono::duration<double>(Clock::now() - start).count();
+        }
+
+        if (format != TextureDecodeDDS)
+        {
+            DatCompressedTexture blocks;
+            for (int rep = 0; rep < repetitions; rep++)
+            {
+                const auto start = Clock::now();
+                blocks = ProcessImageFileBlocks(blob.data(), (int)blob.size());
+                formatResult.decompressSeconds += std::chrono::duration<double>(Clock::now() - start).count();
+            }
+
+            if (blocks.width > 0 && !blocks.blocks.empty())
+            {
+                for (int rep = 0; rep < repetitions; rep++)
+                {
+                    const auto start = Clock::now();
+                    switch (blocks.block_format)
+                    {
+                    case BlockFormat::BC1: ProcessDXT1(blocks.blocks.data(), blocks.width, blocks.height); break;
+                    case BlockFormat::BC2: ProcessDXT3(blocks.blocks.data(), blocks.width, blocks.height); break;
+                    case BlockFormat::BC3: ProcessDXT5(blocks.blocks.data(), blocks.width, blocks.height); break;
+                    }
+                    formatResult.blockDecodeSeconds += std::chrono::duration<double>(Clock::now() - start).count();
+                }
+            }
+        }
+
+        const std::string name = std::filesystem::relative(path, directory, ec).generic_string();
+        seen.insert(name);
+
+        if (texture.width <= 0 || texture.height <= 0)
+        {
+            formatResult.failed++;
+            // It decoded when the manifest was written
+            if (!writeManifest && golden.contains(name))
+                result.goldenMismatches++;
+            continue;
+        }
+
+        formatResult.textures++;
+        formatResult.inputBytes += (uint64_t)blob.size() * repetitions;
+        formatResult.texels += (uint64_t)texture.width * texture.height * repetitions;
+
+        const GoldenEntry entry{texture.width, texture.height, HashDecodedTexture(texture)};
+
+        if (writeManifest)
+        {
+            written[name] = entry;
+            continue;
+        }
+
+        const auto it = golden.find(name);
+        if (it == golden.end())
+            result.goldenMissing++;
+        else if (it->second.width != entry.width || it->second.height != entry.height || it->second.hash != entry.hash)
+            result.goldenMismatches++;
+        else
+            result.goldenMatches++;
+    }
+
+    for (const auto& [name, entry] : golden)
+    {
+        if (!seen.contains(name))
+            result.goldenNotFound++;
+    }
+
+    if (writeManifest)
+    {
+        std::ofstream manifest(manifestPath, std::ios::trunc);
+        for (const auto& [name, entry] : written)
+            manifest << name << ' ' << entry.width << ' ' << entry.height << ' ' << std::hex << entry.hash << std::dec << '\n';
+        result.manifestWritten = (bool)manifest;
+    }
+
+    return result;
+}
+
+} // namespace GW::Benchmarks
@@ -1,5 +1,7 @@
 #include "pch.h"
 #include "DATManager.h"
+#include "TextureDiskCache.h"
+#include "xentax.h"
 
 FFNA_MapFile DATManager::parse_ffna_map_file(int index)
 {
@@ -8,10 +10,8 @@ FFNA_MapFile DATManager::parse_ffna_map_file(int index)
         throw "mft_entry not found.";
 
     // Get decompressed file data
-    HANDLE file_handle = m_dat.get_dat_filehandle(m_dat_filepath.c_str());
-    auto data = m_dat.readFile(file_handle, index, true);
+    auto data = read_file(index);
     std::span<unsigned char> file_data(data, mft_entry->uncompressedSize);
-    CloseHandle(file_handle);
 
     FFNA_MapFile ffna_map_file(0, file_data);
     delete[] data;
@@ -19,6 +19,15 @@ FFNA_MapFile DATManager::parse_ffna_map_file(int index)
     return ffna_map_file;
 }
 
+FFNA_MapFileView DATManager::parse_ffna_map_file_view(int index)
+{
+    std::vector<unsigned char> data;
+    if (! read_file(index, data))
+        throw "mft_entry not found.";
+
+    return FFNA_MapFileView(0, std::move(data));
+}
+
 FFNA_ModelFile DATManager::parse_ffna_model_file(int index)
 {
     MFTEntry* mft_entry = m_dat.get_MFT_entry_ptr(index);
@@ -26,10 +35,8 @@ FFNA_ModelFile DATManager::parse_ffna_model_file(int index)
         throw "mft_entry not found.";
 
     // Get decompressed file data
-    HANDLE file_handle = m_dat.get_dat_filehandle(m_dat_filepath.c_str());
-    auto data = m_dat.readFile(file_handle, index, true);
+    auto data = read_file(index);
     std::span<unsigned char> file_data(data, mft_entry->uncompressedSize);
-    CloseHandle(file_handle);
 
     FFNA_ModelFile ffna_model_file(0, file_data);
     delete[] data;
@@ -44,10 +51,8 @@ FFNA_ModelFile_Other DATManager::parse_ffna_model_file_other(int index)
         throw "mft_entry not found.";
 
     // Get decompressed file data
-    HANDLE file_handle = m_dat.get_dat_filehandle(m_dat_filepath.c_str());
-    auto data = m_dat.readFile(file_handle, index, true);
+    auto data = read_file(index);
     std::span<unsigned char> file_data(data, mft_entry->uncompressedSize);
-    CloseHandle(file_handle);
 
     FFNA_ModelFile_Other ffna_model_file_other(0, file_data);
     delete[] data;
@@ -62,10 +67,8 @@ bool DATManager::is_other_model_format(int index)
         return false;
 
     // Get decompressed file data
-    HANDLE file_handle = m_dat.get_dat_filehandle(m_dat_filepath.c_str());
-    auto data = m_dat.readFile(file_handle, index, true);
+    auto data = read_file(index);
     std::span<unsigned char> file_data(data, mft_entry->uncompressedSize);
-    CloseHandle(file_handle);
 
     bool is_other = IsOtherModelFormat(file_data);
     delete[] data;
@@ -80,10 +83,8 @@ AMAT_file DATManager::parse_amat_file(int index)
         throw "mft_entry not found.";
 
     // Get decompressed file data
-    HANDLE file_handle = m_dat.get_dat_filehandle(m_dat_filepath.c_str());
-    auto data = m_dat.readFile(file_handle, index, true);
+    auto data = read_file(index);
     std::span<unsigned char> file_data(data, mft_entry->uncompressedSize);
-    CloseHandle(file_handle);
 
     AMAT_file amat_file(file_data.data(), file_data.size());
     delete[] data;
@@ -97,20 +98,69 @@ DatTexture DATManager::parse_ffna_texture_file(int index)
     if (! mft_entry)
         throw "mft_entry not found.";
 
+    // A texture decoded in an earlier session is read back from the disk cache. When murmurhash3 is
+    // already known (loaded index or an earlier read) the file doesn't even need to be decompressed.
+    auto& texture_cache = TextureDiskCache::shared();
+    uint32_t hash = m_dat.isClassified(index) ? m_dat.getMurmurHash3(index) : 0;
+    if (hash != 0)
+    {
+        if (auto cached = texture_cache.load(hash, mft_entry->uncompressedSize))
+            return std::move(*cached);
+    }
+
     // Get decompressed file data
-    HANDLE file_handle = m_dat.get_dat_filehandle(m_dat_filepath.c_str());
-    auto data = m_dat.readFile(file_handle, index, true);
-    std::span<unsigned char> file_data(data, mft_entry->uncompressedSize);
-    CloseHandle(file_handle);
+    std::vector<unsigned char> data;
+    if (! read_file(index, data) || data.size() < 12)
+        return DatTexture();
 
-    // Process texture data
-    auto dat_texture = ProcessImageFile(file_data.data(), mft_entry->uncompressedSize);
+    if (hash == 0)
+    {
+        hash = m_dat.getMurmurHash3(index);
+        if (auto cached = texture_cache.load(hash, (uint32_t)data.size()))
+            return std::move(*cached);
+    }
 
-    delete[] data;
+    // Process texture data. Extraction and icon export decode thousands of textures on the same
+    // workers, the block stream buffer is kept per thread instead of allocated for each one.
+    static thread_local std::vector<unsigned char> scratch;
+    DatTexture dat_texture{};
+    ProcessImageFile(data.data(), (int)data.size(), dat_texture, scratch);
+    texture_cache.store(hash, (uint32_t)data.size(), dat_texture);
 
     return dat_texture;
 }
 
+DatCompressedTexture DATManager::parse_ffna_texture_blocks(int index)
+{
+    MFTEntry* mft_entry = m_dat.get_MFT_entry_ptr(index);
+    if (! mft_entry)
+        return DatCompressedTexture();
+
+    auto& texture_cache = TextureDiskCache::shared();
+    uint32_t hash = m_dat.isClassified(index) ? m_dat.getMurmurHash3(index) : 0;
+    if (hash != 0)
+    {
+        if (auto cached = texture_cache.load_blocks(hash, mft_entry->uncompressedSize))
+            return std::move(*cached);
+    }
+
+    std::vector<unsigned char> data;
+    if (! read_file(index, data) || data.size() < 12)
+        return DatCompressedTexture();
+
+    if (hash == 0)
+    {
+        hash = m_dat.getMurmurHash3(index);
+        if (auto cached = texture_cache.load_blocks(hash, (uint32_t)data.size()))
+            return std::move(*cached);
+    }
+
+    auto texture = ProcessImageFileBlocks(data.data(), (int)data.size());
+    texture_cache.store_blocks(hash, (uint32_t)data.size(), texture);
+
+    return texture;
+}
+
 std::vector<uint8_t> DATManager::parse_dds_file(int index)
 {
     MFTEntry* mft_entry = m_dat.get_MFT_entry_ptr(index);
@@ -118,10 +168,14 @@ std::vector<uint8_t> DATManager::parse_dds_file(int index)
         throw "mft_entry not found.";
 
     // Get decompressed file data
-    HANDLE file_handle = m_dat.get_dat_filehandle(m_dat_filepath.c_str());
-    auto data = m_dat.readFile(file_handle, index, true);
+    if (m_dat.isMapped())
+    {
+        auto view = m_dat.readFileView(index, true);
+        return std::vector<uint8_t>(view.data.begin(), view.data.end());
+    }
+
+    auto data = read_file(index);
     std::vector<uint8_t> file_data(data, data + mft_entry->uncompressedSize);
-    CloseHandle(file_handle);
 
     delete[] data;
 
@@ -136,18 +190,22 @@ bool DATManager::save_raw_decompressed_data_to_file(int index, std::wstring file
         return false;
     }
 
-    HANDLE file_handle = m_dat.get_dat_filehandle(m_dat_filepath.c_str());
-    std::unique_ptr<unsigned char[]> data(m_dat.readFile(file_handle, index, true));
+    std::unique_ptr<unsigned char[]> data(read_file(index));
     if (!data)
     {
         // Handle error in reading file
         return false;
     }
 
+    return save_raw_data_to_file(std::span<const uint8_t>(data.get(), mft_entry->uncompressedSize), filepath);
+}
+
+bool DATManager::save_raw_data_to_file(std::span<const uint8_t> data, std::wstring filepath)
+{
     std::ofstream output_file(filepath, std::ios::out | std::ios::binary);
     if (output_file.is_open())
     {
-        output_file.write(reinterpret_cast<char*>(data.get()), mft_entry->uncompressedSize);
+        output_file.write(reinterpret_cast<const char*>(data.data()), data.size());
         output_file.close();
         return true;
     }
@@ -157,63 +215,88 @@ bool DATManager::save_raw_decompressed_data_to_file(int index, std::wstring file
         return false;
     }
 }
+// The index sidecar lives next to the executable since the DAT's own folder is often read-only.
+// The DAT path is hashed into the name so several DATs can be indexed side by side.
+static std::optional<std::filesystem::path> get_index_sidecar_path(const std::wstring& dat_filepath)
+{
+    auto exe_dir_opt = get_executable_directory();
+    if (!exe_dir_opt)
+    {
+        return std::nullopt;
+    }
+
+    const auto stem = std::filesystem::path(dat_filepath).stem().wstring();
+    const auto path_hash = std::hash<std::wstring>{}(dat_filepath);
+    return *exe_dir_opt / L"dat_index" / std::format(L"{}_{:016x}.gwmbidx", stem, path_hash);
+}
+
 void DATManager::read_all_files()
 {
     const auto num_files = m_dat.getNumFiles();
 
-    // Get the number of available threads
-    const auto num_threads = std::thread::hardware_concurrency();
-
-    // Fill the concurrent queue with file indices
-    Concurrency::concurrent_queue<int> file_indices_queue;
-    for (int i = 0; i < num_files; ++i)
+    // A previous scan of the exact same DAT can be reused as is
+    const auto index_key = m_dat.getIndexKey(m_dat_filepath);
+    const auto index_path = get_index_sidecar_path(m_dat_filepath);
+    if (index_path && m_dat.loadIndex(*index_path, index_key))
     {
-        file_indices_queue.push(i);
+        m_num_types_read = num_files;
+        m_initialization_state = InitializationState::Completed;
+        return;
     }
 
-    // Start the file reading threads
-    std::vector<std::thread> threads;
-    for (int i = 0; i < num_threads; ++i)
-    {
-        threads.emplace_back(&DATManager::read_files_thread, this, std::ref(file_indices_queue));
-    }
+    // Files are handed out in the order they are stored in the DAT, see DatReadScheduler.
+    // Each range is one task on the shared pool so scanning several DATs at once doesn't
+    // start a set of threads per DAT.
+    DatReadScheduler scheduler(get_MFT());
+    TaskGroup tasks;
 
-    // Wait for all threads to finish
-    for (auto& thread : threads)
+    DatReadRange range;
+    while (scheduler.next_range(range))
     {
-        thread.join();
-    }
-
-    const auto& mft = get_MFT();
-    for (const auto& entry : mft) {
-        const auto num_files_for_type_it = num_files_per_type.find(static_cast<FileType>(entry.type));
-        if (num_files_for_type_it != num_files_per_type.end()) {
-            num_files_for_type_it->second += 1;
-        }
-        else {
-            num_files_per_type.emplace(static_cast<FileType>(entry.type), 1);
-        }
+        tasks.run([this, &scheduler, range] { read_files_in_range(scheduler, range); });
     }
+    tasks.wait();
 
-    if (file_indices_queue.empty())
+    // A quick scan leaves murmurhash3 unset so it isn't worth persisting
+    if (index_path && !m_quick_type_scan)
     {
-        m_initialization_state = InitializationState::Completed;
+        m_dat.saveIndex(*index_path, index_key);
     }
+
+    m_initialization_state = InitializationState::Completed;
 }
 
-void DATManager::read_files_thread(Concurrency::concurrent_queue<int>& file_indices_queue)
+void DATManager::read_files_in_range(const DatReadScheduler& scheduler, const DatReadRange& range)
 {
-    HANDLE file_handle = m_dat.get_dat_filehandle(m_dat_filepath.c_str());
-    unsigned char* data;
-    int index;
+    HANDLE file_handle = open_read_handle();
+    // Every range a worker reads goes into the same input buffer and every file is decompressed into
+    // the same output buffer, they only grow to the largest range and file seen
+    auto& context = GWDecompressContext::ForCurrentThread();
+    const auto& mft = get_MFT();
 
+    std::span<const uint8_t> range_data;
+    try
+    {
+        range_data = m_dat.readRange(file_handle, range.offset, (int)range.size, context.Input);
+    }
+    catch (...)
+    {
+    }
 
-    while (file_indices_queue.try_pop(index))
+    for (int index : scheduler.indices(range))
     {
         try
         {
-            data = m_dat.readFile(file_handle, index, false);
-            delete[] data;
+            const auto compressed = DatReadScheduler::entry_data(range, range_data, mft[index]);
+            if (m_quick_type_scan)
+            {
+                m_dat.readFileType(index, compressed);
+            }
+            else
+            {
+                // Stored entries are classified straight from the range without a copy
+                m_dat.decodeFileView(index, compressed, context.Output, false);
+            }
             auto _ = m_num_types_read.fetch_add(1, std::memory_order_relaxed);
         }
         catch (...)
@@ -221,7 +304,8 @@ void DATManager::read_files_thread(Concurrency::concurrent_queue<int>& file_indi
         }
     }
 
-    CloseHandle(file_handle);
-
-    auto remaining_threads = m_num_running_dat_reader_threads.fetch_sub(1, std::memory_order_relaxed);
+    if (file_handle)
+    {
+        CloseHandle(file_handle);
+    }
 }
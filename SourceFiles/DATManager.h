@@ -3,8 +3,13 @@
 #include "FFNA_MapFile.h"
 #include "FFNA_ModelFile.h"
 #include "FFNA_ModelFile_Other.h"
+#include "DatPrefetcher.h"
+#include "DatReadScheduler.h"
+#include "TaskPool.h"
+#include "xentax.h"
 #include <ppl.h>
 #include <concurrent_queue.h>
+#include <future>
 
 enum InitializationState
 {
@@ -28,6 +33,11 @@ public:
             return false;
         }
 
+        // Map the whole DAT once so reads don't need a file handle per call.
+        // Falls back to the ReadFile path when mapping isn't possible (e.g. 32-bit builds).
+        m_dat.mapDat(m_dat_filepath.c_str());
+        m_prefetcher = std::make_unique<DatPrefetcher>(m_dat, m_dat_filepath);
+
         auto read_all_thread = std::thread(&DATManager::read_all_files, this);
         read_all_thread.detach();
 
@@ -36,6 +46,11 @@ public:
 
     std::atomic<InitializationState> m_initialization_state{NotStarted};
 
+    // Classify files during the initial scan by decompressing only their headers.
+    // Much faster, but murmurhash3 is only known for files that have been read in full.
+    // Must be set before calling Init.
+    void set_quick_type_scan(bool enabled) { m_quick_type_scan = enabled; }
+
     int get_num_files_type_read() { return m_num_types_read; }
     int get_num_files() { return m_dat.getNumFiles(); }
 
@@ -45,38 +60,171 @@ public:
 
     std::vector<MFTEntry>& get_MFT() { return m_dat.get_MFT(); }
 
+    // Chunk ids of an FFNA entry, empty until it has been classified. Valid as long as this DATManager.
+    std::span<const uint32_t> get_chunk_ids(int index) const { return m_dat.getChunkIds(index); }
+
     FFNA_MapFile parse_ffna_map_file(int index);
+    // Decodes each chunk on first access instead of all of them, see FFNA_MapFileView. The view owns the file data.
+    FFNA_MapFileView parse_ffna_map_file_view(int index);
     FFNA_ModelFile parse_ffna_model_file(int index);
     FFNA_ModelFile_Other parse_ffna_model_file_other(int index);
     bool is_other_model_format(int index);
     AMAT_file parse_amat_file(int index);
     DatTexture parse_ffna_texture_file(int index);
+    // The texture's BC blocks, without decoding them to RGBA. See ProcessImageFileBlocks.
+    DatCompressedTexture parse_ffna_texture_blocks(int index);
     std::vector<uint8_t> parse_dds_file(int index);
 
     bool save_raw_decompressed_data_to_file(int index, std::wstring filepath);
+    static bool save_raw_data_to_file(std::span<const uint8_t> data, std::wstring filepath);
 
     unsigned char* read_file(int index)
     {
+        if (m_dat.isMapped())
+        {
+            return m_dat.readFile(nullptr, index, true);
+        }
+
         HANDLE file_handle = m_dat.get_dat_filehandle(m_dat_filepath.c_str());
         unsigned char* data = m_dat.readFile(file_handle, index, true);
         CloseHandle(file_handle);
         return data;
     }
 
+    // Decompresses into output, reusing its capacity. Returns false if the entry couldn't be read.
+    bool read_file(int index, std::vector<unsigned char>& output)
+    {
+        if (m_dat.isMapped())
+        {
+            return m_dat.readFile(nullptr, index, output, true);
+        }
+
+        HANDLE file_handle = m_dat.get_dat_filehandle(m_dat_filepath.c_str());
+        bool result = m_dat.readFile(file_handle, index, output, true);
+        CloseHandle(file_handle);
+        return result;
+    }
+
+    // Reads the files in the background, see DatPrefetcher. Returns one future per index, in the
+    // same order. A future holds an empty vector if its file couldn't be read.
+    std::vector<std::future<std::vector<unsigned char>>> read_files_async(std::span<const int> indices)
+    {
+        std::vector<std::future<std::vector<unsigned char>>> futures;
+        std::vector<DatPrefetcher::Request> requests;
+        futures.reserve(indices.size());
+        requests.reserve(indices.size());
+        for (int index : indices)
+        {
+            auto promise = std::make_shared<std::promise<std::vector<unsigned char>>>();
+            futures.push_back(promise->get_future());
+            requests.push_back({index, [promise](std::vector<unsigned char>&& data) { promise->set_value(std::move(data)); }});
+        }
+
+        enqueue_reads(std::move(requests));
+        return futures;
+    }
+
+    // Same, but calls on_file(index, data) on a pool worker as each file is ready, in no particular order
+    void read_files_async(std::span<const int> indices,
+                          std::function<void(int index, std::vector<unsigned char>&& data)> on_file)
+    {
+        auto shared_on_file = std::make_shared<decltype(on_file)>(std::move(on_file));
+        std::vector<DatPrefetcher::Request> requests;
+        requests.reserve(indices.size());
+        for (int index : indices)
+        {
+            requests.push_back({index, [index, shared_on_file](std::vector<unsigned char>&& data) {
+                                    (*shared_on_file)(index, std::move(data));
+                                }});
+        }
+
+        enqueue_reads(std::move(requests));
+    }
+
+    // Zero-copy read. Stored entries are returned as views into the mapped DAT, compressed
+    // entries own their decompressed buffer. Returns an empty view if the DAT isn't mapped.
+    DatFileView read_file_view(int index)
+    {
+        return m_dat.readFileView(index, true);
+    }
+
+    bool is_memory_mapped() const { return m_dat.isMapped(); }
+
+    // File handle for for_each_file_in_range, one per thread. nullptr when the DAT is mapped,
+    // close it with CloseHandle otherwise.
+    HANDLE open_read_handle()
+    {
+        return m_dat.isMapped() ? nullptr : m_dat.get_dat_filehandle(m_dat_filepath.c_str());
+    }
+
+    // Decompresses the entries of a range from a DatReadScheduler that want(index) accepts and
+    // calls on_file(index, data) for each. The range is read with a single sequential read, and
+    // not at all if nothing in it is wanted. data is empty if the entry couldn't be read, and is
+    // only valid during the call. It lives in this thread's GWDecompressContext, so on_file must
+    // not read other files.
+    template <typename Want, typename OnFile>
+    void for_each_file_in_range(const DatReadScheduler& scheduler, const DatReadRange& range, HANDLE file_handle,
+                                Want&& want, OnFile&& on_file)
+    {
+        // want is asked once per entry, the accepted ones are kept in a per thread list that is
+        // reused between ranges
+        thread_local std::vector<int> wanted;
+        wanted.clear();
+        for (int index : scheduler.indices(range))
+        {
+            if (want(index))
+            {
+                wanted.push_back(index);
+            }
+        }
+
+        if (wanted.empty())
+        {
+            return;
+        }
+
+        auto& context = GWDecompressContext::ForCurrentThread();
+        const auto range_data = m_dat.readRange(file_handle, range.offset, (int)range.size, context.Input);
+        for (int index : wanted)
+        {
+            const auto compressed = DatReadScheduler::entry_data(range, range_data, m_dat[index]);
+            const auto view = m_dat.decodeFileView(index, compressed, context.Output, true);
+            on_file(index, view.data);
+        }
+    }
+
+    // Live count, correct while the initial scan is still running. Files that haven't been
+    // classified yet are counted as NOTREAD.
     int get_num_files_for_type(FileType type) {
-        return num_files_per_type[type];
+        return m_dat.getNumFilesForType(type);
     }
 
 private:
     std::wstring m_dat_filepath;
     GWDat m_dat;
 
-    std::atomic<int> m_num_types_read{0};
-    std::atomic<int> m_num_running_dat_reader_threads{0};
+    bool m_quick_type_scan = false;
+
+    // Declared after m_dat so it's destroyed first
+    std::unique_ptr<DatPrefetcher> m_prefetcher;
 
-    std::unordered_map<FileType, int> num_files_per_type;
+    std::atomic<int> m_num_types_read{0};
 
     void read_all_files();
 
-    void read_files_thread(Concurrency::concurrent_queue<int>& file_indices_queue);
+    void enqueue_reads(std::vector<DatPrefetcher::Request>&& requests)
+    {
+        if (! m_prefetcher)
+        {
+            for (auto& request : requests)
+            {
+                request.on_file({});
+            }
+            return;
+        }
+
+        m_prefetcher->enqueue(std::move(requests));
+    }
+
+    void read_files_in_range(const DatReadScheduler& scheduler, const DatReadRange& range);
 };
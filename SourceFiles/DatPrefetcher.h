@@ -0,0 +1,194 @@
+#pragma once
+#include "GWUnpacker.h"
+#include "TaskPool.h"
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+// Reads DAT files in the background, see DATManager::read_files_async.
+// One I/O thread per DAT reads the compressed bytes of the queued files, each batch in the order the
+// files are stored in the DAT, and hands them to the shared TaskPool to be decompressed. They go to its
+// high priority lane, so a map load doesn't queue behind a running type scan or search. It stops
+// reading while max_pending_bytes of compressed data are waiting for a worker, so a large batch can't
+// pull the DAT into memory faster than the workers decompress it.
+class DatPrefetcher
+{
+public:
+    // Called on a pool worker with the decompressed file, empty if it couldn't be read
+    using OnFile = std::function<void(std::vector<unsigned char>&& data)>;
+
+    struct Request
+    {
+        int index = 0;
+        OnFile on_file;
+    };
+
+    static constexpr int64_t default_max_pending_bytes = 64 * 1024 * 1024;
+
+    DatPrefetcher(GWDat& dat, std::wstring dat_filepath, int64_t max_pending_bytes = default_max_pending_bytes)
+        : m_dat(dat)
+        , m_dat_filepath(std::move(dat_filepath))
+        , m_max_pending_bytes(max_pending_bytes)
+    {
+    }
+
+    // Requests that haven't been read yet are completed with empty data
+    ~DatPrefetcher()
+    {
+        {
+            std::lock_guard lock(m_mutex);
+            m_stopping = true;
+        }
+        m_cv.notify_all();
+
+        if (m_io_thread.joinable())
+        {
+            m_io_thread.join();
+        }
+        m_tasks.wait();
+
+        for (auto& request : m_queue)
+        {
+            request.on_file({});
+        }
+    }
+
+    DatPrefetcher(const DatPrefetcher&) = delete;
+    DatPrefetcher& operator=(const DatPrefetcher&) = delete;
+
+    void enqueue(std::vector<Request> requests)
+    {
+        auto& mft = m_dat.get_MFT();
+        std::erase_if(requests, [&](Request& request) {
+            if (request.index >= 0 && request.index < (int)mft.size())
+            {
+                return false;
+            }
+            request.on_file({});
+            return true;
+        });
+
+        std::stable_sort(requests.begin(), requests.end(), [&mft](const Request& a, const Request& b) {
+            return mft[a.index].Offset < mft[b.index].Offset;
+        });
+
+        {
+            std::lock_guard lock(m_mutex);
+            for (auto& request : requests)
+            {
+                m_queue.push_back(std::move(request));
+            }
+
+            if (! m_io_thread.joinable())
+            {
+                m_io_thread = std::thread(&DatPrefetcher::io_loop, this);
+            }
+        }
+        m_cv.notify_all();
+    }
+
+private:
+    GWDat& m_dat;
+    std::wstring m_dat_filepath;
+    int64_t m_max_pending_bytes;
+
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::deque<Request> m_queue;
+    int64_t m_pending_bytes = 0;
+    bool m_stopping = false;
+
+    std::thread m_io_thread;
+    TaskGroup m_tasks;
+
+    void io_loop()
+    {
+        HANDLE file_handle = m_dat.isMapped() ? nullptr : m_dat.get_dat_filehandle(m_dat_filepath.c_str());
+
+        while (true)
+        {
+            Request request;
+            int64_t size = 0;
+            {
+                std::unique_lock lock(m_mutex);
+                m_cv.wait(lock, [this] { return m_stopping || ! m_queue.empty(); });
+                if (m_stopping)
+                {
+                    break;
+                }
+
+                const MFTEntry& entry = m_dat[m_queue.front().index];
+                size = entry.b && entry.Size > 0 ? entry.Size : 0;
+
+                // Always let one file through, however big, so the queue can't stall
+                m_cv.wait(lock, [this, size] {
+                    return m_stopping || m_pending_bytes == 0 || m_pending_bytes + size <= m_max_pending_bytes;
+                });
+                if (m_stopping)
+                {
+                    break;
+                }
+
+                request = std::move(m_queue.front());
+                m_queue.pop_front();
+                m_pending_bytes += size;
+            }
+
+            // Stays empty when the DAT is mapped, the compressed bytes are read straight from the mapping
+            std::vector<unsigned char> buffer;
+            std::span<const uint8_t> compressed;
+            if (size > 0)
+            {
+                const MFTEntry& entry = m_dat[request.index];
+                try
+                {
+                    compressed = m_dat.readRange(file_handle, entry.Offset, entry.Size, buffer);
+                }
+                catch (...)
+                {
+                }
+            }
+
+            m_tasks.run([this, request = std::move(request), buffer = std::move(buffer), compressed, size]() {
+                decompress(request, buffer.empty() ? compressed : std::span<const uint8_t>(buffer), size);
+            }, TaskPriority::High);
+        }
+
+        if (file_handle)
+        {
+            CloseHandle(file_handle);
+        }
+    }
+
+    void decompress(const Request& request, std::span<const uint8_t> compressed, int64_t size)
+    {
+        std::vector<unsigned char> output;
+        try
+        {
+            const auto view = m_dat.decodeFileView(request.index, compressed, output, true);
+            if (! view)
+            {
+                output.clear();
+            }
+            else if (view.data.data() != output.data())
+            {
+                // Stored entries come back as a view of the compressed bytes
+                output.assign(view.data.begin(), view.data.end());
+            }
+        }
+        catch (...)
+        {
+            output.clear();
+        }
+
+        {
+            std::lock_guard lock(m_mutex);
+            m_pending_bytes -= size;
+        }
+        m_cv.notify_all();
+
+        request.on_file(std::move(output));
+    }
+};
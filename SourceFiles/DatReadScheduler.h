@@ -0,0 +1,128 @@
+#pragma once
+#include "GWUnpacker.h"
+#include <atomic>
+
+// A run of neighbouring DAT entries that can be read with one sequential read
+struct DatReadRange
+{
+    uint32_t first = 0; // Position of the first entry in DatReadScheduler::order()
+    uint32_t count = 0;
+    int64_t offset = 0; // Bytes of the DAT covering every entry in the range
+    int64_t size = 0;
+};
+
+// Hands out the entries of a DAT sorted by where they are stored, grouped into ranges of
+// neighbouring entries. Workers that take ranges from it stream through the DAT instead of
+// seeking all over it, which matters a lot on spinning disks and network drives.
+// Entries without data (MFT base entries) come first, as one range of size 0.
+// next_range is thread safe, everything else is read-only after construction.
+class DatReadScheduler
+{
+public:
+    // A range is closed when it would grow past max_range_size or the next entry starts more
+    // than max_gap bytes after the end of the previous one. Reading a small gap is cheaper than a seek.
+    static constexpr int64_t default_max_range_size = 8 * 1024 * 1024;
+    static constexpr int64_t default_max_gap = 256 * 1024;
+
+    explicit DatReadScheduler(const std::vector<MFTEntry>& mft, int64_t max_range_size = default_max_range_size,
+                              int64_t max_gap = default_max_gap)
+    {
+        m_order.reserve(mft.size());
+
+        std::vector<int> no_data;
+        for (int i = 0; i < (int)mft.size(); i++)
+        {
+            if (has_data(mft[i]))
+                m_order.push_back(i);
+            else
+                no_data.push_back(i);
+        }
+
+        std::stable_sort(m_order.begin(), m_order.end(),
+                         [&mft](int a, int b) { return mft[a].Offset < mft[b].Offset; });
+        m_order.insert(m_order.begin(), no_data.begin(), no_data.end());
+
+        if (! no_data.empty())
+        {
+            m_ranges.push_back({0, (uint32_t)no_data.size(), 0, 0});
+        }
+
+        DatReadRange current;
+        int64_t current_end = 0;
+        for (uint32_t i = (uint32_t)no_data.size(); i < m_order.size(); i++)
+        {
+            const MFTEntry& entry = mft[m_order[i]];
+            const int64_t entry_end = entry.Offset + entry.Size;
+
+            if (current.count > 0 &&
+                (entry.Offset - current_end > max_gap || std::max(entry_end, current_end) - current.offset > max_range_size))
+            {
+                current.size = current_end - current.offset;
+                m_ranges.push_back(current);
+                current.count = 0;
+            }
+
+            if (current.count == 0)
+            {
+                current.first = i;
+                current.offset = entry.Offset;
+                current_end = entry_end;
+            }
+
+            current.count++;
+            current_end = std::max(current_end, entry_end);
+        }
+
+        if (current.count > 0)
+        {
+            current.size = current_end - current.offset;
+            m_ranges.push_back(current);
+        }
+    }
+
+    DatReadScheduler(const DatReadScheduler&) = delete;
+    DatReadScheduler& operator=(const DatReadScheduler&) = delete;
+
+    // Takes the next range, returns false once all ranges have been handed out
+    bool next_range(DatReadRange& range)
+    {
+        const size_t i = m_next_range.fetch_add(1, std::memory_order_relaxed);
+        if (i >= m_ranges.size())
+            return false;
+
+        range = m_ranges[i];
+        return true;
+    }
+
+    bool has_remaining_ranges() const { return m_next_range.load(std::memory_order_relaxed) < m_ranges.size(); }
+
+    // MFT indices of the entries in range, in offset order
+    std::span<const int> indices(const DatReadRange& range) const
+    {
+        return std::span<const int>(m_order).subspan(range.first, range.count);
+    }
+
+    // The compressed bytes of entry within the bytes read for its range, empty if they weren't read
+    static std::span<const uint8_t> entry_data(const DatReadRange& range, std::span<const uint8_t> range_data,
+                                               const MFTEntry& entry)
+    {
+        if (! has_data(entry) || entry.Offset < range.offset)
+            return {};
+
+        const uint64_t start = entry.Offset - range.offset;
+        if (start + entry.Size > range_data.size())
+            return {};
+
+        return range_data.subspan(start, entry.Size);
+    }
+
+    const std::vector<int>& order() const { return m_order; }
+    size_t num_ranges() const { return m_ranges.size(); }
+
+private:
+    std::vector<int> m_order;
+    std::vector<DatReadRange> m_ranges;
+    std::atomic<size_t> m_next_range{0};
+
+    static bool has_data(const MFTEntry& entry) { return entry.b && entry.Size > 0 && entry.Offset >= 0; }
+};
@@ -540,47 +540,91 @@ struct Chunk5
     }
 };
 
-struct Chunk8
+// Floats stored in a file buffer, read in place. The buffer doesn't keep them 4 byte aligned, so they
+// are read with memcpy instead of through a float pointer.
+class UnalignedFloatSpan
 {
-    uint32_t chunk_id;
-    uint32_t chunk_size;
-    uint32_t magic_num;
-    uint32_t magic_num1;
-    uint8_t tag;
-    uint32_t some_size;
-    uint32_t terrain_x_dims;
-    uint32_t terrain_y_dims;
-    float some_float;
-    float some_small_float;
-    uint16_t some_size1;
-    float some_float1;
-    float some_float2;
-    uint8_t tag1;
-    uint32_t terrain_height_size_bytes;
-    std::vector<float> terrain_heightmap;
-    uint8_t tag2;
-    uint32_t num_terrain_tiles;
-    std::vector<uint8_t> terrain_texture_indices_maybe;
-    uint8_t tag3;
-    uint32_t some_size2;
-    uint8_t some_size3;
-    std::vector<uint8_t> some_data3;
-    uint8_t tag4;
-    uint32_t some_size4;
-    std::vector<uint8_t> some_data4;
-    uint8_t tag5;
-    uint32_t some_size5;
-    std::vector<uint8_t> some_data5;
-    uint8_t tag6;
-    uint32_t num_terrain_tiles1;
-    std::vector<uint8_t> terrain_shadow_map;
-    uint8_t tag7;
-    uint32_t some_size7;
-    std::vector<uint8_t> some_data7;
-    std::vector<uint8_t> chunk_data;
+public:
+    UnalignedFloatSpan() = default;
+    UnalignedFloatSpan(const unsigned char* data, size_t count)
+        : m_data(data)
+        , m_count(count)
+    {
+    }
+    UnalignedFloatSpan(std::span<const float> floats)
+        : m_data((const unsigned char*)floats.data())
+        , m_count(floats.size())
+    {
+    }
+    UnalignedFloatSpan(const std::vector<float>& floats)
+        : UnalignedFloatSpan(std::span<const float>(floats))
+    {
+    }
 
-    Chunk8() = default;
-    Chunk8(int offset, const unsigned char* data)
+    size_t size() const { return m_count; }
+    bool empty() const { return m_count == 0; }
+
+    float operator[](size_t i) const
+    {
+        float value;
+        std::memcpy(&value, m_data + i * sizeof(float), sizeof(float));
+        return value;
+    }
+
+    void copy_to(float* out) const
+    {
+        if (m_count)
+            std::memcpy(out, m_data, m_count * sizeof(float));
+    }
+
+private:
+    const unsigned char* m_data = nullptr;
+    size_t m_count = 0;
+};
+
+// Chunk8 without the copies: the heightmap, tile arrays and unknown blobs point into the file buffer,
+// which has to outlive the view. Terrain can be built from it directly.
+struct Chunk8View
+{
+    uint32_t chunk_id = 0;
+    uint32_t chunk_size = 0;
+    uint32_t magic_num = 0;
+    uint32_t magic_num1 = 0;
+    uint8_t tag = 0;
+    uint32_t some_size = 0;
+    uint32_t terrain_x_dims = 0;
+    uint32_t terrain_y_dims = 0;
+    float some_float = 0;
+    float some_small_float = 0;
+    uint16_t some_size1 = 0;
+    float some_float1 = 0;
+    float some_float2 = 0;
+    uint8_t tag1 = 0;
+    uint32_t terrain_height_size_bytes = 0;
+    UnalignedFloatSpan terrain_heightmap;
+    uint8_t tag2 = 0;
+    uint32_t num_terrain_tiles = 0;
+    std::span<const uint8_t> terrain_texture_indices_maybe;
+    uint8_t tag3 = 0;
+    uint32_t some_size2 = 0;
+    uint8_t some_size3 = 0;
+    std::span<const uint8_t> some_data3;
+    uint8_t tag4 = 0;
+    uint32_t some_size4 = 0;
+    std::span<const uint8_t> some_data4;
+    uint8_t tag5 = 0;
+    uint32_t some_size5 = 0;
+    std::span<const uint8_t> some_data5;
+    uint8_t tag6 = 0;
+    uint32_t num_terrain_tiles1 = 0;
+    std::span<const uint8_t> terrain_shadow_map;
+    uint8_t tag7 = 0;
+    uint32_t some_size7 = 0;
+    std::span<const uint8_t> some_data7;
+    std::span<const uint8_t> chunk_data;
+
+    Chunk8View() = default;
+    Chunk8View(int offset, const unsigned char* data)
     {
         std::memcpy(&chunk_id, &data[offset], sizeof(chunk_id));
         offset += sizeof(chunk_id);
@@ -627,8 +671,7 @@ struct Chunk8
         std::memcpy(&terrain_height_size_bytes, &data[offset], sizeof(terrain_height_size_bytes));
         offset += sizeof(terrain_height_size_bytes);
 
-        terrain_heightmap.resize(terrain_x_dims * terrain_y_dims);
-        std::memcpy(terrain_heightmap.data(), &data[offset], terrain_heightmap.size() * sizeof(float));
+        terrain_heightmap = UnalignedFloatSpan(&data[offset], (size_t)terrain_x_dims * terrain_y_dims);
         offset += terrain_heightmap.size() * sizeof(float);
 
         std::memcpy(&tag2, &data[offset], sizeof(tag2));
@@ -637,9 +680,7 @@ struct Chunk8
         std::memcpy(&num_terrain_tiles, &data[offset], sizeof(num_terrain_tiles));
         offset += sizeof(num_terrain_tiles);
 
-        terrain_texture_indices_maybe.resize(num_terrain_tiles);
-        std::memcpy(terrain_texture_indices_maybe.data(), &data[offset],
-                    terrain_texture_indices_maybe.size());
+        terrain_texture_indices_maybe = std::span<const uint8_t>(&data[offset], num_terrain_tiles);
         offset += terrain_texture_indices_maybe.size();
 
         std::memcpy(&tag3, &data[offset], sizeof(tag3));
@@ -651,8 +692,7 @@ struct Chunk8
         std::memcpy(&some_size3, &data[offset], sizeof(some_size3));
         offset += sizeof(some_size3);
 
-        some_data3.resize(some_size3);
-        std::memcpy(some_data3.data(), &data[offset], some_data3.size());
+        some_data3 = std::span<const uint8_t>(&data[offset], some_size3);
         offset += some_data3.size();
 
         std::memcpy(&tag4, &data[offset], sizeof(tag4));
@@ -661,8 +701,7 @@ struct Chunk8
         std::memcpy(&some_size4, &data[offset], sizeof(some_size4));
         offset += sizeof(some_size4);
 
-        some_data4.resize(some_size4);
-        std::memcpy(some_data4.data(), &data[offset], some_data4.size());
+        some_data4 = std::span<const uint8_t>(&data[offset], some_size4);
         offset += some_data4.size();
 
         std::memcpy(&tag5, &data[offset], sizeof(tag5));
@@ -671,8 +710,7 @@ struct Chunk8
         std::memcpy(&some_size5, &data[offset], sizeof(some_size5));
         offset += sizeof(some_size5);
 
-        some_data5.resize(some_size5);
-        std::memcpy(some_data5.data(), &data[offset], some_data5.size());
+        some_data5 = std::span<const uint8_t>(&data[offset], some_size5);
         offset += some_data5.size();
 
         std::memcpy(&tag6, &data[offset], sizeof(tag6));
@@ -681,9 +719,7 @@ struct Chunk8
         std::memcpy(&num_terrain_tiles1, &data[offset], sizeof(num_terrain_tiles1));
         offset += sizeof(num_terrain_tiles1);
 
-        terrain_shadow_map.resize(num_terrain_tiles1);
-        std::memcpy(terrain_shadow_map.data(), &data[offset],
-                    terrain_shadow_map.size());
+        terrain_shadow_map = std::span<const uint8_t>(&data[offset], num_terrain_tiles1);
         offset += terrain_shadow_map.size();
 
         std::memcpy(&tag7, &data[offset], sizeof(tag7));
@@ -692,15 +728,101 @@ struct Chunk8
         std::memcpy(&some_size7, &data[offset], sizeof(some_size7));
         offset += sizeof(some_size7);
 
-        some_data7.resize(some_size7);
-        std::memcpy(some_data7.data(), &data[offset], some_data7.size());
+        some_data7 = std::span<const uint8_t>(&data[offset], some_size7);
         offset += some_data7.size();
 
         int chunk_data_size = chunk_size - 75 - terrain_heightmap.size() * sizeof(float) -
           terrain_texture_indices_maybe.size() - some_data3.size() - some_data4.size() - some_data5.size() -
           terrain_shadow_map.size() - some_data7.size();
-        chunk_data.resize(chunk_data_size);
-        std::memcpy(chunk_data.data(), &data[offset], chunk_data.size());
+        chunk_data = std::span<const uint8_t>(&data[offset], std::max(chunk_data_size, 0));
+    }
+};
+
+struct Chunk8
+{
+    uint32_t chunk_id;
+    uint32_t chunk_size;
+    uint32_t magic_num;
+    uint32_t magic_num1;
+    uint8_t tag;
+    uint32_t some_size;
+    uint32_t terrain_x_dims;
+    uint32_t terrain_y_dims;
+    float some_float;
+    float some_small_float;
+    uint16_t some_size1;
+    float some_float1;
+    float some_float2;
+    uint8_t tag1;
+    uint32_t terrain_height_size_bytes;
+    std::vector<float> terrain_heightmap;
+    uint8_t tag2;
+    uint32_t num_terrain_tiles;
+    std::vector<uint8_t> terrain_texture_indices_maybe;
+    uint8_t tag3;
+    uint32_t some_size2;
+    uint8_t some_size3;
+    std::vector<uint8_t> some_data3;
+    uint8_t tag4;
+    uint32_t some_size4;
+    std::vector<uint8_t> some_data4;
+    uint8_t tag5;
+    uint32_t some_size5;
+    std::vector<uint8_t> some_data5;
+    uint8_t tag6;
+    uint32_t num_terrain_tiles1;
+    std::vector<uint8_t> terrain_shadow_map;
+    uint8_t tag7;
+    uint32_t some_size7;
+    std::vector<uint8_t> some_data7;
+    std::vector<uint8_t> chunk_data;
+
+    Chunk8() = default;
+    Chunk8(int offset, const unsigned char* data)
+        : Chunk8(Chunk8View(offset, data))
+    {
+    }
+
+    explicit Chunk8(const Chunk8View& view)
+    {
+        chunk_id = view.chunk_id;
+        chunk_size = view.chunk_size;
+        magic_num = view.magic_num;
+        magic_num1 = view.magic_num1;
+        tag = view.tag;
+        some_size = view.some_size;
+        terrain_x_dims = view.terrain_x_dims;
+        terrain_y_dims = view.terrain_y_dims;
+        some_float = view.some_float;
+        some_small_float = view.some_small_float;
+        some_size1 = view.some_size1;
+        some_float1 = view.some_float1;
+        some_float2 = view.some_float2;
+        tag1 = view.tag1;
+        terrain_height_size_bytes = view.terrain_height_size_bytes;
+        tag2 = view.tag2;
+        num_terrain_tiles = view.num_terrain_tiles;
+        tag3 = view.tag3;
+        some_size2 = view.some_size2;
+        some_size3 = view.some_size3;
+        tag4 = view.tag4;
+        some_size4 = view.some_size4;
+        tag5 = view.tag5;
+        some_size5 = view.some_size5;
+        tag6 = view.tag6;
+        num_terrain_tiles1 = view.num_terrain_tiles1;
+        tag7 = view.tag7;
+        some_size7 = view.some_size7;
+        terrain_heightmap.resize(view.terrain_heightmap.size());
+        view.terrain_heightmap.copy_to(terrain_heightmap.data());
+        terrain_texture_indices_maybe.assign(view.terrain_texture_indices_maybe.begin(),
+                                             view.terrain_texture_indices_maybe.end());
+        some_data3.assign(view.some_data3.begin(), view.some_data3.end());
+        some_data4.assign(view.some_data4.begin(), view.some_data4.end());
+        some_data5.assign(view.some_data5.begin(), view.some_data5.end());
+        terrain_shadow_map.assign(view.terrain_shadow_map.begin(), view.terrain_shadow_map.end());
+        some_data7.assign(view.some_data7.begin(), view.some_data7.end());
+        chunk_data.assign(view.chunk_data.begin(), view.chunk_data.end());
     }
 };
 
@@ -1287,7 +1409,7 @@ struct EnvironmentInfoChunk {
     uint8_t end_byte_0xFF;
 
     EnvironmentInfoChunk() = default;
-    EnvironmentInfoChunk(int offset, unsigned char* data) {
+    EnvironmentInfoChunk(int offset, const unsigned char* data) {
         std::memcpy(&chunk_id, &data[offset], sizeof(chunk_id));
         offset += sizeof(chunk_id);
 
@@ -1830,6 +1952,28 @@ constexpr uint32_t CHUNK_ID_PROPS_FILENAMES = 0x21000004;
 constexpr uint32_t CHUNK_ID_ENVIRONMENT_INFO_FILENAMES = 0x21000009;
 constexpr uint32_t CHUNK_ID_SHORE_FILENAMES = 0x21000010;
 
+// Offset of each chunk in an FFNA map file, by chunk id. Only the 8 byte chunk headers are read.
+inline std::unordered_map<uint32_t, int> index_ffna_map_chunks(int offset, std::span<const unsigned char> data)
+{
+    std::unordered_map<uint32_t, int> riff_chunks;
+
+    int current_offset = offset + 5;
+    while (current_offset + 8 <= (int)data.size())
+    {
+        uint32_t chunk_id;
+        uint32_t chunk_size;
+        std::memcpy(&chunk_id, &data[current_offset], sizeof(chunk_id));
+        std::memcpy(&chunk_size, &data[current_offset + 4], sizeof(chunk_size));
+
+        riff_chunks.emplace(chunk_id, current_offset);
+
+        // Move to the next chunk
+        current_offset += 8 + chunk_size;
+    }
+
+    return riff_chunks;
+}
+
 struct FFNA_MapFile
 {
     char ffna_signature[4];
@@ -1855,24 +1999,12 @@ struct FFNA_MapFile
     FFNA_MapFile() = default;
     FFNA_MapFile(int offset, std::span<unsigned char>& data)
     {
-        int current_offset = offset;
 
         std::memcpy(ffna_signature, &data[offset], sizeof(ffna_signature));
-        std::memcpy(&ffna_type, &data[offset], sizeof(ffna_type));
-        current_offset += 5;
-
-        // Read all chunks
-        while (current_offset < data.size())
-        {
-            // Create a GeneralChunk instance using the current offset and data pointer
-            GeneralChunk chunk(current_offset, data.data());
-
-            // Add the GeneralChunk instance to the riff_chunks map using its chunk_id as the key
-            riff_chunks.emplace(chunk.chunk_id, current_offset);
+        std::memcpy(&ffna_type, &data[offset + 4], sizeof(ffna_type));
 
-            // Move to the next chunk by updating the current_offset
-            current_offset += 8 + chunk.chunk_size;
-        }
+        // Read all chunk headers
+        riff_chunks = index_ffna_map_chunks(offset, data);
 
         //Check if the CHUNK_ID_20000000 is in the riff_chunks map
         auto it = riff_chunks.find(CHUNK_ID_20000000);
@@ -1979,3 +2111,130 @@ struct FFNA_MapFile
         //}
     }
 };
+
+// Lazy alternative to FFNA_MapFile. Only the chunk headers are read up front, each chunk is decoded
+// the first time it is asked for. Tools that need one or two chunks of every map, e.g. the
+// pathfinding or the prop list, don't pay for decoding the terrain and environment.
+// The view references data, unless it was given the buffer to own. Not thread safe.
+class FFNA_MapFileView
+{
+public:
+    FFNA_MapFileView() = default;
+    FFNA_MapFileView(int offset, std::span<const unsigned char> data)
+        : m_data(data)
+    {
+        if (data.size() >= (size_t)offset + 5)
+        {
+            std::memcpy(m_ffna_signature, &data[offset], sizeof(m_ffna_signature));
+            std::memcpy(&m_ffna_type, &data[offset + 4], sizeof(m_ffna_type));
+            m_riff_chunks = index_ffna_map_chunks(offset, data);
+        }
+    }
+
+    // Owns the buffer. Moving a vector keeps its storage, so the view can be moved too.
+    FFNA_MapFileView(int offset, std::vector<unsigned char>&& data)
+        : FFNA_MapFileView(offset, std::span<const unsigned char>(data))
+    {
+        m_storage = std::move(data);
+    }
+
+    FFNA_MapFileView(const FFNA_MapFileView&) = delete;
+    FFNA_MapFileView& operator=(const FFNA_MapFileView&) = delete;
+    FFNA_MapFileView(FFNA_MapFileView&&) = default;
+    FFNA_MapFileView& operator=(FFNA_MapFileView&&) = default;
+
+    FFNAType get_ffna_type() const { return m_ffna_type; }
+    std::span<const unsigned char> get_data() const { return m_data; }
+    const std::unordered_map<uint32_t, int>& get_riff_chunks() const { return m_riff_chunks; }
+    bool has_chunk(uint32_t chunk_id) const { return m_riff_chunks.contains(chunk_id); }
+
+    // A chunk the file doesn't have is returned default constructed, like FFNA_MapFile leaves it
+    const Chunk1& chunk1() { return get_chunk(m_chunk1, CHUNK_ID_20000000); }
+    const Chunk2& map_info_chunk() { return get_chunk(m_map_info_chunk, CHUNK_ID_MAP_INFO); }
+    const Chunk3& props_info_chunk() { return get_chunk(m_props_info_chunk, CHUNK_ID_PROPS_INFO); }
+    const Chunk4& prop_filenames_chunk() { return get_chunk(m_prop_filenames_chunk, CHUNK_ID_PROPS_FILENAMES); }
+    const Chunk4& more_filnames_chunk() { return get_chunk(m_more_filnames_chunk, CHUNK_ID_PROPS_FILENAMES0); }
+    const Chunk8& terrain_chunk() { return get_chunk(m_terrain_chunk, CHUNK_ID_TERRAIN); }
+    // The terrain chunk in place, without copying the heightmap or tile arrays. Not cached, only the
+    // header fields are read.
+    Chunk8View terrain_chunk_view() const
+    {
+        const auto it = m_riff_chunks.find(CHUNK_ID_TERRAIN);
+        return it != m_riff_chunks.end() ? Chunk8View(it->second, m_data.data()) : Chunk8View();
+    }
+    const Chunk4& terrain_texture_filenames() { return get_chunk(m_terrain_texture_filenames, CHUNK_ID_TERRAIN_FILENAMES); }
+    const EnvironmentInfoChunk& environment_info_chunk()
+    {
+        return get_chunk(m_environment_info_chunk, CHUNK_ID_ENVIRONMENT_INFO);
+    }
+    const EnvironmentInfoFilenamesChunk& environment_info_filenames_chunk()
+    {
+        return get_chunk(m_environment_info_filenames_chunk, CHUNK_ID_ENVIRONMENT_INFO_FILENAMES);
+    }
+    const ShoreChunk& shore_chunk() { return get_chunk(m_shore_chunk, CHUNK_ID_SHORE); }
+    const Chunk4& shore_filenames() { return get_chunk(m_shore_filenames, CHUNK_ID_SHORE_FILENAMES); }
+    const PathfindingChunk& pathfinding_chunk() { return get_chunk(m_pathfinding_chunk, CHUNK_ID_PATH_INFO); }
+
+    // Decodes every chunk FFNA_MapFile decodes, for code that still needs the eager struct
+    FFNA_MapFile to_map_file()
+    {
+        FFNA_MapFile map_file;
+        std::memcpy(map_file.ffna_signature, m_ffna_signature, sizeof(m_ffna_signature));
+        map_file.ffna_type = m_ffna_type;
+        map_file.chunk1 = chunk1();
+        map_file.map_info_chunk = map_info_chunk();
+        map_file.props_info_chunk = props_info_chunk();
+        map_file.prop_filenames_chunk = prop_filenames_chunk();
+        map_file.more_filnames_chunk = more_filnames_chunk();
+        map_file.terrain_chunk = terrain_chunk();
+        map_file.terrain_texture_filenames = terrain_texture_filenames();
+        map_file.environment_info_chunk = environment_info_chunk();
+        map_file.environment_info_filenames_chunk = environment_info_filenames_chunk();
+        map_file.shore_chunk = shore_chunk();
+        map_file.shore_filenames = shore_filenames();
+        map_file.pathfinding_chunk = pathfinding_chunk();
+        map_file.riff_chunks = m_riff_chunks;
+        return map_file;
+    }
+
+private:
+    template <typename T>
+    T decode_chunk(int offset) const
+    {
+        if constexpr (std::is_same_v<T, PathfindingChunk>)
+            return PathfindingChunk(offset, m_data.data(), m_data.size());
+        else
+            return T(offset, m_data.data());
+    }
+
+    template <typename T>
+    const T& get_chunk(std::optional<T>& chunk, uint32_t chunk_id)
+    {
+        if (! chunk)
+        {
+            const auto it = m_riff_chunks.find(chunk_id);
+            chunk = it != m_riff_chunks.end() ? decode_chunk<T>(it->second) : T();
+        }
+        return *chunk;
+    }
+
+    std::span<const unsigned char> m_data;
+    std::vector<unsigned char> m_storage;
+
+    char m_ffna_signature[4]{};
+    FFNAType m_ffna_type{};
+    std::unordered_map<uint32_t, int> m_riff_chunks;
+
+    std::optional<Chunk1> m_chunk1;
+    std::optional<Chunk2> m_map_info_chunk;
+    std::optional<Chunk3> m_props_info_chunk;
+    std::optional<Chunk4> m_prop_filenames_chunk;
+    std::optional<Chunk4> m_more_filnames_chunk;
+    std::optional<Chunk8> m_terrain_chunk;
+    std::optional<Chunk4> m_terrain_texture_filenames;
+    std::optional<EnvironmentInfoChunk> m_environment_info_chunk;
+    std::optional<EnvironmentInfoFilenamesChunk> m_environment_info_filenames_chunk;
+    std::optional<ShoreChunk> m_shore_chunk;
+    std::optional<Chunk4> m_shore_filenames;
+    std::optional<PathfindingChunk> m_pathfinding_chunk;
+};
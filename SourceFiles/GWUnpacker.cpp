@@ -67,195 +67,552 @@ void GWDat::read(HANDLE file_handle, void* buffer, int size, int count)
 	}
 }
 
-unsigned char* GWDat::readFile(HANDLE file_handle, unsigned int n, bool translate)
+bool GWDat::beginRead(unsigned int n, bool translate)
 {
 	MFTEntry& m = MFT[n];
 
-	if (m.type == NOTREAD)
-		filesRead += 1;
-
 	//Don't read files that were already read if we just need the type
-	if (m.type != NOTREAD && !translate)
+	if (isClassified(n) && !translate)
 	{
-		return NULL;
+		return false;
 	}
 
 	if (!m.b)
 	{
-		m.type = MFTBASE;
-		m.uncompressedSize = 0;
-		mftBaseFiles += 1;
-		return NULL;
+		if (claimEntry(n))
+		{
+			m.uncompressedSize = 0;
+			publishEntry(n, MFTBASE);
+		}
+		return false;
 	}
 
-	unsigned char* Input = new unsigned char[m.Size];
+	return true;
+}
+
+bool GWDat::isClassified(unsigned int n) const
+{
+	auto& type = const_cast<__int32&>(MFT[n].type);
+	return std::atomic_ref<__int32>(type).load(std::memory_order_acquire) != NOTREAD;
+}
+
+uint32_t GWDat::getMurmurHash3(unsigned int n) const
+{
+	if (n >= MFT.size())
+		return 0;
+
+	auto& hash = const_cast<uint32_t&>(MFT[n].murmurhash3);
+	return std::atomic_ref<uint32_t>(hash).load(std::memory_order_relaxed);
+}
+
+bool GWDat::claimEntry(unsigned int n)
+{
+	if (isClassified(n))
+		return false;
+
+	uint8_t expected = 0;
+	return entryClaims[n].compare_exchange_strong(expected, 1, std::memory_order_acq_rel);
+}
+
+void GWDat::releaseEntry(unsigned int n)
+{
+	entryClaims[n].store(0, std::memory_order_release);
+}
+
+void GWDat::publishEntry(unsigned int n, int type)
+{
+	std::atomic_ref<__int32>(MFT[n].type).store(type, std::memory_order_release);
+	statistics.moveType(NOTREAD, type);
+	statistics.addFilesRead();
+}
+
+std::span<const uint32_t> GWDat::getChunkIds(unsigned int n) const
+{
+	if (n >= MFT.size() || !isClassified(n))
+		return {};
+
+	return chunkIds.get(MFT[n].chunkIdOffset, MFT[n].chunkIdCount);
+}
+
+void GWDat::setChunkIds(MFTEntry& m, std::span<const uint32_t> ids)
+{
+	const auto offset = chunkIds.append(ids);
+	m.chunkIdOffset = offset.value_or(0);
+	m.chunkIdCount = offset ? (uint32_t)std::min<size_t>(ids.size(), ChunkIdPool::BlockSize) : 0;
+}
+
+unsigned int GWDat::getTextureFiles() const
+{
+	unsigned int count = 0;
+	for (int type = ATEXDXT1; type <= DDS; ++type)
+		count += getNumFilesForType(type);
+	return count;
+}
+
+unsigned int GWDat::getFfnaFiles() const
+{
+	return getNumFilesForType(FFNA_Type2) + getNumFilesForType(FFNA_Type3) + getNumFilesForType(FFNA_Unknown);
+}
+
+unsigned char* GWDat::readFile(HANDLE file_handle, unsigned int n, bool translate)
+{
+	MFTEntry& m = MFT[n];
+
+	if (!beginRead(n, translate))
+		return NULL;
+
 	unsigned char* Output = NULL;
 	int OutSize = 0;
 
-	seek(file_handle, m.Offset, 0);
-	read(file_handle, Input, m.Size, 1);
+	if (mappedView)
+	{
+		auto Input = getCompressedView(n);
+		if (Input.empty())
+			return NULL;
+
+		if (m.a)
+			UnpackGWDat(Input.data(), (int)Input.size(), Output, OutSize);
+		else
+		{
+			//the caller owns the returned buffer so stored entries still need a copy here
+			Output = new unsigned char[Input.size()];
+			memcpy(Output, Input.data(), Input.size());
+			OutSize = (int)Input.size();
+		}
+	}
+	else
+	{
+		if (m.Size < MinEntrySize)
+			return NULL;
+
+		auto& Input = GWDecompressContext::ForCurrentThread().Input;
+		Input.resize(m.Size);
+
+		seek(file_handle, m.Offset, 0);
+		read(file_handle, Input.data(), m.Size, 1);
+
+		if (m.a)
+			UnpackGWDat(Input.data(), m.Size, Output, OutSize);
+		else
+		{
+			Output = new unsigned char[m.Size];
+			memcpy(Output, Input.data(), m.Size);
+			OutSize = m.Size;
+		}
+	}
+
+	if (Output)
+		classifyEntry(n, Output, OutSize);
+
+	return Output;
+}
+
+bool GWDat::readFile(HANDLE file_handle, unsigned int n, std::vector<unsigned char>& output, bool translate)
+{
+	//output isn't cleared up front: UnpackGWDat resizes it, which only zero fills the part past the previous file
+	const MFTEntry& m = MFT[n];
+
+	//Only touch the disk if the entry is going to be decompressed
+	std::span<const uint8_t> Input;
+	if (m.b && m.Size > 0 && (translate || !isClassified(n)))
+	{
+		if (mappedView)
+			Input = getCompressedView(n);
+		else
+			Input = readRange(file_handle, m.Offset, m.Size, GWDecompressContext::ForCurrentThread().Input);
+	}
+
+	DatFileView view = decodeFileView(n, Input, output, translate);
+	if (!view)
+	{
+		output.clear();
+		return false;
+	}
+
+	//stored entries still have to be copied into output
+	if (view.data.data() != output.data())
+		output.assign(view.data.begin(), view.data.end());
+
+	return true;
+}
+
+DatFileView GWDat::readFileView(unsigned int n, bool translate)
+{
+	DatFileView view;
+	if (!mappedView || n >= MFT.size())
+		return view;
+
+	MFTEntry& m = MFT[n];
+
+	if (!beginRead(n, translate))
+		return view;
+
+	auto Input = getCompressedView(n);
+	if (Input.empty())
+		return view;
 
 	if (m.a)
-		UnpackGWDat(Input, m.Size, Output, OutSize);
+	{
+		unsigned char* Output = NULL;
+		int OutSize = 0;
+		UnpackGWDat(Input.data(), (int)Input.size(), Output, OutSize);
+		if (!Output)
+			return view;
+
+		view.owned.reset(Output);
+		view.data = std::span<const uint8_t>(Output, OutSize);
+	}
 	else
 	{
-		Output = new unsigned char[m.Size];
-		memcpy(Output, Input, m.Size);
-		OutSize = m.Size;
+		//stored entries are handed out as-is, no allocation or copy
+		view.data = Input;
 	}
 
+	classifyEntry(n, view.data.data(), (int)view.data.size());
+	return view;
+}
 
-	delete[] Input;
+DatFileView GWDat::readFileView(unsigned int n, std::vector<unsigned char>& storage, bool translate)
+{
+	if (!mappedView || n >= MFT.size())
+		return {};
 
-	if (Output)
+	return decodeFileView(n, getCompressedView(n), storage, translate);
+}
+
+DatFileView GWDat::decodeFileView(unsigned int n, std::span<const uint8_t> compressed,
+                                  std::vector<unsigned char>& storage, bool translate)
+{
+	DatFileView view;
+
+	MFTEntry& m = MFT[n];
+
+	if (!beginRead(n, translate))
+		return view;
+
+	if (compressed.size() < (size_t)MinEntrySize)
+		return view;
+
+	if (m.a)
+	{
+		if (!UnpackGWDat(compressed.data(), (int)compressed.size(), storage))
+			return view;
+
+		view.data = storage;
+	}
+	else
+		view.data = compressed;
+
+	if (view.data.empty())
+		return view;
+
+	classifyEntry(n, view.data.data(), (int)view.data.size());
+	return view;
+}
+
+std::span<const uint8_t> GWDat::readRange(HANDLE file_handle, __int64 offset, int size, std::vector<unsigned char>& buffer)
+{
+	if (offset < 0 || size <= 0)
+		return {};
+
+	if (mappedView)
+	{
+		if ((uint64_t)offset + (uint64_t)size > mappedSize)
+			return {};
+		return std::span<const uint8_t>(mappedView + offset, (size_t)size);
+	}
+
+	buffer.resize(size);
+	seek(file_handle, offset, 0);
+	read(file_handle, buffer.data(), size, 1);
+	return std::span<const uint8_t>(buffer.data(), (size_t)size);
+}
+
+std::span<const uint8_t> GWDat::getCompressedView(unsigned int n) const
+{
+	if (!mappedView || n >= MFT.size())
+		return {};
+
+	//The decoder and classifyType read the first 8 bytes unchecked, a shorter entry at the end of the
+	//mapping would read past it
+	const MFTEntry& m = MFT[n];
+	if (m.Offset < 0 || m.Size < MinEntrySize || (uint64_t)m.Offset + (uint64_t)m.Size > mappedSize)
+		return {};
+
+	return std::span<const uint8_t>(mappedView + m.Offset, (size_t)m.Size);
+}
+
+bool GWDat::mapDat(const TCHAR* file)
+{
+	unmapDat();
+
+	mappedFile = CreateFile(file, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, NULL);
+	if (mappedFile == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER file_size;
+	if (!GetFileSizeEx(mappedFile, &file_size) || file_size.QuadPart <= 0 ||
+		(uint64_t)file_size.QuadPart > (uint64_t)SIZE_MAX)
+	{
+		//32-bit builds can't map a multi-GB DAT, the caller falls back to ReadFile
+		unmapDat();
+		return false;
+	}
+
+	mappedFileMapping = CreateFileMapping(mappedFile, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (!mappedFileMapping)
+	{
+		unmapDat();
+		return false;
+	}
+
+	mappedView = (const uint8_t*)MapViewOfFile(mappedFileMapping, FILE_MAP_READ, 0, 0, 0);
+	if (!mappedView)
 	{
-		// Use murmurhash3 for comparing files
-		MurmurHash3_x86_32(Output, OutSize, 0, &m.murmurhash3);
+		unmapDat();
+		return false;
+	}
+
+	mappedSize = (uint64_t)file_size.QuadPart;
+	return true;
+}
 
-		if (m.type == NOTREAD)
+void GWDat::unmapDat()
+{
+	if (mappedView)
+		UnmapViewOfFile(mappedView);
+	if (mappedFileMapping)
+		CloseHandle(mappedFileMapping);
+	if (mappedFile != INVALID_HANDLE_VALUE)
+		CloseHandle(mappedFile);
+
+	mappedView = nullptr;
+	mappedFileMapping = NULL;
+	mappedFile = INVALID_HANDLE_VALUE;
+	mappedSize = 0;
+}
+
+void GWDat::classifyEntry(unsigned int n, const unsigned char* Output, int OutSize)
+{
+	MFTEntry& m = MFT[n];
+
+	// Use murmurhash3 for comparing files. Every full read computes the same value so
+	// concurrent readers only need the store itself to be atomic.
+	uint32_t hash = 0;
+	MurmurHash3_x86_32(Output, OutSize, 0, &hash);
+	std::atomic_ref<uint32_t>(m.murmurhash3).store(hash, std::memory_order_relaxed);
+
+	EntryClaim claim(*this, n);
+	if (claim)
+	{
+		//Too short to have a header
+		int type = OutSize >= 8 ? classifyType(Output) : UNKNOWN;
+
+		m.uncompressedSize = OutSize;
+
+		// Extract chunk IDs from FFNA files (Type2 models and Type3 maps)
+		if (type == FFNA_Type2 || type == FFNA_Type3)
 		{
-			int type = 0;
-			auto sub_type = ((unsigned char*)Output)[4];
-			unsigned int i = ((unsigned int*)Output)[0];
-			unsigned int k = ((unsigned int*)Output)[1];
-			int i2 = i & 0xffff;
-			int i3 = i & 0xffffff;
-
-			switch (i)
-			{
-			case 'XTTA':
-				textureFiles += 1;
-				switch (k)
-				{
-				case '1TXD':
-					type = ATTXDXT1;
-					break;
-				case '3TXD':
-					type = ATTXDXT3;
-					break;
-				case '5TXD':
-					type = ATTXDXT5;
-					break;
-				case 'NTXD':
-					type = ATTXDXTN;
-					break;
-				case 'ATXD':
-					type = ATTXDXTA;
-					break;
-				case 'LTXD':
-					type = ATTXDXTL;
-					break;
-				}
-				break;
-			case 'XETA':
-				textureFiles += 1;
-				switch (k)
-				{
-				case '1TXD':
-					type = ATEXDXT1;
-					break;
-				case '2TXD':
-					type = ATEXDXT2;
-					break;
-				case '3TXD':
-					type = ATEXDXT3;
-					break;
-				case '4TXD':
-					type = ATEXDXT4;
-					break;
-				case '5TXD':
-					type = ATEXDXT5;
-					break;
-				case 'NTXD':
-					type = ATEXDXTN;
-					break;
-				case 'ATXD':
-					type = ATEXDXTA;
-					break;
-				case 'LTXD':
-					type = ATEXDXTL;
-					break;
-				}
-				break;
-			case '===;':
-			case '***;':
-				type = TEXT;
-				textFiles += 1;
-				break;
-			case 'anff':
-				if (sub_type == 2)
-				{
-					type = FFNA_Type2;
-				}
-				else if (sub_type == 3)
-				{
-					type = FFNA_Type3;
-				}
-				else
-				{
-					type = FFNA_Unknown;
-				}
-				ffnaFiles += 1;
-				break;
-			case ' SDD':
-				type = DDS;
-				textureFiles += 1;
-				break;
-			case 'TAMA':
-				type = AMAT;
-				amatFiles += 1;
-				break;
-			default:
-				type = UNKNOWN;
-			}
-			switch (i2)
+			thread_local std::vector<uint32_t> chunk_ids;
+			chunk_ids.clear();
+			int offset = 5;  // Skip FFNA header (4 bytes 'ffna' + 1 byte type)
+			while (offset + 8 <= OutSize)
 			{
-			case 0xFAFF:
-			case 0xFBFF:
-				type = SOUND;
-				break;
-			default:
-				break;
+				uint32_t chunk_id = *reinterpret_cast<const uint32_t*>(&Output[offset]);
+				uint32_t chunk_size = *reinterpret_cast<const uint32_t*>(&Output[offset + 4]);
+				chunk_ids.push_back(chunk_id);
+				offset += 8 + chunk_size;
 			}
+			setChunkIds(m, chunk_ids);
+		}
 
-			switch (i3)
-			{
-			case 'PMA':
-				type = AMP;
-				break;
-			case 0x334449:
-				type = SOUND;
-				break;
-			default:
-				break;
-			}
+		claim.publish(type);
 
-			if (type == AMP || type == SOUND)
-				soundFiles += 1;
-			else if (type == UNKNOWN)
-				unknownFiles += 1;
+		//saveToFile(typeToString(m.type), m.Hash, n, Output, OutSize);
+	}
+}
 
-			m.type = type;
-			m.uncompressedSize = OutSize;
+bool GWDat::readFileType(HANDLE file_handle, unsigned int n)
+{
+	const MFTEntry& m = MFT[n];
 
-			// Extract chunk IDs from FFNA files (Type2 models and Type3 maps)
-			if (type == FFNA_Type2 || type == FFNA_Type3)
-			{
-				m.chunk_ids.clear();
-				int offset = 5;  // Skip FFNA header (4 bytes 'ffna' + 1 byte type)
-				while (offset + 8 <= OutSize)
-				{
-					uint32_t chunk_id = *reinterpret_cast<uint32_t*>(&Output[offset]);
-					uint32_t chunk_size = *reinterpret_cast<uint32_t*>(&Output[offset + 4]);
-					m.chunk_ids.push_back(chunk_id);
-					offset += 8 + chunk_size;
-				}
-			}
+	//Entries that are already classified or have no data don't need to be read
+	std::span<const uint8_t> Input;
+	if (!isClassified(n) && m.b && m.Size > 0)
+	{
+		if (mappedView)
+			Input = getCompressedView(n);
+		else
+			Input = readRange(file_handle, m.Offset, m.Size, GWDecompressContext::ForCurrentThread().Input);
+	}
 
-			//saveToFile(typeToString(m.type), m.Hash, n, Output, OutSize);
+	return readFileType(n, Input);
+}
+
+bool GWDat::readFileType(unsigned int n, std::span<const uint8_t> Input)
+{
+	MFTEntry& m = MFT[n];
+	auto& Context = GWDecompressContext::ForCurrentThread();
+
+	//Already classified, MFT base entries and stored entries gain nothing from a partial decode
+	if (isClassified(n) || !m.b || !m.a)
+	{
+		decodeFileView(n, Input, Context.Output, false);
+		return isClassified(n);
+	}
+
+	if (Input.size() < (size_t)MinEntrySize)
+		return false;
+
+	//Someone else is already classifying it
+	EntryClaim claim(*this, n);
+	if (!claim)
+		return false;
+
+	//The type only depends on the first 8 bytes
+	constexpr int TYPE_SNIFF_SIZE = 16;
+	unsigned char* Output = NULL;
+	int OutSize = 0;
+	int FullSize = 0;
+	UnpackGWDatPrefix(Input.data(), (int)Input.size(), TYPE_SNIFF_SIZE, Output, OutSize, FullSize);
+	std::unique_ptr<unsigned char[]> prefix(Output);
+	if (!Output || OutSize < 8)
+	{
+		//Tiny files are cheaper to just classify in full
+		prefix.reset();
+		claim.release();
+		decodeFileView(n, Input, Context.Output, false);
+		return isClassified(n);
+	}
+
+	int type = classifyType(Output);
+
+	if (type == FFNA_Type2 || type == FFNA_Type3)
+	{
+		thread_local std::vector<uint32_t> chunk_ids;
+		chunk_ids.clear();
+		UnpackGWDatFFNAChunkHeaders(Input.data(), (int)Input.size(), chunk_ids, FullSize);
+		setChunkIds(m, chunk_ids);
+	}
+
+	m.uncompressedSize = FullSize;
+	claim.publish(type);
+	return true;
+}
+
+int GWDat::classifyType(const unsigned char* Output)
+{
+	int type = 0;
+	auto sub_type = Output[4];
+	unsigned int i = ((const unsigned int*)Output)[0];
+	unsigned int k = ((const unsigned int*)Output)[1];
+	int i2 = i & 0xffff;
+	int i3 = i & 0xffffff;
+
+	switch (i)
+	{
+	case 'XTTA':
+		switch (k)
+		{
+		case '1TXD':
+			type = ATTXDXT1;
+			break;
+		case '3TXD':
+			type = ATTXDXT3;
+			break;
+		case '5TXD':
+			type = ATTXDXT5;
+			break;
+		case 'NTXD':
+			type = ATTXDXTN;
+			break;
+		case 'ATXD':
+			type = ATTXDXTA;
+			break;
+		case 'LTXD':
+			type = ATTXDXTL;
+			break;
+		}
+		break;
+	case 'XETA':
+		switch (k)
+		{
+		case '1TXD':
+			type = ATEXDXT1;
+			break;
+		case '2TXD':
+			type = ATEXDXT2;
+			break;
+		case '3TXD':
+			type = ATEXDXT3;
+			break;
+		case '4TXD':
+			type = ATEXDXT4;
+			break;
+		case '5TXD':
+			type = ATEXDXT5;
+			break;
+		case 'NTXD':
+			type = ATEXDXTN;
+			break;
+		case 'ATXD':
+			type = ATEXDXTA;
+			break;
+		case 'LTXD':
+			type = ATEXDXTL;
+			break;
 		}
+		break;
+	case '===;':
+	case '***;':
+		type = TEXT;
+		break;
+	case 'anff':
+		if (sub_type == 2)
+		{
+			type = FFNA_Type2;
+		}
+		else if (sub_type == 3)
+		{
+			type = FFNA_Type3;
+		}
+		else
+		{
+			type = FFNA_Unknown;
+		}
+		break;
+	case ' SDD':
+		type = DDS;
+		break;
+	case 'TAMA':
+		type = AMAT;
+		break;
+	default:
+		type = UNKNOWN;
 	}
-	return Output;
+	switch (i2)
+	{
+	case 0xFAFF:
+	case 0xFBFF:
+		type = SOUND;
+		break;
+	default:
+		break;
+	}
+
+	switch (i3)
+	{
+	case 'PMA':
+		type = AMP;
+		break;
+	case 0x334449:
+		type = SOUND;
+		break;
+	default:
+		break;
+	}
+
+	return type;
 }
 
 bool compareH(MFTExpansion& a, MFTExpansion b) { return a.FileOffset < b.FileOffset; }
@@ -278,10 +635,12 @@ unsigned int GWDat::readDat(const TCHAR* file)
 	//read reserved MFT entries
 	seek(file_handle, GWHead.MFTOffset, SEEK_SET);
 	read(file_handle, &MFTH, sizeof(MFTH), 1);
+	mftChecksum = 0;
 	for (int x = 0; x < 15; ++x)
 	{
 		MFTEntry ME;
 		read(file_handle, &ME, 0x18, 1);
+		MurmurHash3_x86_32(&ME, 0x18, mftChecksum, &mftChecksum);
 		ME.type = NOTREAD;
 		ME.uncompressedSize = -1;
 		ME.Hash = 0;
@@ -299,6 +658,7 @@ unsigned int GWDat::readDat(const TCHAR* file)
 	}
 
 	std::sort(MFTX.begin(), MFTX.end(), compareH);
+	MurmurHash3_x86_32(MFTX.data(), (int)(MFTX.size() * sizeof(MFTExpansion)), mftChecksum, &mftChecksum);
 
 	//read MFT entries
 	unsigned int hashcounter = 0;
@@ -310,6 +670,7 @@ unsigned int GWDat::readDat(const TCHAR* file)
 	{
 		MFTEntry ME;
 		read(file_handle, &ME, 0x18, 1);
+		MurmurHash3_x86_32(&ME, 0x18, mftChecksum, &mftChecksum);
 		ME.type = NOTREAD;
 		ME.uncompressedSize = -1;
 
@@ -335,18 +696,169 @@ unsigned int GWDat::readDat(const TCHAR* file)
 	}
 	CloseHandle(file_handle);
 
-	filesRead = 0;
-	textureFiles = 0;
-	soundFiles = 0;
-	ffnaFiles = 0;
-	unknownFiles = 0;
-	textFiles = 0;
-	mftBaseFiles = 0;
-	amatFiles = 0;
+	entryClaims = std::vector<std::atomic<uint8_t>>(MFT.size());
+	chunkIds.clear();
+	statistics.reset();
+	statistics.moveType(-1, NOTREAD, (int)MFT.size());
 
 	return (unsigned int)MFT.size();
 }
 
+//Index sidecar layout (little endian):
+//  DatIndexHeader
+//  per MFT entry: type, uncompressedSize, murmurhash3, chunk id count, chunk ids
+static constexpr uint32_t DAT_INDEX_MAGIC = 'IBMG';
+static constexpr uint32_t DAT_INDEX_VERSION = 1;
+
+struct DatIndexHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint64_t fileSize;
+	uint64_t lastWriteTime;
+	uint32_t mftChecksum;
+	uint32_t entryCount;
+	uint32_t counters[8];
+};
+
+struct DatIndexRecord
+{
+	int32_t type;
+	int32_t uncompressedSize;
+	uint32_t murmurhash3;
+	uint32_t chunkIdCount;
+};
+
+DatIndexKey GWDat::getIndexKey(const std::filesystem::path& file) const
+{
+	DatIndexKey key{};
+	std::error_code ec;
+	key.fileSize = std::filesystem::file_size(file, ec);
+	if (ec)
+		key.fileSize = 0;
+
+	auto write_time = std::filesystem::last_write_time(file, ec);
+	if (!ec)
+		key.lastWriteTime = (uint64_t)write_time.time_since_epoch().count();
+
+	key.mftChecksum = mftChecksum;
+	return key;
+}
+
+bool GWDat::loadIndex(const std::filesystem::path& index_path, const DatIndexKey& key)
+{
+	std::ifstream file(index_path, std::ios::binary);
+	if (!file.is_open())
+		return false;
+
+	DatIndexHeader header;
+	if (!file.read((char*)&header, sizeof(header)))
+		return false;
+
+	if (header.magic != DAT_INDEX_MAGIC || header.version != DAT_INDEX_VERSION ||
+		header.fileSize != key.fileSize || header.lastWriteTime != key.lastWriteTime ||
+		header.mftChecksum != key.mftChecksum || header.entryCount != MFT.size())
+	{
+		return false;
+	}
+
+	//Decode into a scratch copy first so a truncated sidecar leaves the MFT untouched
+	std::vector<DatIndexRecord> records(header.entryCount);
+	std::vector<uint32_t> chunk_ids;
+	for (uint32_t x = 0; x < header.entryCount; ++x)
+	{
+		if (!file.read((char*)&records[x], sizeof(DatIndexRecord)))
+			return false;
+
+		//FFNA files only have a handful of chunks, anything larger means the file is corrupt
+		if (records[x].chunkIdCount > 0x10000)
+			return false;
+
+		const size_t first = chunk_ids.size();
+		chunk_ids.resize(first + records[x].chunkIdCount);
+		if (records[x].chunkIdCount &&
+			!file.read((char*)&chunk_ids[first], records[x].chunkIdCount * sizeof(uint32_t)))
+			return false;
+	}
+
+	chunkIds.clear();
+	size_t first = 0;
+	for (uint32_t x = 0; x < header.entryCount; ++x)
+	{
+		MFT[x].type = records[x].type;
+		MFT[x].uncompressedSize = records[x].uncompressedSize;
+		MFT[x].murmurhash3 = records[x].murmurhash3;
+		setChunkIds(MFT[x], std::span<const uint32_t>(chunk_ids).subspan(first, records[x].chunkIdCount));
+		first += records[x].chunkIdCount;
+	}
+
+	//The per-type counts follow from the types, only the number of reads needs restoring
+	statistics.reset();
+	for (const MFTEntry& m : MFT)
+		statistics.moveType(-1, m.type);
+	statistics.addFilesRead((int)header.counters[0]);
+
+	return true;
+}
+
+bool GWDat::saveIndex(const std::filesystem::path& index_path, const DatIndexKey& key) const
+{
+	std::error_code ec;
+	std::filesystem::create_directories(index_path.parent_path(), ec);
+
+	//Write to a temporary file and swap it in so a crash never leaves a half written index behind
+	auto tmp_path = index_path;
+	tmp_path += L".tmp";
+
+	{
+		std::ofstream file(tmp_path, std::ios::binary | std::ios::trunc);
+		if (!file.is_open())
+			return false;
+
+		DatIndexHeader header{};
+		header.magic = DAT_INDEX_MAGIC;
+		header.version = DAT_INDEX_VERSION;
+		header.fileSize = key.fileSize;
+		header.lastWriteTime = key.lastWriteTime;
+		header.mftChecksum = key.mftChecksum;
+		header.entryCount = (uint32_t)MFT.size();
+		header.counters[0] = getFilesRead();
+		header.counters[1] = getTextureFiles();
+		header.counters[2] = getSoundFiles();
+		header.counters[3] = getFfnaFiles();
+		header.counters[4] = getUnknownFiles();
+		header.counters[5] = getTextFiles();
+		header.counters[6] = getMftBaseFiles();
+		header.counters[7] = getAmatFiles();
+		file.write((const char*)&header, sizeof(header));
+
+		for (const auto& m : MFT)
+		{
+			DatIndexRecord record;
+			record.type = m.type;
+			record.uncompressedSize = m.uncompressedSize;
+			record.murmurhash3 = m.murmurhash3;
+			const auto ids = chunkIds.get(m.chunkIdOffset, m.chunkIdCount);
+			record.chunkIdCount = (uint32_t)ids.size();
+			file.write((const char*)&record, sizeof(record));
+			if (!ids.empty())
+				file.write((const char*)ids.data(), ids.size() * sizeof(uint32_t));
+		}
+
+		if (!file.good())
+			return false;
+	}
+
+	std::filesystem::rename(tmp_path, index_path, ec);
+	if (ec)
+	{
+		std::filesystem::remove(tmp_path, ec);
+		return false;
+	}
+
+	return true;
+}
+
 class compareNAsc
 {
 public:
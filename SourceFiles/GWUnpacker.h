@@ -1,5 +1,10 @@
 #pragma once
 #include <vector>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
 
 struct MainHeader
 {
@@ -65,7 +70,9 @@ struct MFTEntry
 	__int32 uncompressedSize;
 	__int32 Hash;
 	uint32_t murmurhash3;
-	std::vector<uint32_t> chunk_ids;  // Chunk IDs found in FFNA files
+	// Chunk IDs found in FFNA files, stored in the DAT's ChunkIdPool, see GWDat::getChunkIds
+	uint32_t chunkIdOffset = 0;
+	uint32_t chunkIdCount = 0;
 };
 
 struct MFTExpansion
@@ -74,11 +81,207 @@ struct MFTExpansion
 	int FileOffset;
 };
 
+// Decompressed contents of a single DAT entry returned by GWDat::readFileView.
+// Stored (uncompressed) entries point straight into the mapped DAT and leave owned empty.
+struct DatFileView
+{
+	std::span<const uint8_t> data;
+	std::unique_ptr<unsigned char[]> owned;
+
+	explicit operator bool() const { return !data.empty(); }
+};
+
+// Identifies the exact DAT a persisted index was built from, see GWDat::saveIndex
+struct DatIndexKey
+{
+	uint64_t fileSize;
+	uint64_t lastWriteTime;
+	uint32_t mftChecksum;
+};
+
+//Chunk IDs of every FFNA entry, packed into a few large blocks instead of a vector per entry.
+//Ids are addressed by offset and count. Appending is thread safe and never moves existing ids,
+//so spans returned by get stay valid until clear.
+class ChunkIdPool
+{
+public:
+	//The largest list a single entry can have, longer ones are truncated
+	static constexpr uint32_t BlockSize = 0x10000;
+
+	ChunkIdPool() : Blocks(new std::unique_ptr<uint32_t[]>[MaxBlocks]) {}
+
+	//Returns the offset of the stored ids, nothing if there are none or the pool is full
+	std::optional<uint32_t> append(std::span<const uint32_t> ids)
+	{
+		if (ids.empty())
+			return std::nullopt;
+
+		const uint32_t count = (uint32_t)std::min<size_t>(ids.size(), BlockSize);
+
+		uint32_t offset;
+		{
+			std::lock_guard<std::mutex> lock(Mutex);
+
+			//Lists never straddle two blocks
+			if (NumBlocks == 0 || Used + count > BlockSize)
+			{
+				if (NumBlocks == MaxBlocks)
+					return std::nullopt;
+				Blocks[NumBlocks++].reset(new uint32_t[BlockSize]);
+				Used = 0;
+			}
+
+			offset = (NumBlocks - 1) * BlockSize + Used;
+			Used += count;
+		}
+
+		//The range is ours alone, it's published to readers with the entry's type
+		std::copy_n(ids.begin(), count, &Blocks[offset / BlockSize][offset % BlockSize]);
+		return offset;
+	}
+
+	std::span<const uint32_t> get(uint32_t offset, uint32_t count) const
+	{
+		if (count == 0)
+			return {};
+		return std::span<const uint32_t>(&Blocks[offset / BlockSize][offset % BlockSize], count);
+	}
+
+	//Not thread safe, only for (re)loading a whole MFT
+	void clear()
+	{
+		for (uint32_t i = 0; i < NumBlocks; ++i)
+			Blocks[i].reset();
+		NumBlocks = 0;
+		Used = 0;
+	}
+
+private:
+	//4096 blocks of 64K ids, far more than any DAT has
+	static constexpr uint32_t MaxBlocks = 4096;
+
+	std::mutex Mutex;
+	std::unique_ptr<std::unique_ptr<uint32_t[]>[]> Blocks;
+	uint32_t NumBlocks = 0;
+	uint32_t Used = 0;
+};
+
+//Per-type file counts and the number of files read, bumped by every thread that classifies entries.
+//Each thread adds to its own cache line aligned shard so the scan workers never contend, and the
+//totals are summed over the shards when read, so they are exact and can be read while a scan runs.
+class GWDatStatistics
+{
+public:
+	static constexpr int NumTypes = UNKNOWN + 1;
+
+	GWDatStatistics() : Shards(new Shard[NumShards]) { reset(); }
+
+	void reset()
+	{
+		for (int s = 0; s < NumShards; ++s)
+		{
+			Shards[s].FilesRead.store(0, std::memory_order_relaxed);
+			for (auto& count : Shards[s].Types)
+				count.store(0, std::memory_order_relaxed);
+		}
+	}
+
+	void addFilesRead(int count = 1) { localShard().FilesRead.fetch_add(count, std::memory_order_relaxed); }
+
+	//Moves count entries from one type to another, e.g. from NOTREAD to their type once classified
+	void moveType(int from, int to, int count = 1)
+	{
+		Shard& shard = localShard();
+		if (from >= 0 && from < NumTypes)
+			shard.Types[from].fetch_sub(count, std::memory_order_relaxed);
+		if (to >= 0 && to < NumTypes)
+			shard.Types[to].fetch_add(count, std::memory_order_relaxed);
+	}
+
+	unsigned int getFilesRead() const
+	{
+		int64_t total = 0;
+		for (int s = 0; s < NumShards; ++s)
+			total += Shards[s].FilesRead.load(std::memory_order_relaxed);
+		return (unsigned int)total;
+	}
+
+	unsigned int getNumFilesForType(int type) const
+	{
+		if (type < 0 || type >= NumTypes)
+			return 0;
+
+		int64_t total = 0;
+		for (int s = 0; s < NumShards; ++s)
+			total += Shards[s].Types[type].load(std::memory_order_relaxed);
+		return total > 0 ? (unsigned int)total : 0;
+	}
+
+private:
+	static constexpr int NumShards = 64;
+
+	//A shard can go negative when an entry is counted in one shard and moved out of it from another
+	struct alignas(64) Shard
+	{
+		std::atomic<int64_t> FilesRead;
+		std::atomic<int64_t> Types[NumTypes];
+	};
+
+	std::unique_ptr<Shard[]> Shards;
+
+	Shard& localShard()
+	{
+		static std::atomic<unsigned int> NextShard{ 0 };
+		thread_local unsigned int ShardIndex = NextShard.fetch_add(1, std::memory_order_relaxed) % NumShards;
+		return Shards[ShardIndex];
+	}
+};
+
 class GWDat
 {
 public:
+	GWDat() = default;
+	~GWDat() { unmapDat(); }
+	GWDat(const GWDat&) = delete;
+	GWDat& operator=(const GWDat&) = delete;
+
+	//Entries shorter than this can't be decoded or classified and are never read
+	static constexpr int MinEntrySize = 8;
+
 	unsigned int readDat(const TCHAR* file);
 	unsigned char* readFile(HANDLE file_handle, unsigned int n, bool translate = true);
+	// Decompresses into output, reusing its capacity. Returns false if there was nothing to read.
+	bool readFile(HANDLE file_handle, unsigned int n, std::vector<unsigned char>& output, bool translate = true);
+
+	// Memory-mapped read mode. Once mapped, readFile ignores its file handle and
+	// readFileView can hand out views without any syscalls or copies.
+	bool mapDat(const TCHAR* file);
+	void unmapDat();
+	bool isMapped() const { return mappedView != nullptr; }
+	std::span<const uint8_t> getCompressedView(unsigned int n) const;
+	DatFileView readFileView(unsigned int n, bool translate = true);
+	// Same, but compressed entries are decompressed into storage and the view doesn't own anything
+	DatFileView readFileView(unsigned int n, std::vector<unsigned char>& storage, bool translate = true);
+	// Same as readFileView with storage, for an entry whose compressed bytes were already read,
+	// e.g. as part of a larger range. Works whether or not the DAT is mapped.
+	DatFileView decodeFileView(unsigned int n, std::span<const uint8_t> compressed, std::vector<unsigned char>& storage,
+	                           bool translate = true);
+
+	// Raw bytes [offset, offset + size) of the DAT. Points into the mapping when mapped,
+	// otherwise they are read into buffer with a single read.
+	std::span<const uint8_t> readRange(HANDLE file_handle, __int64 offset, int size, std::vector<unsigned char>& buffer);
+
+	// Classifies an entry while decompressing as little of it as possible: only a short prefix,
+	// plus the chunk headers for FFNA files. murmurhash3 is left unset for compressed entries
+	// and gets filled in the first time the entry is read in full.
+	bool readFileType(HANDLE file_handle, unsigned int n);
+	bool readFileType(unsigned int n, std::span<const uint8_t> compressed);
+
+	// Persisted results of the full type scan (type, uncompressed size, murmurhash3 and chunk ids).
+	// loadIndex only succeeds if the sidecar was written for a DAT with the same key.
+	DatIndexKey getIndexKey(const std::filesystem::path& file) const;
+	bool loadIndex(const std::filesystem::path& index_path, const DatIndexKey& key);
+	bool saveIndex(const std::filesystem::path& index_path, const DatIndexKey& key) const;
 
 	MFTEntry& operator[](const int n) { return MFT[n]; }
 
@@ -96,14 +299,25 @@ public:
 
 	void sort(unsigned int* index, int column, bool ascending);
 
-	unsigned int getFilesRead() const { return filesRead; }
-	unsigned int getTextureFiles() const { return textureFiles; }
-	unsigned int getSoundFiles() const { return soundFiles; }
-	unsigned int getFfnaFiles() const { return ffnaFiles; }
-	unsigned int getUnknownFiles() const { return unknownFiles; }
-	unsigned int getTextFiles() const { return textFiles; }
-	unsigned int getMftBaseFiles() const { return mftBaseFiles; }
-	unsigned int getAmatFiles() const { return amatFiles; }
+	//All of these are safe to call while other threads are reading files
+	unsigned int getFilesRead() const { return statistics.getFilesRead(); }
+	unsigned int getNumFilesForType(int type) const { return statistics.getNumFilesForType(type); }
+	unsigned int getTextureFiles() const;
+	unsigned int getSoundFiles() const { return getNumFilesForType(AMP) + getNumFilesForType(SOUND); }
+	unsigned int getFfnaFiles() const;
+	unsigned int getUnknownFiles() const { return getNumFilesForType(UNKNOWN); }
+	unsigned int getTextFiles() const { return getNumFilesForType(TEXT); }
+	unsigned int getMftBaseFiles() const { return getNumFilesForType(MFTBASE); }
+	unsigned int getAmatFiles() const { return getNumFilesForType(AMAT); }
+
+	//Empty until the entry has been classified. Stays valid for the lifetime of the GWDat.
+	std::span<const uint32_t> getChunkIds(unsigned int n) const;
+
+	//Whether the entry's type has been published, after which its type, uncompressedSize and chunk_ids don't change
+	bool isClassified(unsigned int n) const;
+
+	//Hash of the decompressed file, 0 until a full read (or a loaded index) has computed it
+	uint32_t getMurmurHash3(unsigned int n) const;
 
 	HANDLE get_dat_filehandle(const TCHAR* file);
 
@@ -112,23 +326,73 @@ protected:
 	MFTHeader MFTH;
 	std::vector<MFTExpansion> MFTX;
 	std::vector<MFTEntry> MFT;
+	uint32_t mftChecksum = 0;
 
-	//Critical Section to make readFile thread safe
+	//Read-only mapping of the whole DAT, see mapDat
+	HANDLE mappedFile = INVALID_HANDLE_VALUE;
+	HANDLE mappedFileMapping = NULL;
+	const uint8_t* mappedView = nullptr;
+	uint64_t mappedSize = 0;
 
 	//Counters for statistics
-	unsigned int filesRead;
-	unsigned int textureFiles;
-	unsigned int soundFiles;
-	unsigned int ffnaFiles;
-	unsigned int unknownFiles;
-	unsigned int textFiles;
-	unsigned int mftBaseFiles;
-	unsigned int amatFiles;
+	GWDatStatistics statistics;
+
+	ChunkIdPool chunkIds;
+
+	//One flag per MFT entry, set by the thread that gets to classify it, see claimEntry
+	std::vector<std::atomic<uint8_t>> entryClaims;
 
 protected:
 	//wrappers for the OS seek and read functions
 	void seek(HANDLE file_handle, __int64 offset, int origin);
 	void read(HANDLE file_handle, void* buffer, int size, int count);
+
+	//handles MFT base entries, returns false if there is nothing to decompress
+	bool beginRead(unsigned int n, bool translate);
+	//fills in type, size, hash and chunk ids the first time an entry is decompressed
+	void classifyEntry(unsigned int n, const unsigned char* Output, int OutSize);
+	//sniffs the file type from the first 8 bytes of a decompressed file
+	int classifyType(const unsigned char* Output);
+
+	//Several threads can decompress the same entry at once (the scan and the UI, or two scan jobs).
+	//Only the one that claims it writes its size and chunk ids, and then publishes its type with
+	//release semantics, so anyone who sees the type also sees the rest.
+	bool claimEntry(unsigned int n);
+	void releaseEntry(unsigned int n);
+	void publishEntry(unsigned int n, int type);
+	//stores the ids in the chunk id pool, call before publishEntry
+	void setChunkIds(MFTEntry& m, std::span<const uint32_t> ids);
+
+	//A claimEntry that is given back when it goes out of scope unless the entry was published, so an
+	//exception (bad_alloc) while classifying doesn't leave the entry claimed and never classified
+	class EntryClaim
+	{
+	public:
+		EntryClaim(GWDat& dat, unsigned int n) : Dat(dat), N(n), Held(dat.claimEntry(n)) {}
+		~EntryClaim() { release(); }
+		EntryClaim(const EntryClaim&) = delete;
+		EntryClaim& operator=(const EntryClaim&) = delete;
+
+		explicit operator bool() const { return Held; }
+
+		void release()
+		{
+			if (Held)
+				Dat.releaseEntry(N);
+			Held = false;
+		}
+
+		void publish(int type)
+		{
+			Held = false;
+			Dat.publishEntry(N, type);
+		}
+
+	private:
+		GWDat& Dat;
+		unsigned int N;
+		bool Held;
+	};
 };
 
 inline std::string typeToString(int type)
@@ -0,0 +1,48 @@
+#pragma once
+#include <cstdint>
+#include <span>
+#include <vector>
+
+// A width * height grid stored row by row in a single allocation. grid[z][x] indexes it like the
+// nested vectors it replaces, row(z) and data() hand whole rows or the whole grid to code that
+// uploads or writes it out without copying.
+template <typename T>
+class Grid2D
+{
+public:
+    Grid2D() = default;
+    Grid2D(uint32_t width, uint32_t height, const T& value = T())
+        : m_width(width)
+        , m_height(height)
+        , m_cells((size_t)width * height, value)
+    {
+    }
+
+    uint32_t width() const { return m_width; }
+    uint32_t height() const { return m_height; }
+    bool empty() const { return m_cells.empty(); }
+
+    // Bytes from one row to the next, the pitch for a texture upload straight from data()
+    size_t row_pitch() const { return (size_t)m_width * sizeof(T); }
+
+    T* operator[](size_t z) { return m_cells.data() + z * m_width; }
+    const T* operator[](size_t z) const { return m_cells.data() + z * m_width; }
+
+    T& at(uint32_t x, uint32_t z) { return m_cells[(size_t)z * m_width + x]; }
+    const T& at(uint32_t x, uint32_t z) const { return m_cells[(size_t)z * m_width + x]; }
+
+    std::span<T> row(uint32_t z) { return std::span<T>(m_cells).subspan((size_t)z * m_width, m_width); }
+    std::span<const T> row(uint32_t z) const
+    {
+        return std::span<const T>(m_cells).subspan((size_t)z * m_width, m_width);
+    }
+
+    T* data() { return m_cells.data(); }
+    const T* data() const { return m_cells.data(); }
+    std::span<const T> cells() const { return m_cells; }
+
+private:
+    uint32_t m_width = 0;
+    uint32_t m_height = 0;
+    std::vector<T> m_cells;
+};
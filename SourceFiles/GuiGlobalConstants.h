@@ -41,6 +41,13 @@ public:
 	inline static int window_pos_y = -1;
 	inline static bool window_maximized = false;
 
+	// Decoded texture disk cache, an empty directory uses the default next to the executable
+	inline static std::string texture_cache_dir;
+	inline static int texture_cache_max_mb = 2048;
+
+	// Classify DAT files by decompressing only their headers when a DAT is opened, see DATManager::set_quick_type_scan
+	inline static bool quick_type_scan = false;
+
 	inline static bool prev_is_dat_browser_open;
 	inline static bool prev_is_dat_browser_resizeable;
 	inline static bool prev_is_dat_browser_movable;
@@ -239,6 +246,13 @@ public:
 		file << "window_pos_y=" << window_pos_y << "\n";
 		file << "window_maximized=" << (window_maximized ? 1 : 0) << "\n";
 
+		file << "[TextureCache]\n";
+		file << "texture_cache_dir=" << texture_cache_dir << "\n";
+		file << "texture_cache_max_mb=" << texture_cache_max_mb << "\n";
+
+		file << "[DatScan]\n";
+		file << "quick_type_scan=" << (quick_type_scan ? 1 : 0) << "\n";
+
 		file.close();
 	}
 
@@ -261,6 +275,11 @@ public:
 			if (pos == std::string::npos) continue;
 
 			std::string key = line.substr(0, pos);
+			if (key == "texture_cache_dir") {
+				texture_cache_dir = line.substr(pos + 1);
+				continue;
+			}
+
 			int value = std::stoi(line.substr(pos + 1));
 
 			if (key == "dat_browser") is_dat_browser_open = (value != 0);
@@ -285,7 +304,9 @@ public:
 			else if (key == "window_height") window_height = value;
 			else if (key == "window_pos_x") window_pos_x = value;
 			else if (key == "window_pos_y") window_pos_y = value;
+			else if (key == "quick_type_scan") quick_type_scan = (value != 0);
 			else if (key == "window_maximized") window_maximized = (value != 0);
+			else if (key == "texture_cache_max_mb") texture_cache_max_mb = value;
 		}
 
 		file.close();
@@ -5,11 +5,16 @@
 #include "MapBrowser.h"
 #include "GuiGlobalConstants.h"
 #include "InputManager.h"
+#include "TextureDiskCache.h"
 #include "ModelViewer/ModelViewer.h"
 #include "Extract_BASS_DLL_resource.h"
 #include "imgui.h"
+#include "Benchmarks/BlockDecodeBenchmark.h"
+#include "Benchmarks/DecompressionBenchmark.h"
+#include "Benchmarks/TextureDecodeBenchmark.h"
 #include <filesystem>
 #include <DbgHelp.h>
+#include <shellapi.h>
 
 LONG WINAPI UnhandledExceptionHandler(EXCEPTION_POINTERS* pExceptionPointers) {
     // Create mini dump file
@@ -246,6 +251,126 @@ extern "C"
     __declspec(dllexport) int AmdPowerXpressRequestHighPerformance = 1;
 }
 
+// Headless benchmarks, run from a console instead of opening the window:
+//   GuildWarsMapBrowser.exe --benchmark-decompression <path to Gw.dat> [max files] [repetitions]
+//   GuildWarsMapBrowser.exe --benchmark-bcn <path to Gw.dat> [max textures] [repetitions]
+//   GuildWarsMapBrowser.exe --benchmark-textures <directory of raw textures> [repetitions] [--update-golden]
+// Returns std::nullopt when the command line doesn't ask for a benchmark.
+std::optional<int> RunCommandLineBenchmark(LPWSTR lpCmdLine)
+{
+    if (! lpCmdLine || ! *lpCmdLine)
+        return std::nullopt;
+
+    int argc = 0;
+    LPWSTR* argv = CommandLineToArgvW(lpCmdLine, &argc);
+    if (! argv)
+        return std::nullopt;
+
+    std::vector<std::wstring> args(argv, argv + argc);
+    LocalFree(argv);
+
+    if (args.empty() || (args[0] != L"--benchmark-decompression" && args[0] != L"--benchmark-bcn" &&
+                         args[0] != L"--benchmark-textures"))
+        return std::nullopt;
+
+    if (AttachConsole(ATTACH_PARENT_PROCESS) || AllocConsole())
+    {
+        FILE* stream = nullptr;
+        freopen_s(&stream, "CONOUT$", "w", stdout);
+    }
+
+    if (args[0] == L"--benchmark-textures")
+    {
+        if (args.size() < 2)
+        {
+            printf("Usage: %ls <directory of raw textures> [repetitions] [--update-golden]\n", args[0].c_str());
+            return 1;
+        }
+
+        const bool update_golden = std::find(args.begin() + 2, args.end(), L"--update-golden") != args.end();
+        const int repetitions = args.size() > 2 && args[2] != L"--update-golden" ? std::max(1, _wtoi(args[2].c_str())) : 1;
+
+        const auto result = GW::Benchmarks::RunTextureDecodeBenchmark(args[1], repetitions, update_golden);
+        for (int format = 0; format < GW::Benchmarks::TextureDecodeFormatCount; format++)
+        {
+            const auto& format_result = result.formats[format];
+            if (! format_result.textures && ! format_result.failed)
+                continue;
+
+            printf("%s: %u textures (%u failed), %.1f MB, %.1f Mtexels\n",
+                GW::Benchmarks::GetTextureDecodeFormatName(format), format_result.textures, format_result.failed,
+                format_result.inputBytes / (1024.0 * 1024.0), format_result.texels / 1e6);
+            printf("  Decode:     %.3f s, %.1f MB/s, %.1f textures/s\n", format_result.decodeSeconds,
+                format_result.MBps(), format_result.TexturesPerSecond(repetitions));
+            if (format != GW::Benchmarks::TextureDecodeDDS)
+                printf("  Decompress: %.3f s, block decode: %.3f s\n", format_result.decompressSeconds,
+                    format_result.blockDecodeSeconds);
+        }
+
+        printf("Skipped %u files that aren't textures\n", result.skipped);
+        if (update_golden)
+        {
+            printf(result.manifestWritten ? "Wrote golden manifest\n" : "Failed to write golden manifest\n");
+            return result.manifestWritten ? 0 : 1;
+        }
+
+        if (! result.manifestRead)
+        {
+            printf("Failed to read golden manifest, run with --update-golden to create it\n");
+            return 1;
+        }
+
+        printf("Golden: %u match, %u mismatch, %u not in manifest, %u in manifest but not found\n",
+            result.goldenMatches, result.goldenMismatches, result.goldenMissing, result.goldenNotFound);
+        return result.goldenMismatches || result.goldenNotFound ? 2 : 0;
+    }
+
+    if (args.size() < 2)
+    {
+        printf("Usage: %ls <path to Gw.dat> [max files] [repetitions]\n", args[0].c_str());
+        return 1;
+    }
+
+    const uint32_t max_files = args.size() > 2 ? (uint32_t)std::wcstoul(args[2].c_str(), nullptr, 10) : 0;
+    const int repetitions = args.size() > 3 ? std::max(1, _wtoi(args[3].c_str())) : 1;
+
+    GWDat dat;
+    if (! dat.readDat(args[1].c_str()) || ! dat.mapDat(args[1].c_str()))
+    {
+        printf("Failed to open %ls\n", args[1].c_str());
+        return 1;
+    }
+
+    if (args[0] == L"--benchmark-bcn")
+    {
+        const auto result = GW::Benchmarks::RunBlockDecodeBenchmark(dat, max_files, repetitions);
+        uint32_t mismatches = 0;
+        for (int format = 0; format < GW::Benchmarks::BlockDecodeFormatCount; format++)
+        {
+            const auto& format_result = result[format];
+            printf("%s: %u textures, %.1f Mtexels\n", GW::Benchmarks::GetBlockDecodeFormatName(format),
+                format_result.textures, format_result.texels / 1e6);
+            printf("  Reference decoder: %.3f s, %.1f Mtexels/s\n", format_result.referenceSeconds,
+                format_result.ReferenceMTexelsPerSecond());
+            printf("  Block decoder:     %.3f s, %.1f Mtexels/s\n", format_result.blockSeconds,
+                format_result.BlockMTexelsPerSecond());
+            printf("  Mismatches: %u\n", format_result.mismatches);
+            mismatches += format_result.mismatches;
+        }
+
+        return mismatches ? 2 : 0;
+    }
+
+    const auto result = GW::Benchmarks::RunDecompressionBenchmark(dat, max_files, repetitions);
+    printf("Decoded %u files, %.1f MB compressed, %.1f MB decompressed\n", result.filesDecoded,
+        result.compressedBytes / (1024.0 * 1024.0), result.decompressedBytes / (1024.0 * 1024.0));
+    printf("Reference decoder: %.3f s, %.1f MB/s\n", result.referenceSeconds, result.ReferenceMBps());
+    printf("Table decoder:     %.3f s, %.1f MB/s\n", result.fastSeconds, result.FastMBps());
+    printf("Mismatches: %u\n", result.mismatches);
+
+    return result.mismatches ? 2 : 0;
+}
+
 // Entry point
 int WINAPI wWinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance, _In_ LPWSTR lpCmdLine,
     _In_ int nCmdShow)
@@ -253,7 +378,9 @@ int WINAPI wWinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance,
     SetUnhandledExceptionFilter(UnhandledExceptionHandler);
 
     UNREFERENCED_PARAMETER(hPrevInstance);
-    UNREFERENCED_PARAMETER(lpCmdLine);
+
+    if (const auto benchmark_result = RunCommandLineBenchmark(lpCmdLine))
+        return *benchmark_result;
 
     if (! XMVerifyCPUSupport())
         return 1;
@@ -282,6 +409,12 @@ int WINAPI wWinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance,
         // Load settings
         GuiGlobalConstants::LoadSettings();
 
+        const std::filesystem::path texture_cache_dir = GuiGlobalConstants::texture_cache_dir.empty()
+            ? TextureDiskCache::get_default_directory().value_or(std::filesystem::path())
+            : std::filesystem::path(GuiGlobalConstants::texture_cache_dir);
+        TextureDiskCache::shared().configure(texture_cache_dir,
+                                             (uint64_t)std::max(GuiGlobalConstants::texture_cache_max_mb, 0) * 1024 * 1024);
+
         int x = CW_USEDEFAULT;
         int y = CW_USEDEFAULT;
         int w, h;
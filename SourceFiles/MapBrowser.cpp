@@ -139,6 +139,7 @@ void MapBrowser::Update(duration<double, std::milli> elapsed)
 {
     if (gw_dat_path_set && m_dat_managers[0]->m_initialization_state == InitializationState::NotStarted)
     {
+        m_dat_managers[0]->set_quick_type_scan(GuiGlobalConstants::quick_type_scan);
         bool succeeded = m_dat_managers[0]->Init(gw_dat_path);
         if (!succeeded)
         {
@@ -1310,8 +1311,6 @@ void MapBrowser::ProcessTextureExtraction(int index, const std::wstring& save_di
 
     const auto& entry = mft[index];
     unsigned char* raw_data = nullptr;
-    ComPtr<ID3D11Texture2D> localTexture;
-    ComPtr<ID3D11ShaderResourceView> localSrv;
     int texWidth = 0, texHeight = 0;
     std::vector<RGBA> rgba_data; // Needed for DDS parsing result
     DirectX::ScratchImage ddsImage; // To hold data from DDS
@@ -1326,7 +1325,6 @@ void MapBrowser::ProcessTextureExtraction(int index, const std::wstring& save_di
         DXGI_FORMAT format = DXGI_FORMAT_UNKNOWN;
         const void* pixelDataPtr = nullptr;
         UINT bytesPerPixel = 0;
-        ComPtr<ID3D11Device> device = m_deviceResources->GetD3DDevice();
 
         if (entry.type == DDS) {
             DirectX::TexMetadata metadata;
@@ -1373,42 +1371,11 @@ void MapBrowser::ProcessTextureExtraction(int index, const std::wstring& save_di
             throw std::runtime_error(std::format("Attempting to extract non-texture file at index {} as texture.", index));
         }
 
-        if (!pixelDataPtr || texWidth <= 0 || texHeight <= 0 || bytesPerPixel == 0) {
+        if (!pixelDataPtr || texWidth <= 0 || texHeight <= 0 || bytesPerPixel != sizeof(RGBA)) {
             throw std::runtime_error(std::format("Invalid texture data derived for index {}.", index));
         }
 
 
-        // Create temporary D3D11Texture2D
-        D3D11_TEXTURE2D_DESC texDesc = {};
-        texDesc.Width = texWidth;
-        texDesc.Height = texHeight;
-        texDesc.MipLevels = 1; // Create only one mip level for saving
-        texDesc.ArraySize = 1;
-        texDesc.Format = format; // Use the determined format
-        texDesc.SampleDesc.Count = 1;
-        texDesc.Usage = D3D11_USAGE_DEFAULT;
-        texDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
-        texDesc.CPUAccessFlags = 0;
-        texDesc.MiscFlags = 0;
-
-        D3D11_SUBRESOURCE_DATA initData = {};
-        initData.pSysMem = pixelDataPtr;
-        initData.SysMemPitch = texWidth * bytesPerPixel;
-        initData.SysMemSlicePitch = initData.SysMemPitch * texHeight;
-
-        HRESULT hr = device->CreateTexture2D(&texDesc, &initData, localTexture.GetAddressOf());
-        if (FAILED(hr)) throw std::runtime_error(std::format("CreateTexture2D failed for index {}. HRESULT: 0x{:X}", index, hr));
-
-        // Create temporary ID3D11ShaderResourceView
-        D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
-        srvDesc.Format = texDesc.Format;
-        srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
-        srvDesc.Texture2D.MipLevels = 1;
-        srvDesc.Texture2D.MostDetailedMip = 0;
-
-        hr = device->CreateShaderResourceView(localTexture.Get(), &srvDesc, localSrv.GetAddressOf());
-        if (FAILED(hr)) throw std::runtime_error(std::format("CreateShaderResourceView failed for index {}. HRESULT: 0x{:X}", index, hr));
-
         // --- Create Subfolder ---
         FileType fileTypeEnum = static_cast<FileType>(entry.type);
         std::wstring typeSubfolderName = typeToWString(fileTypeEnum);
@@ -1432,11 +1399,8 @@ void MapBrowser::ProcessTextureExtraction(int index, const std::wstring& save_di
         std::wstring filename = std::format(L"texture_0x{:X}.png", entry.Hash);
         std::filesystem::path fullPath = subFolderPath / filename;
 
-        std::wstring fullPathStr = fullPath.wstring();
-        if (!m_map_renderer || !m_map_renderer->GetTextureManager()) {
-            throw std::runtime_error("TextureManager is not available for saving.");
-        }
-        if (!SaveTextureToPng(localSrv.Get(), fullPathStr, m_map_renderer->GetTextureManager())) {
+        // Both paths above leave B8G8R8A8 texels, encoded on the CPU without a D3D texture
+        if (!WritePng(fullPath, static_cast<const RGBA*>(pixelDataPtr), texWidth, texHeight, PngPixelOrder::BGRA)) {
             throw std::runtime_error(std::format("Failed to save texture to PNG for index {}.", index));
         }
 
@@ -1445,7 +1409,6 @@ void MapBrowser::ProcessTextureExtraction(int index, const std::wstring& save_di
             delete[] raw_data;
             raw_data = nullptr;
         }
-        // ComPtrs handle D3D resource release automatically
     }
     catch (const std::exception& e) {
         // Log the error instead of showing a popup and stopping
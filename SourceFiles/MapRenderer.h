@@ -445,32 +445,31 @@ public:
         const auto& texture_index_grid = terrain->get_texture_index_grid();
         const auto& terrain_shadow_map_grid = terrain->get_terrain_shadow_map_grid();
 
-        // Create a 2D texture from the texture_index_grid
+        // The textures are the first m_grid_dim_z rows and m_grid_dim_x columns of the grids, uploaded
+        // straight from them with the grids' row pitch
         texture_width = terrain->m_grid_dim_x;
         texture_height = terrain->m_grid_dim_z;
-        std::vector<uint8_t> terain_texture_data(texture_width * texture_height);
-        std::vector<uint8_t> terrain_shadow_map_data(texture_width * texture_height);
-        for (int i = 0; i < texture_height; ++i)
-        {
-            for (int j = 0; j < texture_width; ++j)
-            {
-                terain_texture_data[i * texture_width + j] = texture_index_grid[i][j];
-                terrain_shadow_map_data[i * texture_width + j] = terrain_shadow_map_grid[i][j];
-            }
-        }
 
         // Create the texture and add it to the texture manager
-        m_terrain_texture_indices_id = m_texture_manager->AddTexture(
-            terain_texture_data.data(), texture_width, texture_height, DXGI_FORMAT_R8_UNORM, -1);
+        m_terrain_texture_indices_id = m_texture_manager->AddTexture(texture_index_grid.data(), texture_width,
+            texture_height, DXGI_FORMAT_R8_UNORM, -1, true, (UINT)texture_index_grid.row_pitch());
 
-        m_terrain_shadow_map_id = m_texture_manager->AddTexture(
-            terrain_shadow_map_data.data(), texture_width, texture_height, DXGI_FORMAT_R8_UNORM, -1);
+        m_terrain_shadow_map_id = m_texture_manager->AddTexture(terrain_shadow_map_grid.data(), texture_width,
+            texture_height, DXGI_FORMAT_R8_UNORM, -1, true, (UINT)terrain_shadow_map_grid.row_pitch());
 
         m_mesh_manager->SetTexturesForMesh(m_terrain_mesh_id,
             { m_texture_manager->GetTexture(m_terrain_texture_indices_id) }, 1);
         m_mesh_manager->SetTexturesForMesh(
             m_terrain_mesh_id, { m_texture_manager->GetTexture(m_terrain_shadow_map_id) }, 2);
 
+        // The terrain mesh shares its vertices between quads, the pixel shader gets the atlas UVs from the
+        // texture layers of the quad it is in. Integer texels, so without mipmaps.
+        const auto& quad_layer_grid = terrain->get_quad_layer_grid();
+        m_terrain_quad_layers_id = m_texture_manager->AddTexture(quad_layer_grid.data(), quad_layer_grid.width(),
+            quad_layer_grid.height(), DXGI_FORMAT_R16G16B16A16_UINT, -1, false);
+        m_mesh_manager->SetTexturesForMesh(
+            m_terrain_mesh_id, { m_texture_manager->GetTexture(m_terrain_quad_layers_id) }, 4);
+
         m_terrain = terrain;
         m_is_terrain_mesh_set = true;
     }
@@ -507,6 +506,7 @@ public:
         m_terrain_checkered_texture_id = -1;
         m_terrain_texture_indices_id = -1;
         m_terrain_shadow_map_id = -1;
+        m_terrain_quad_layers_id = -1;
         m_terrain_texture_atlas_id = -1;
     }
 
@@ -874,11 +874,16 @@ public:
             const auto& trap = trapezoids[i];
             int mesh_id = m_pathfinding_mesh_ids[i];
 
-            // Recalculate heights with new offset
-            float height_tl = terrain->get_height_at(trap.xtl, trap.yt) + height_offset;
-            float height_tr = terrain->get_height_at(trap.xtr, trap.yt) + height_offset;
-            float height_bl = terrain->get_height_at(trap.xbl, trap.yb) + height_offset;
-            float height_br = terrain->get_height_at(trap.xbr, trap.yb) + height_offset;
+            // Recalculate heights with new offset, all four corners in one query
+            const XMFLOAT2 corners[4] = { { trap.xtl, trap.yt }, { trap.xtr, trap.yt }, { trap.xbl, trap.yb },
+                { trap.xbr, trap.yb } };
+            float corner_heights[4];
+            terrain->get_heights_at(corners, corner_heights);
+
+            float height_tl = corner_heights[0] + height_offset;
+            float height_tr = corner_heights[1] + height_offset;
+            float height_bl = corner_heights[2] + height_offset;
+            float height_br = corner_heights[3] + height_offset;
 
             // Update mesh vertices
             std::vector<GWVertex> vertices;
@@ -1473,6 +1478,7 @@ private:
     int m_terrain_checkered_texture_id = -1;
     int m_terrain_texture_indices_id = -1;
     int m_terrain_shadow_map_id = -1;
+    int m_terrain_quad_layers_id = -1;
     int m_terrain_texture_atlas_id = -1;
 
     int m_sky_mesh_id = -1;
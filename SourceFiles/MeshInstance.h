@@ -3,6 +3,9 @@
 #include "PerObjectCB.h"
 #include <array>
 
+// Texture slots of a mesh, each binds its textures from register t<slot> on. The terrain uses all 5.
+constexpr int NUM_MESH_TEXTURE_SLOTS = 5;
+
 class MeshInstance
 {
 public:
@@ -57,7 +60,7 @@ public:
 
     void SetTextures(const std::vector<ID3D11ShaderResourceView*>& textures, int slot)
     {
-        assert(slot < 4); // Ensure slot is 4 at most (increase if neccessary)
+        assert(slot < NUM_MESH_TEXTURE_SLOTS); // Increase NUM_MESH_TEXTURE_SLOTS if neccessary
 
         if (textures.size() >= MAX_NUM_TEX_INDICES)
         {
@@ -132,8 +135,8 @@ public:
 
         // Bind all texture ranges first, then clear only slots that are not covered by
         // any binding. This preserves multi-SRV ranges (for example water t0+t1).
-        bool covered_slots[4] = { false, false, false, false };
-        for (int slot = 0; slot < 4; ++slot)
+        bool covered_slots[NUM_MESH_TEXTURE_SLOTS] = {};
+        for (int slot = 0; slot < NUM_MESH_TEXTURE_SLOTS; ++slot)
         {
             const auto srv_count = static_cast<UINT>(m_textures[slot].size());
             if (srv_count > 0)
@@ -148,7 +151,7 @@ public:
                 }
 
                 context->PSSetShaderResources(slot, srv_count, raw_srvs.data());
-                for (UINT i = 0; i < srv_count && (slot + static_cast<int>(i)) < 4; ++i)
+                for (UINT i = 0; i < srv_count && (slot + static_cast<int>(i)) < NUM_MESH_TEXTURE_SLOTS; ++i)
                 {
                     covered_slots[slot + i] = true;
                 }
@@ -158,7 +161,7 @@ public:
         // Explicitly unbind uncovered slots to avoid stale SRV bindings
         // (e.g., shadow map from previous map render causing validation errors).
         ID3D11ShaderResourceView* nullSRV = nullptr;
-        for (int slot = 0; slot < 4; ++slot)
+        for (int slot = 0; slot < NUM_MESH_TEXTURE_SLOTS; ++slot)
         {
             if (!covered_slots[slot])
             {
@@ -179,5 +182,5 @@ private:
     Microsoft::WRL::ComPtr<ID3D11Buffer> m_indexBuffer_medium; // Medium LOD
     Microsoft::WRL::ComPtr<ID3D11Buffer> m_indexBuffer_low; // Low LOD
 
-    std::array<std::vector<Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>>, 4> m_textures;
+    std::array<std::vector<Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>>, NUM_MESH_TEXTURE_SLOTS> m_textures;
 };
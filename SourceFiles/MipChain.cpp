@@ -0,0 +1,318 @@
+#include "pch.h"
+#include "MipChain.h"
+#include "TaskPool.h"
+
+using namespace DirectX;
+
+namespace
+{
+    // Levels with at least this many texels are filtered in bands of rows on the TaskPool
+    constexpr size_t ParallelTexelCount = 256 * 256;
+    constexpr size_t BandTexels = 16384;
+
+    constexpr int KaiserTaps = 8;
+    constexpr float KaiserAlpha = 4.0f;
+    constexpr float Pi = 3.14159265358979f;
+
+    // Resolution of the linear to 8 bit table, fine enough that every 8 bit value survives a round trip
+    constexpr int LinearSteps = 16384;
+
+    struct ColorTables
+    {
+        float toLinear[256];
+        uint8_t fromLinear[LinearSteps + 1];
+
+        explicit ColorTables(bool srgb)
+        {
+            for (int i = 0; i < 256; i++)
+            {
+                const float v = i / 255.0f;
+                toLinear[i] = srgb ? (v <= 0.04045f ? v / 12.92f : std::pow((v + 0.055f) / 1.055f, 2.4f)) : v;
+            }
+
+            for (int i = 0; i <= LinearSteps; i++)
+            {
+                const float v = (float)i / LinearSteps;
+                const float encoded = srgb ? (v <= 0.0031308f ? v * 12.92f : 1.055f * std::pow(v, 1 / 2.4f) - 0.055f) : v;
+                fromLinear[i] = (uint8_t)std::lround(encoded * 255.0f);
+            }
+        }
+    };
+
+    const ColorTables s_SRGBTables(true);
+    const ColorTables s_LinearTables(false);
+
+    inline XMVECTOR LoadTexel(RGBA texel, const ColorTables& tables)
+    {
+        return XMVectorSet(tables.toLinear[texel.r], tables.toLinear[texel.g], tables.toLinear[texel.b], texel.a / 255.0f);
+    }
+
+    inline RGBA StoreTexel(FXMVECTOR value, const ColorTables& tables)
+    {
+        XMFLOAT4 v;
+        XMStoreFloat4(&v, XMVectorSaturate(value));
+
+        RGBA texel;
+        texel.r = tables.fromLinear[(int)(v.x * LinearSteps + 0.5f)];
+        texel.g = tables.fromLinear[(int)(v.y * LinearSteps + 0.5f)];
+        texel.b = tables.fromLinear[(int)(v.z * LinearSteps + 0.5f)];
+        texel.a = (uint8_t)(v.w * 255.0f + 0.5f);
+        return texel;
+    }
+
+    template <typename Fn>
+    void ForEachRowBand(int rows, size_t rowTexels, const Fn& fn)
+    {
+        if ((size_t)rows * rowTexels < ParallelTexelCount)
+        {
+            fn(0, rows);
+            return;
+        }
+
+        const int bandRows = (int)std::max<size_t>(1, BandTexels / rowTexels);
+        TaskGroup tasks;
+        for (int firstRow = 0; firstRow < rows; firstRow += bandRows)
+        {
+            const int lastRow = std::min(firstRow + bandRows, rows);
+            tasks.run([&fn, firstRow, lastRow] { fn(firstRow, lastRow); });
+        }
+        tasks.wait();
+    }
+
+    // Odd sizes drop the last row or column, like D3D's own mip sizes
+    void BoxFilter(const XMVECTOR* src, int srcWidth, int srcHeight, XMVECTOR* dst, int dstWidth, int dstHeight)
+    {
+        ForEachRowBand(dstHeight, dstWidth, [&](int firstRow, int lastRow) {
+            for (int y = firstRow; y < lastRow; y++)
+            {
+                const XMVECTOR* row0 = src + (size_t)std::min(2 * y, srcHeight - 1) * srcWidth;
+                const XMVECTOR* row1 = src + (size_t)std::min(2 * y + 1, srcHeight - 1) * srcWidth;
+                XMVECTOR* out = dst + (size_t)y * dstWidth;
+
+                for (int x = 0; x < dstWidth; x++)
+                {
+                    const int x0 = std::min(2 * x, srcWidth - 1);
+                    const int x1 = std::min(2 * x + 1, srcWidth - 1);
+                    const XMVECTOR sum = XMVectorAdd(XMVectorAdd(row0[x0], row0[x1]), XMVectorAdd(row1[x0], row1[x1]));
+                    out[x] = XMVectorScale(sum, 0.25f);
+                }
+            }
+        });
+    }
+
+    float BesselI0(float x)
+    {
+        float sum = 1.0f;
+        float term = 1.0f;
+        for (int k = 1; k < 20; k++)
+        {
+            const float f = x / (2.0f * k);
+            term *= f * f;
+            sum += term;
+        }
+        return sum;
+    }
+
+    struct KaiserKernel
+    {
+        int source[KaiserTaps]; // Clamped to the edge of the image
+        float weight[KaiserTaps];
+    };
+
+    // The taps of each destination texel along one axis. The window reaches 2 destination texels to
+    // each side, 4 source texels when the size halves.
+    std::vector<KaiserKernel> MakeKaiserKernels(int srcSize, int dstSize)
+    {
+        const float scale = (float)srcSize / dstSize;
+        const float radius = 2.0f * scale;
+
+        std::vector<KaiserKernel> kernels(dstSize);
+        for (int i = 0; i < dstSize; i++)
+        {
+            const float center = (i + 0.5f) * scale - 0.5f;
+            const int first = (int)std::floor(center) - KaiserTaps / 2 + 1;
+
+            float total = 0.0f;
+            for (int k = 0; k < KaiserTaps; k++)
+            {
+                const float d = first + k - center;
+                const float t = d / radius;
+
+                float weight = 0.0f;
+                if (std::abs(t) < 1.0f)
+                {
+                    const float x = Pi * d / scale;
+                    const float sinc = std::abs(x) < 1e-6f ? 1.0f : std::sin(x) / x;
+                    weight = sinc * BesselI0(KaiserAlpha * std::sqrt(1.0f - t * t)) / BesselI0(KaiserAlpha);
+                }
+
+                kernels[i].source[k] = std::clamp(first + k, 0, srcSize - 1);
+                kernels[i].weight[k] = weight;
+                total += weight;
+            }
+
+            for (float& weight : kernels[i].weight)
+                weight /= total;
+        }
+
+        return kernels;
+    }
+
+    void KaiserFilter(const XMVECTOR* src, int srcWidth, int srcHeight, XMVECTOR* dst, int dstWidth, int dstHeight,
+                      std::vector<XMVECTOR>& scratch)
+    {
+        const std::vector<KaiserKernel> columns = MakeKaiserKernels(srcWidth, dstWidth);
+        const std::vector<KaiserKernel> rows = MakeKaiserKernels(srcHeight, dstHeight);
+
+        // Horizontal pass into dstWidth x srcHeight, then vertical
+        scratch.resize((size_t)dstWidth * srcHeight);
+        XMVECTOR* tmp = scratch.data();
+
+        ForEachRowBand(srcHeight, dstWidth, [&](int firstRow, int lastRow) {
+            for (int y = firstRow; y < lastRow; y++)
+            {
+                const XMVECTOR* in = src + (size_t)y * srcWidth;
+                XMVECTOR* out = tmp + (size_t)y * dstWidth;
+
+                for (int x = 0; x < dstWidth; x++)
+                {
+                    const KaiserKernel& kernel = columns[x];
+                    XMVECTOR sum = XMVectorZero();
+                    for (int k = 0; k < KaiserTaps; k++)
+                        sum = XMVectorMultiplyAdd(in[kernel.source[k]], XMVectorReplicate(kernel.weight[k]), sum);
+                    out[x] = sum;
+                }
+            }
+        });
+
+        ForEachRowBand(dstHeight, dstWidth, [&](int firstRow, int lastRow) {
+            for (int y = firstRow; y < lastRow; y++)
+            {
+                const KaiserKernel& kernel = rows[y];
+                const XMVECTOR* in[KaiserTaps];
+                XMVECTOR weights[KaiserTaps];
+                for (int k = 0; k < KaiserTaps; k++)
+                {
+                    in[k] = tmp + (size_t)kernel.source[k] * dstWidth;
+                    weights[k] = XMVectorReplicate(kernel.weight[k]);
+                }
+
+                XMVECTOR* out = dst + (size_t)y * dstWidth;
+                for (int x = 0; x < dstWidth; x++)
+                {
+                    XMVECTOR sum = XMVectorZero();
+                    for (int k = 0; k < KaiserTaps; k++)
+                        sum = XMVectorMultiplyAdd(in[k][x], weights[k], sum);
+                    out[x] = sum;
+                }
+            }
+        });
+    }
+
+    // Each channel is the median of the (up to) 3x3 texels centred on the source texel, the upper
+    // one of the two middle values at the edges where there is an even number of them
+    void MedianFilter(const RGBA* src, int srcWidth, int srcHeight, RGBA* dst, int dstWidth, int dstHeight)
+    {
+        ForEachRowBand(dstHeight, dstWidth, [&](int firstRow, int lastRow) {
+            for (int y = firstRow; y < lastRow; y++)
+            {
+                for (int x = 0; x < dstWidth; x++)
+                {
+                    RGBA texel;
+                    for (int channel = 0; channel < 4; channel++)
+                    {
+                        uint8_t values[9];
+                        int count = 0;
+                        for (int dy = -1; dy <= 1; dy++)
+                        {
+                            const int ny = 2 * y + dy;
+                            if (ny < 0 || ny >= srcHeight)
+                                continue;
+
+                            for (int dx = -1; dx <= 1; dx++)
+                            {
+                                const int nx = 2 * x + dx;
+                                if (nx < 0 || nx >= srcWidth)
+                                    continue;
+
+                                // Insertion sort as the values come in
+                                const uint8_t value = src[(size_t)ny * srcWidth + nx].c[channel];
+                                int i = count++;
+                                for (; i > 0 && values[i - 1] > value; i--)
+                                    values[i] = values[i - 1];
+                                values[i] = value;
+                            }
+                        }
+                        texel.c[channel] = values[count / 2];
+                    }
+                    dst[(size_t)y * dstWidth + x] = texel;
+                }
+            }
+        });
+    }
+}
+
+MipChain GenerateMipChain(const RGBA* image, int width, int height, MipFilter filter, bool srgb)
+{
+    MipChain chain;
+    if (!image || width <= 0 || height <= 0)
+        return chain;
+
+    size_t totalTexels = 0;
+    for (int w = width, h = height;; w = std::max(1, w / 2), h = std::max(1, h / 2))
+    {
+        chain.levels.push_back({w, h, totalTexels});
+        totalTexels += (size_t)w * h;
+        if (w == 1 && h == 1)
+            break;
+    }
+
+    chain.texels.resize(totalTexels);
+    std::copy_n(image, (size_t)width * height, chain.texels.data());
+
+    if (filter == MipFilter::Median)
+    {
+        for (size_t i = 1; i < chain.levels.size(); i++)
+        {
+            const MipLevel& above = chain.levels[i - 1];
+            const MipLevel& level = chain.levels[i];
+            MedianFilter(chain.texels.data() + above.offset, above.width, above.height, chain.texels.data() + level.offset,
+                         level.width, level.height);
+        }
+        return chain;
+    }
+
+    const ColorTables& tables = srgb ? s_SRGBTables : s_LinearTables;
+
+    // Each level is filtered from the unrounded linear values of the one above it. The two buffers
+    // swap every level, so the older one is always big enough for the next.
+    std::vector<XMVECTOR> source((size_t)width * height);
+    std::vector<XMVECTOR> target(chain.levels.size() > 1 ? (size_t)chain.levels[1].width * chain.levels[1].height : 0);
+    std::vector<XMVECTOR> scratch;
+
+    ForEachRowBand(height, width, [&](int firstRow, int lastRow) {
+        for (size_t i = (size_t)firstRow * width; i < (size_t)lastRow * width; i++)
+            source[i] = LoadTexel(image[i], tables);
+    });
+
+    for (size_t i = 1; i < chain.levels.size(); i++)
+    {
+        const MipLevel& above = chain.levels[i - 1];
+        const MipLevel& level = chain.levels[i];
+
+        if (filter == MipFilter::Kaiser)
+            KaiserFilter(source.data(), above.width, above.height, target.data(), level.width, level.height, scratch);
+        else
+            BoxFilter(source.data(), above.width, above.height, target.data(), level.width, level.height);
+
+        RGBA* out = chain.texels.data() + level.offset;
+        ForEachRowBand(level.height, level.width, [&](int firstRow, int lastRow) {
+            for (size_t t = (size_t)firstRow * level.width; t < (size_t)lastRow * level.width; t++)
+                out[t] = StoreTexel(target[t], tables);
+        });
+
+        std::swap(source, target);
+    }
+
+    return chain;
+}
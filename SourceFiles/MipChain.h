@@ -0,0 +1,39 @@
+#pragma once
+#include "AtexReader.h"
+#include <span>
+#include <vector>
+
+// How GenerateMipChain filters each level down to the next one
+enum class MipFilter
+{
+    Box,    // Average of 2x2 texels
+    Kaiser, // Kaiser windowed sinc over 8x8 texels, keeps more detail than Box
+    Median  // Per channel median of the 3x3 texels around each one, the look of the old TextureManager filter
+};
+
+struct MipLevel
+{
+    int width;
+    int height;
+    size_t offset; // Index of the level's first texel in MipChain::texels
+};
+
+// Every level of a texture from the full size image down to 1x1, in one buffer
+struct MipChain
+{
+    std::vector<RGBA> texels;
+    std::vector<MipLevel> levels;
+
+    std::span<const RGBA> GetLevel(size_t level) const
+    {
+        const MipLevel& mip = levels[level];
+        return std::span<const RGBA>(texels).subspan(mip.offset, (size_t)mip.width * mip.height);
+    }
+};
+
+// Builds the mip chain of a width * height image. Each level is filtered from the one above it, rows in
+// parallel on the TaskPool for large levels. With srgb the colour channels are filtered in linear space
+// so dark and bright texels average the way they look, alpha is always filtered as stored. The Median
+// filter picks existing values and ignores srgb.
+MipChain GenerateMipChain(const RGBA* image, int width, int height, MipFilter filter = MipFilter::Box,
+                          bool srgb = true);
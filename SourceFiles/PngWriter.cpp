@@ -0,0 +1,381 @@
+#include "pch.h"
+#include "PngWriter.h"
+#include "TaskPool.h"
+#include <fstream>
+
+// A private copy of stb_image_write for its filter, deflate and crc helpers. writeHeighMapBMP.cpp
+// has the public one.
+#define STB_IMAGE_WRITE_STATIC
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#define STBI_WRITE_NO_STDIO
+#include "stb_image_write.h"
+
+namespace
+{
+    // Images with at least this many bytes of filtered rows are compressed in bands of about
+    // BandBytes. Each band starts with an empty LZ77 window, so bands shouldn't be much smaller.
+    constexpr size_t ParallelBytes = 512 * 1024;
+    constexpr size_t BandBytes = 256 * 1024;
+
+    constexpr int CompressionQuality = 8; // stbi_write_png_compression_level's default
+
+    constexpr uint8_t LengthExtraBits[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2,
+                                             2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+    constexpr uint8_t DistanceExtraBits[30] = {0, 0, 0, 0, 1, 1, 2, 2,  3,  3,  4,  4,  5,  5,  6,
+                                               6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+    class BitReader
+    {
+    public:
+        BitReader(const uint8_t* data, size_t size, size_t bit) : m_data(data), m_size(size), m_bit(bit) {}
+
+        size_t GetPosition() const { return m_bit; }
+        bool IsPastEnd() const { return m_bit > m_size * 8; }
+
+        int Read(int count)
+        {
+            int value = 0;
+            for (int i = 0; i < count; i++, m_bit++)
+            {
+                const size_t byte = m_bit >> 3;
+                const int bit = byte < m_size ? (m_data[byte] >> (m_bit & 7)) & 1 : 0;
+                value |= bit << i;
+            }
+            return value;
+        }
+
+    private:
+        const uint8_t* m_data;
+        size_t m_size;
+        size_t m_bit;
+    };
+
+    class BitWriter
+    {
+    public:
+        std::vector<uint8_t> bytes;
+
+        void Write(uint32_t value, int count)
+        {
+            m_buffer |= (uint64_t)value << m_count;
+            m_count += count;
+            while (m_count >= 8)
+            {
+                bytes.push_back((uint8_t)m_buffer);
+                m_buffer >>= 8;
+                m_count -= 8;
+            }
+        }
+
+        void AlignToByte()
+        {
+            if (m_count > 0)
+                Write(0, 8 - m_count);
+        }
+
+        // Appends the bits [firstBit, endBit) of data
+        void CopyBits(const uint8_t* data, size_t firstBit, size_t endBit)
+        {
+            size_t bit = firstBit;
+            while (bit < endBit && (bit & 7) != 0)
+            {
+                Write((data[bit >> 3] >> (bit & 7)) & 1, 1);
+                bit++;
+            }
+            for (; bit + 8 <= endBit; bit += 8)
+                Write(data[bit >> 3], 8);
+            if (bit < endBit)
+                Write(data[bit >> 3] & ((1u << (endBit - bit)) - 1), (int)(endBit - bit));
+        }
+
+    private:
+        uint64_t m_buffer = 0;
+        int m_count = 0;
+    };
+
+    // Bit position just after the end of block code of a fixed Huffman block whose codes start at
+    // bit, or 0 if the block is malformed.
+    size_t FindFixedBlockEnd(const uint8_t* data, size_t size, size_t bit)
+    {
+        // Huffman codes are stored from their most significant bit, so they are read a bit at a time
+        BitReader reader(data, size, bit);
+        while (!reader.IsPastEnd())
+        {
+            int code = 0;
+            for (int i = 0; i < 7; i++)
+                code = (code << 1) | reader.Read(1);
+
+            int symbol;
+            if (code <= 0x17)
+            {
+                symbol = 256 + code;
+            }
+            else
+            {
+                code = (code << 1) | reader.Read(1);
+                if (code >= 0x30 && code <= 0xbf)
+                    symbol = code - 0x30;
+                else if (code >= 0xc0 && code <= 0xc7)
+                    symbol = 280 + code - 0xc0;
+                else
+                    symbol = 144 + ((code << 1) | reader.Read(1)) - 0x190;
+            }
+
+            if (symbol < 256)
+                continue;
+            if (symbol == 256)
+                return reader.IsPastEnd() ? 0 : reader.GetPosition();
+            if (symbol > 285)
+                return 0;
+
+            reader.Read(LengthExtraBits[symbol - 257]);
+
+            int distance = 0;
+            for (int i = 0; i < 5; i++)
+                distance = (distance << 1) | reader.Read(1);
+            if (distance >= 30)
+                return 0;
+            reader.Read(DistanceExtraBits[distance]);
+        }
+        return 0;
+    }
+
+    void WriteStoredBlocks(BitWriter& writer, const uint8_t* data, size_t size, bool last)
+    {
+        do
+        {
+            const size_t blockSize = std::min<size_t>(size, 65535);
+            writer.Write(last && blockSize == size ? 1 : 0, 1);
+            writer.Write(0, 2);
+            writer.AlignToByte();
+            writer.Write((uint32_t)blockSize, 16);
+            writer.Write((uint32_t)~blockSize & 0xffff, 16);
+            writer.bytes.insert(writer.bytes.end(), data, data + blockSize);
+            data += blockSize;
+            size -= blockSize;
+        } while (size > 0);
+    }
+
+    // Appends the deflate blocks of one band to writer. stb_image_write makes a single fixed Huffman
+    // block, or stored blocks when that came out bigger than the input.
+    bool AppendBand(BitWriter& writer, const uint8_t* zlib, int zlibSize, const uint8_t* data, size_t size, bool last)
+    {
+        if (zlibSize < 7)
+            return false;
+
+        const uint8_t* deflate = zlib + 2;
+        const size_t deflateSize = (size_t)zlibSize - 6;
+        const int blockType = (deflate[0] >> 1) & 3;
+
+        if (blockType == 1)
+        {
+            const size_t end = FindFixedBlockEnd(deflate, deflateSize, 3);
+            if (end == 0)
+                return false;
+
+            writer.Write(last ? 1 : 0, 1);
+            writer.Write(1, 2);
+            writer.CopyBits(deflate, 3, end);
+            return true;
+        }
+
+        WriteStoredBlocks(writer, data, size, last);
+        return true;
+    }
+
+    uint32_t Adler32(const uint8_t* data, size_t size)
+    {
+        uint32_t s1 = 1;
+        uint32_t s2 = 0;
+        while (size > 0)
+        {
+            const size_t count = std::min<size_t>(size, 5552);
+            for (size_t i = 0; i < count; i++)
+            {
+                s1 += data[i];
+                s2 += s1;
+            }
+            s1 %= 65521;
+            s2 %= 65521;
+            data += count;
+            size -= count;
+        }
+        return (s2 << 16) | s1;
+    }
+
+    void PutBigEndian(std::vector<uint8_t>& out, uint32_t value)
+    {
+        out.push_back((uint8_t)(value >> 24));
+        out.push_back((uint8_t)(value >> 16));
+        out.push_back((uint8_t)(value >> 8));
+        out.push_back((uint8_t)value);
+    }
+
+    void PutChunk(std::vector<uint8_t>& out, const char* tag, const uint8_t* data, size_t size)
+    {
+        PutBigEndian(out, (uint32_t)size);
+        const size_t start = out.size();
+        out.insert(out.end(), tag, tag + 4);
+        out.insert(out.end(), data, data + size);
+        PutBigEndian(out, stbiw__crc32(out.data() + start, (int)(size + 4)));
+    }
+
+    // Filters rows [firstRow, lastRow) into filtered, each row prefixed by its filter type, picking the
+    // filter per row the way stbi_write_png does
+    void FilterRows(uint8_t* image, int width, int height, int firstRow, int lastRow, uint8_t* filtered)
+    {
+        const int rowBytes = width * 4;
+        std::vector<signed char> line(rowBytes);
+
+        for (int y = firstRow; y < lastRow; y++)
+        {
+            int bestFilter = 0;
+            int bestEstimate = INT_MAX;
+            for (int filter = 0; filter < 5; filter++)
+            {
+                stbiw__encode_png_line(image, rowBytes, width, height, y, 4, filter, line.data());
+
+                int estimate = 0;
+                for (int i = 0; i < rowBytes; i++)
+                    estimate += std::abs(line[i]);
+                if (estimate < bestEstimate)
+                {
+                    bestEstimate = estimate;
+                    bestFilter = filter;
+                }
+            }
+
+            if (bestFilter != 4)
+                stbiw__encode_png_line(image, rowBytes, width, height, y, 4, bestFilter, line.data());
+
+            uint8_t* out = filtered + (size_t)(y - firstRow) * (rowBytes + 1);
+            out[0] = (uint8_t)bestFilter;
+            memcpy(out + 1, line.data(), rowBytes);
+        }
+    }
+}
+
+std::vector<uint8_t> EncodePng(const RGBA* texels, int width, int height, PngPixelOrder order, bool parallel)
+{
+    if (!texels || width <= 0 || height <= 0)
+        return {};
+
+    const size_t rowBytes = (size_t)width * 4;
+    const size_t filteredRowBytes = rowBytes + 1;
+    const size_t filteredBytes = filteredRowBytes * height;
+
+    const int bandRows = parallel && filteredBytes >= ParallelBytes
+                             ? (int)std::max<size_t>(1, BandBytes / filteredRowBytes)
+                             : height;
+    const int bandCount = (height + bandRows - 1) / bandRows;
+
+    std::vector<RGBA> image;
+    if (order == PngPixelOrder::BGRA)
+        image.resize((size_t)width * height);
+
+    std::vector<uint8_t> filtered(filteredBytes);
+    std::vector<uint8_t*> compressed(bandCount, nullptr);
+    std::vector<int> compressedSizes(bandCount, 0);
+
+    // The filters of a row read the row above it, so every band needs the whole image swizzled first
+    const auto swizzle = [&](int firstRow, int lastRow) {
+        for (size_t i = (size_t)firstRow * width; i < (size_t)lastRow * width; i++)
+        {
+            RGBA texel = texels[i];
+            std::swap(texel.c[0], texel.c[2]);
+            image[i] = texel;
+        }
+    };
+    const auto compressBand = [&](int band) {
+        const int firstRow = band * bandRows;
+        const int lastRow = std::min(firstRow + bandRows, height);
+        uint8_t* source = (uint8_t*)(image.empty() ? texels : image.data());
+        uint8_t* out = filtered.data() + (size_t)firstRow * filteredRowBytes;
+        const size_t size = (size_t)(lastRow - firstRow) * filteredRowBytes;
+
+        FilterRows(source, width, height, firstRow, lastRow, out);
+        compressed[band] = stbi_zlib_compress(out, (int)size, &compressedSizes[band], CompressionQuality);
+    };
+
+    if (bandCount == 1)
+    {
+        if (!image.empty())
+            swizzle(0, height);
+        compressBand(0);
+    }
+    else
+    {
+        if (!image.empty())
+        {
+            TaskGroup tasks;
+            for (int band = 0; band < bandCount; band++)
+            {
+                const int firstRow = band * bandRows;
+                tasks.run([&, firstRow] { swizzle(firstRow, std::min(firstRow + bandRows, height)); });
+            }
+            tasks.wait();
+        }
+
+        TaskGroup tasks;
+        for (int band = 0; band < bandCount; band++)
+            tasks.run([&, band] { compressBand(band); });
+        tasks.wait();
+    }
+
+    // One zlib stream: the header, the bands' blocks back to back, and the checksum of all of it
+    BitWriter zlib;
+    zlib.Write(0x78, 8);
+    zlib.Write(0x5e, 8);
+
+    bool ok = true;
+    for (int band = 0; band < bandCount; band++)
+    {
+        const int firstRow = band * bandRows;
+        const int lastRow = std::min(firstRow + bandRows, height);
+        if (!compressed[band] ||
+            !AppendBand(zlib, compressed[band], compressedSizes[band], filtered.data() + (size_t)firstRow * filteredRowBytes,
+                        (size_t)(lastRow - firstRow) * filteredRowBytes, band == bandCount - 1))
+        {
+            ok = false;
+        }
+        STBIW_FREE(compressed[band]);
+    }
+    if (!ok)
+        return {};
+
+    zlib.AlignToByte();
+    const uint32_t adler = Adler32(filtered.data(), filtered.size());
+    zlib.Write((adler >> 24) & 0xff, 8);
+    zlib.Write((adler >> 16) & 0xff, 8);
+    zlib.Write((adler >> 8) & 0xff, 8);
+    zlib.Write(adler & 0xff, 8);
+
+    static constexpr uint8_t signature[8] = {137, 80, 78, 71, 13, 10, 26, 10};
+    uint8_t header[13] = {};
+    header[0] = (uint8_t)(width >> 24), header[1] = (uint8_t)(width >> 16);
+    header[2] = (uint8_t)(width >> 8), header[3] = (uint8_t)width;
+    header[4] = (uint8_t)(height >> 24), header[5] = (uint8_t)(height >> 16);
+    header[6] = (uint8_t)(height >> 8), header[7] = (uint8_t)height;
+    header[8] = 8; // Bits per channel
+    header[9] = 6; // RGBA
+
+    std::vector<uint8_t> png;
+    png.reserve(sizeof(signature) + 3 * 12 + sizeof(header) + zlib.bytes.size());
+    png.insert(png.end(), signature, signature + sizeof(signature));
+    PutChunk(png, "IHDR", header, sizeof(header));
+    PutChunk(png, "IDAT", zlib.bytes.data(), zlib.bytes.size());
+    PutChunk(png, "IEND", nullptr, 0);
+    return png;
+}
+
+bool WritePng(const std::filesystem::path& filename, const RGBA* texels, int width, int height, PngPixelOrder order,
+              bool parallel)
+{
+    const std::vector<uint8_t> png = EncodePng(texels, width, height, order, parallel);
+    if (png.empty())
+        return false;
+
+    std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+    file.write((const char*)png.data(), (std::streamsize)png.size());
+    return (bool)file;
+}
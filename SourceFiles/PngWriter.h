@@ -0,0 +1,22 @@
+#pragma once
+#include "AtexReader.h"
+#include <filesystem>
+#include <vector>
+
+// Byte order of the texels passed to EncodePng. DatTexture holds B8G8R8A8 texels (the .r member is
+// blue), the images decoded from DDS files by TextureManager are R8G8B8A8.
+enum class PngPixelOrder
+{
+    BGRA,
+    RGBA
+};
+
+// Encodes a width * height image as an 8 bit RGBA PNG entirely on the CPU, without creating a texture
+// and reading it back. With parallel, large images are filtered and deflated in bands of rows on the
+// TaskPool. The bands are compressed independently and spliced into one zlib stream, which costs a
+// little compression at each band boundary. Returns an empty vector on failure.
+std::vector<uint8_t> EncodePng(const RGBA* texels, int width, int height, PngPixelOrder order = PngPixelOrder::BGRA,
+                               bool parallel = true);
+
+bool WritePng(const std::filesystem::path& filename, const RGBA* texels, int width, int height,
+              PngPixelOrder order = PngPixelOrder::BGRA, bool parallel = true);
@@ -0,0 +1,327 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Set by whoever started a job to ask the tasks working on it to stop early.
+// Copies share the same flag, a default constructed token is never cancelled.
+class CancellationToken
+{
+public:
+    CancellationToken() = default;
+
+    bool is_cancelled() const { return m_flag && m_flag->load(std::memory_order_relaxed); }
+
+private:
+    friend class CancellationSource;
+    explicit CancellationToken(std::shared_ptr<std::atomic<bool>> flag)
+        : m_flag(std::move(flag))
+    {
+    }
+
+    std::shared_ptr<std::atomic<bool>> m_flag;
+};
+
+class CancellationSource
+{
+public:
+    void cancel() { m_flag->store(true, std::memory_order_relaxed); }
+    bool is_cancelled() const { return m_flag->load(std::memory_order_relaxed); }
+    CancellationToken token() const { return CancellationToken(m_flag); }
+
+private:
+    std::shared_ptr<std::atomic<bool>> m_flag = std::make_shared<std::atomic<bool>>(false);
+};
+
+// Which lane of a TaskPool a task goes to
+enum class TaskPriority
+{
+    Normal, // DAT-wide jobs, scheduled for throughput
+    High    // Work someone is waiting for, e.g. the files of a map being loaded
+};
+
+// Fixed set of worker threads shared by every DAT-wide job (type scan, pattern search, extraction,
+// animation search), so running several of them at once, or one per DAT, doesn't start more threads
+// than there are cores. Each worker has its own deque: tasks a worker submits go to the back of it and
+// are taken from the back (the data they touch is still in cache), idle workers steal from the front
+// of the others. Tasks submitted from other threads are spread over the deques round robin.
+// High priority tasks go to one shared FIFO that every worker checks before its deque, so they only
+// wait for the tasks that are already running, not for the ones a large job has queued.
+class TaskPool
+{
+public:
+    using Task = std::function<void()>;
+
+    explicit TaskPool(unsigned num_workers)
+    {
+        num_workers = std::max(1u, num_workers);
+        for (unsigned i = 0; i < num_workers; i++)
+        {
+            m_queues.push_back(std::make_unique<WorkerQueue>());
+        }
+        for (unsigned i = 0; i < num_workers; i++)
+        {
+            m_workers.emplace_back(&TaskPool::worker_loop, this, i);
+        }
+    }
+
+    ~TaskPool()
+    {
+        {
+            std::lock_guard lock(m_wake_mutex);
+            m_stopping = true;
+        }
+        m_wake_cv.notify_all();
+        for (auto& worker : m_workers)
+        {
+            worker.join();
+        }
+    }
+
+    TaskPool(const TaskPool&) = delete;
+    TaskPool& operator=(const TaskPool&) = delete;
+
+    // The pool used by all jobs, one worker per hardware thread
+    static TaskPool& shared()
+    {
+        static TaskPool pool(std::thread::hardware_concurrency());
+        return pool;
+    }
+
+    unsigned num_workers() const { return (unsigned)m_workers.size(); }
+
+    // True on the worker threads of this pool
+    bool is_worker_thread() const { return t_pool == this; }
+
+    void submit(Task task, TaskPriority priority = TaskPriority::Normal)
+    {
+        if (priority == TaskPriority::High)
+        {
+            std::lock_guard lock(m_high_priority_queue.mutex);
+            m_high_priority_queue.tasks.push_back(std::move(task));
+            m_num_high_priority.fetch_add(1, std::memory_order_release);
+        }
+        else
+        {
+            const size_t queue_index = is_worker_thread()
+                                         ? t_worker_index
+                                         : m_next_queue.fetch_add(1, std::memory_order_relaxed) % m_queues.size();
+            std::lock_guard lock(m_queues[queue_index]->mutex);
+            m_queues[queue_index]->tasks.push_back(std::move(task));
+        }
+
+        m_num_pending.fetch_add(1, std::memory_order_release);
+        {
+            // Pairs with the predicate check in worker_loop so the wake up can't be missed
+            std::lock_guard lock(m_wake_mutex);
+        }
+        m_wake_cv.notify_one();
+    }
+
+    // Runs one pending task on the calling thread. Used by workers waiting for a TaskGroup so a
+    // task that waits on other tasks can't deadlock the pool.
+    bool try_run_pending_task()
+    {
+        Task task;
+        const size_t start = is_worker_thread() ? t_worker_index : 0;
+        if (! take_task(start, task))
+        {
+            return false;
+        }
+
+        task();
+        return true;
+    }
+
+private:
+    struct WorkerQueue
+    {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    std::vector<std::unique_ptr<WorkerQueue>> m_queues;
+    WorkerQueue m_high_priority_queue;
+    std::atomic<size_t> m_num_high_priority{0};
+    std::vector<std::thread> m_workers;
+    std::atomic<size_t> m_next_queue{0};
+    std::atomic<size_t> m_num_pending{0};
+
+    std::mutex m_wake_mutex;
+    std::condition_variable m_wake_cv;
+    bool m_stopping = false;
+
+    static inline thread_local TaskPool* t_pool = nullptr;
+    static inline thread_local size_t t_worker_index = 0;
+
+    // The oldest high priority task first, then the back of our own deque, then the front of the others
+    // starting with our neighbour
+    bool take_task(size_t own_index, Task& task)
+    {
+        if (m_num_pending.load(std::memory_order_acquire) == 0)
+        {
+            return false;
+        }
+
+        if (m_num_high_priority.load(std::memory_order_acquire) > 0)
+        {
+            std::lock_guard lock(m_high_priority_queue.mutex);
+            if (! m_high_priority_queue.tasks.empty())
+            {
+                task = std::move(m_high_priority_queue.tasks.front());
+                m_high_priority_queue.tasks.pop_front();
+                m_num_high_priority.fetch_sub(1, std::memory_order_relaxed);
+                m_num_pending.fetch_sub(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+
+        for (size_t i = 0; i < m_queues.size(); i++)
+        {
+            auto& queue = *m_queues[(own_index + i) % m_queues.size()];
+            std::lock_guard lock(queue.mutex);
+            if (queue.tasks.empty())
+            {
+                continue;
+            }
+
+            if (i == 0)
+            {
+                task = std::move(queue.tasks.back());
+                queue.tasks.pop_back();
+            }
+            else
+            {
+                task = std::move(queue.tasks.front());
+                queue.tasks.pop_front();
+            }
+            m_num_pending.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+
+        return false;
+    }
+
+    void worker_loop(unsigned index)
+    {
+        t_pool = this;
+        t_worker_index = index;
+
+        while (true)
+        {
+            Task task;
+            if (take_task(index, task))
+            {
+                task();
+                continue;
+            }
+
+            std::unique_lock lock(m_wake_mutex);
+            m_wake_cv.wait(lock, [this] { return m_stopping || m_num_pending.load(std::memory_order_acquire) > 0; });
+            if (m_stopping)
+            {
+                return;
+            }
+        }
+    }
+};
+
+// A set of tasks on a TaskPool that can be waited for and cancelled together, with a progress
+// counter for the UI. Tasks that haven't started when the group is cancelled are skipped, running
+// tasks should check is_cancelled() between files. Exceptions thrown by tasks are swallowed, like
+// the per-file try/catch the DAT readers already use.
+class TaskGroup
+{
+public:
+    explicit TaskGroup(CancellationToken token = {}, TaskPool& pool = TaskPool::shared())
+        : m_pool(pool)
+        , m_token(std::move(token))
+    {
+    }
+
+    ~TaskGroup() { wait(); }
+
+    TaskGroup(const TaskGroup&) = delete;
+    TaskGroup& operator=(const TaskGroup&) = delete;
+
+    void run(std::function<void()> task, TaskPriority priority = TaskPriority::Normal)
+    {
+        {
+            std::lock_guard lock(m_mutex);
+            m_num_outstanding++;
+        }
+
+        m_pool.submit([this, task = std::move(task)] {
+            if (! is_cancelled())
+            {
+                try
+                {
+                    task();
+                }
+                catch (...)
+                {
+                }
+            }
+
+            // Notify while holding the lock, wait() may destroy the group as soon as it sees zero
+            std::lock_guard lock(m_mutex);
+            if (--m_num_outstanding == 0)
+            {
+                m_done_cv.notify_all();
+            }
+        }, priority);
+    }
+
+    // Blocks until every task has finished or been skipped. Pool workers help run pending tasks
+    // instead of blocking, other threads just sleep so the pool never runs more threads than cores.
+    void wait()
+    {
+        if (m_pool.is_worker_thread())
+        {
+            while (! is_done())
+            {
+                if (! m_pool.try_run_pending_task())
+                {
+                    std::unique_lock lock(m_mutex);
+                    m_done_cv.wait_for(lock, std::chrono::milliseconds(1), [this] { return m_num_outstanding == 0; });
+                }
+            }
+            return;
+        }
+
+        std::unique_lock lock(m_mutex);
+        m_done_cv.wait(lock, [this] { return m_num_outstanding == 0; });
+    }
+
+    bool is_done()
+    {
+        std::lock_guard lock(m_mutex);
+        return m_num_outstanding == 0;
+    }
+
+    void cancel() { m_cancelled.store(true, std::memory_order_relaxed); }
+    bool is_cancelled() const { return m_cancelled.load(std::memory_order_relaxed) || m_token.is_cancelled(); }
+
+    // Progress in whatever unit the job uses, usually files
+    void add_total(size_t count) { m_total.fetch_add(count, std::memory_order_relaxed); }
+    void add_completed(size_t count = 1) { m_completed.fetch_add(count, std::memory_order_relaxed); }
+    size_t get_total() const { return m_total.load(std::memory_order_relaxed); }
+    size_t get_completed() const { return m_completed.load(std::memory_order_relaxed); }
+
+private:
+    TaskPool& m_pool;
+    CancellationToken m_token;
+    std::atomic<bool> m_cancelled{false};
+
+    std::mutex m_mutex;
+    std::condition_variable m_done_cv;
+    size_t m_num_outstanding = 0;
+
+    std::atomic<size_t> m_total{0};
+    std::atomic<size_t> m_completed{0};
+};
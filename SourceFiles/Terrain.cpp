@@ -1,7 +1,7 @@
 #include "pch.h"
 #include "Terrain.h"
+#include "TaskPool.h"
 #include <algorithm>
-#include <map>
 
 static const float ATLAS_SIZE = 2048.0f;
 static const float TILE_SIZE = 256.0f;
@@ -82,24 +82,118 @@ static XMFLOAT2 make_neutral_uv() {
     return calculate_corner_uv(-1, 3, false, 0);
 }
 
+static uint16_t pack_quad_layer(int tex, int quadrant, bool rotated) {
+    return (uint16_t)((tex + 1) | (quadrant << 9) | (rotated ? 0x8000 : 0));
+}
+
+// The texture layers of a terrain quad, the same for all four corners so it's worked out once per quad
+static TerrainQuadLayers get_quad_layers(int tex_tl, int tex_tr, int tex_bl, int tex_br, int prng_quadrant) {
+    // Per-texture corner masks (matching Python's tex_corners), sorted by texture index
+    int tex_list[4];
+    int mask_list[4];
+    int num_tex = 0;
+    auto add_corner = [&](int tex, int corner_bit) {
+        int i = 0;
+        while (i < num_tex && tex_list[i] < tex) i++;
+        if (i < num_tex && tex_list[i] == tex) {
+            mask_list[i] |= corner_bit;
+            return;
+        }
+        for (int j = num_tex; j > i; j--) {
+            tex_list[j] = tex_list[j - 1];
+            mask_list[j] = mask_list[j - 1];
+        }
+        tex_list[i] = tex;
+        mask_list[i] = corner_bit;
+        num_tex++;
+    };
+    add_corner(tex_tl, 1);  // TL = bit 0
+    add_corner(tex_tr, 2);  // TR = bit 1
+    add_corner(tex_bl, 4);  // BL = bit 2
+    add_corner(tex_br, 8);  // BR = bit 3
+
+    // Unused layers sample the neutral tile
+    TerrainQuadLayers out;
+    int num_layers = 0;
+    for (auto& layer : out.layers) layer = pack_quad_layer(-1, 3, false);
+
+    // Primary variants loop (matching Python exactly). Only the first 3 layers are drawn.
+    for (int i = 0; i < num_tex && num_layers < 3; i++) {
+        if (i == 0) {
+            // First texture uses random quadrant
+            out.layers[num_layers++] = pack_quad_layer(tex_list[i], prng_quadrant, false);
+        } else {
+            // Other textures use LUT quadrant with rotation
+            uint16_t primary = VARIANT_LOOKUP[mask_list[i]].first;
+            out.layers[num_layers++] = pack_quad_layer(tex_list[i], primary & 0x3, (primary & 0x8000) != 0);
+        }
+    }
+
+    // Add secondary variant ONLY for 2-texture case (after loop, matching Python)
+    if (num_tex == 2) {
+        int secondary = VARIANT_LOOKUP[mask_list[1]].second;
+        if (secondary != -1) {
+            out.layers[num_layers] = pack_quad_layer(tex_list[1], secondary & 0x3, (secondary & 0x8000) != 0);
+        }
+    }
+
+    return out;
+}
+
+static void get_corner_uvs(const TerrainQuadLayers& layers, int corner, XMFLOAT2 (&uvs)[3]) {
+    for (int i = 0; i < 3; i++) {
+        const uint16_t layer = layers.layers[i];
+        const int tex = (layer & 0x1ff) - 1;
+        uvs[i] = tex == -1 ? make_neutral_uv()
+                           : calculate_corner_uv(tex, (layer >> 9) & 0x3, (layer & 0x8000) != 0, corner);
+    }
+}
+
+// Terrain quads are generated in chunks of 32x32, top-down in PRNG order. The chunks at the right and
+// bottom edges are cut short, this is the index of the first quad of each chunk, plus the total at the end.
+static std::vector<uint32_t> get_chunk_first_quads(uint32_t grid_dim_x, uint32_t grid_dim_z, int chunks_in_x,
+                                                   int chunks_in_z) {
+    std::vector<uint32_t> chunk_first_quad((size_t)chunks_in_x * chunks_in_z + 1, 0);
+    for (int cz = 0; cz < chunks_in_z; cz++) {
+        for (int cx = 0; cx < chunks_in_x; cx++) {
+            uint32_t quads_x = std::clamp((int)grid_dim_x - 1 - cx * 32, 0, 32);
+            uint32_t quads_z = std::clamp((int)grid_dim_z - cz * 32, 0, 32);
+            size_t chunk = (size_t)cz * chunks_in_x + cx;
+            chunk_first_quad[chunk + 1] = chunk_first_quad[chunk] + quads_x * quads_z;
+        }
+    }
+    return chunk_first_quad;
+}
+
+// Runs fn(first, last) on the TaskPool for [0, count) split into bands of band_size
+template <typename Fn>
+static void run_in_bands(uint32_t count, uint32_t band_size, const Fn& fn) {
+    TaskGroup tasks;
+    for (uint32_t first = 0; first < count; first += band_size) {
+        uint32_t last = std::min(count, first + band_size);
+        tasks.run([&fn, first, last] { fn(first, last); });
+    }
+    tasks.wait();
+}
+
 float Terrain::get_height_at(float world_x, float world_z) const
 {
     float grid_x = (world_x - m_bounds.map_min_x) / (m_bounds.map_max_x - m_bounds.map_min_x) * m_grid_dim_x;
     float grid_z = (world_z - m_bounds.map_min_z) / (m_bounds.map_max_z - m_bounds.map_min_z) * m_grid_dim_z;
 
-    int cell_x = static_cast<int>(grid_x);
-    int cell_z = static_cast<int>(grid_z);
-
-    if (cell_x >= m_grid_dim_x - 1) cell_x = m_grid_dim_x - 2;
-    if (cell_z >= m_grid_dim_z - 1) cell_z = m_grid_dim_z - 2;
+    int cell_x = std::clamp(static_cast<int>(grid_x), 0, (int)m_grid_dim_x - 2);
+    int cell_z = std::clamp(static_cast<int>(grid_z), 0, (int)m_grid_dim_z - 2);
 
     float dx = grid_x - cell_x;
     float dz = grid_z - cell_z;
 
-    float h00 = grid[cell_z][cell_x];     
-    float h10 = grid[cell_z][cell_x + 1]; 
-    float h01 = grid[cell_z + 1][cell_x]; 
-    float h11 = grid[cell_z + 1][cell_x + 1]; 
+    const float* row0 = grid[cell_z];
+    const float* row1 = grid[cell_z + 1];
+
+    float h00 = row0[cell_x];
+    float h10 = row0[cell_x + 1];
+    float h01 = row1[cell_x];
+    float h11 = row1[cell_x + 1];
 
     float height = h00 * (1 - dx) * (1 - dz) +
         h10 * dx * (1 - dz) +
@@ -109,24 +203,103 @@ float Terrain::get_height_at(float world_x, float world_z) const
     return height;
 }
 
-Mesh Terrain::GenerateTerrainMesh()
+#ifdef _XM_SSE_INTRINSICS_
+// max(0, min(v, hi)) with SSE2 only
+static __m128i clamp_cells(__m128i v, __m128i hi)
 {
-    // 1. Populate Grids
+    const __m128i above = _mm_cmpgt_epi32(v, hi);
+    v = _mm_or_si128(_mm_and_si128(above, hi), _mm_andnot_si128(above, v));
+    return _mm_andnot_si128(_mm_cmplt_epi32(v, _mm_setzero_si128()), v);
+}
+#endif
+
+void Terrain::get_heights_at(std::span<const XMFLOAT2> points, float* heights) const
+{
+    size_t i = 0;
+
+#ifdef _XM_SSE_INTRINSICS_
+    // The same operations in the same order as get_height_at, so both return identical heights.
+    // Only the four corner loads of each point are scalar, they come from one or two grid rows.
+    const __m128 min_x = _mm_set1_ps(m_bounds.map_min_x);
+    const __m128 min_z = _mm_set1_ps(m_bounds.map_min_z);
+    const __m128 range_x = _mm_set1_ps(m_bounds.map_max_x - m_bounds.map_min_x);
+    const __m128 range_z = _mm_set1_ps(m_bounds.map_max_z - m_bounds.map_min_z);
+    const __m128 dim_x = _mm_set1_ps((float)m_grid_dim_x);
+    const __m128 dim_z = _mm_set1_ps((float)m_grid_dim_z);
+    const __m128i max_cell_x = _mm_set1_epi32((int)m_grid_dim_x - 2);
+    const __m128i max_cell_z = _mm_set1_epi32((int)m_grid_dim_z - 2);
+    const __m128 one = _mm_set1_ps(1.0f);
+
+    for (; i + 4 <= points.size(); i += 4)
+    {
+        const __m128 p01 = _mm_loadu_ps(&points[i].x);
+        const __m128 p23 = _mm_loadu_ps(&points[i + 2].x);
+        const __m128 world_x = _mm_shuffle_ps(p01, p23, _MM_SHUFFLE(2, 0, 2, 0));
+        const __m128 world_z = _mm_shuffle_ps(p01, p23, _MM_SHUFFLE(3, 1, 3, 1));
+
+        const __m128 grid_x = _mm_mul_ps(_mm_div_ps(_mm_sub_ps(world_x, min_x), range_x), dim_x);
+        const __m128 grid_z = _mm_mul_ps(_mm_div_ps(_mm_sub_ps(world_z, min_z), range_z), dim_z);
+
+        const __m128i cell_x = clamp_cells(_mm_cvttps_epi32(grid_x), max_cell_x);
+        const __m128i cell_z = clamp_cells(_mm_cvttps_epi32(grid_z), max_cell_z);
+
+        const __m128 dx = _mm_sub_ps(grid_x, _mm_cvtepi32_ps(cell_x));
+        const __m128 dz = _mm_sub_ps(grid_z, _mm_cvtepi32_ps(cell_z));
+
+        alignas(16) int cells_x[4];
+        alignas(16) int cells_z[4];
+        _mm_store_si128((__m128i*)cells_x, cell_x);
+        _mm_store_si128((__m128i*)cells_z, cell_z);
+
+        alignas(16) float h00[4], h10[4], h01[4], h11[4];
+        for (int lane = 0; lane < 4; lane++)
+        {
+            const float* row0 = grid[cells_z[lane]] + cells_x[lane];
+            const float* row1 = grid[cells_z[lane] + 1] + cells_x[lane];
+            h00[lane] = row0[0];
+            h10[lane] = row0[1];
+            h01[lane] = row1[0];
+            h11[lane] = row1[1];
+        }
+
+        const __m128 inv_dx = _mm_sub_ps(one, dx);
+        const __m128 inv_dz = _mm_sub_ps(one, dz);
+        __m128 height = _mm_mul_ps(_mm_mul_ps(_mm_load_ps(h00), inv_dx), inv_dz);
+        height = _mm_add_ps(height, _mm_mul_ps(_mm_mul_ps(_mm_load_ps(h10), dx), inv_dz));
+        height = _mm_add_ps(height, _mm_mul_ps(_mm_mul_ps(_mm_load_ps(h01), inv_dx), dz));
+        height = _mm_add_ps(height, _mm_mul_ps(_mm_mul_ps(_mm_load_ps(h11), dx), dz));
+        _mm_storeu_ps(heights + i, height);
+    }
+#endif
+
+    for (; i < points.size(); i++)
+    {
+        heights[i] = get_height_at(points[i].x, points[i].y);
+    }
+}
+
+Mesh Terrain::GenerateTerrainMesh(UnalignedFloatSpan height_map, std::span<const uint8_t> terrain_texture_indices,
+                                  std::span<const uint8_t> terrain_shadow_map)
+{
+    // 1. Populate Grids. The file stores the terrain in 32x32 sub grids, each row of them is filled by its own task.
     uint32_t grid_dims = 32;
     uint32_t sub_grid_rows = m_grid_dim_z / grid_dims;
     uint32_t sub_grid_cols = m_grid_dim_x / grid_dims;
 
-    m_texture_index_grid.resize(m_grid_dim_z + 1, std::vector<uint32_t>(m_grid_dim_x + 1, 0));
-    m_terrain_shadow_map_grid.resize(m_grid_dim_z + 1, std::vector<uint32_t>(m_grid_dim_x + 1, 0));
+    m_texture_index_grid = Grid2D<uint8_t>(m_grid_dim_x + 1, m_grid_dim_z + 1, 0);
+    m_terrain_shadow_map_grid = Grid2D<uint8_t>(m_grid_dim_x + 1, m_grid_dim_z + 1, 0);
 
-    float min_h = FLT_MAX;
-    float max_h = FLT_MIN;
+    std::vector<float> sub_grid_row_min_h(sub_grid_rows, FLT_MAX);
+    std::vector<float> sub_grid_row_max_h(sub_grid_rows, FLT_MIN);
 
-    int count = 0;
-    for (int j = 0; j < sub_grid_rows; j++)
-    {
-        for (int i = 0; i < sub_grid_cols; i++)
+    run_in_bands(sub_grid_rows, 1, [&](uint32_t j, uint32_t) {
+        float min_h = FLT_MAX;
+        float max_h = FLT_MIN;
+
+        for (uint32_t i = 0; i < sub_grid_cols; i++)
         {
+            size_t count = ((size_t)j * sub_grid_cols + i) * grid_dims * grid_dims;
+
             int col_start = i * grid_dims;
             int col_end = col_start + grid_dims;
             int row_start = j * grid_dims;
@@ -134,23 +307,37 @@ Mesh Terrain::GenerateTerrainMesh()
 
             for (int k = row_start; k < row_end; k++)
             {
+                // FLIP STORAGE: Map Top-Down File Data to Bottom-Up Grid Index
+                int grid_row_idx = m_grid_dim_z - k;
+                float* heights = grid[grid_row_idx];
+                uint8_t* texture_indices = m_texture_index_grid[grid_row_idx];
+                uint8_t* shadows = m_terrain_shadow_map_grid[grid_row_idx];
+
                 for (int l = col_start; l < col_end; l++)
                 {
-                    // FLIP STORAGE: Map Top-Down File Data to Bottom-Up Grid Index
-                    int grid_row_idx = m_grid_dim_z - k;
-                    
-                    grid[grid_row_idx][l] = -m_height_map[count];
-                    m_texture_index_grid[grid_row_idx][l] = m_terrain_texture_indices[count];
-                    m_terrain_shadow_map_grid[grid_row_idx][l] = m_terrain_shadow_map[count];
-                    
-                    float h = grid[grid_row_idx][l];
+                    heights[l] = -height_map[count];
+                    texture_indices[l] = terrain_texture_indices[count];
+                    shadows[l] = terrain_shadow_map[count];
+
+                    float h = heights[l];
                     if (h < min_h) min_h = h;
                     if (h > max_h) max_h = h;
-                    
+
                     count++;
                 }
             }
         }
+
+        sub_grid_row_min_h[j] = min_h;
+        sub_grid_row_max_h[j] = max_h;
+    });
+
+    float min_h = FLT_MAX;
+    float max_h = FLT_MIN;
+    for (uint32_t j = 0; j < sub_grid_rows; j++)
+    {
+        if (sub_grid_row_min_h[j] < min_h) min_h = sub_grid_row_min_h[j];
+        if (sub_grid_row_max_h[j] > max_h) max_h = sub_grid_row_max_h[j];
     }
 
     m_bounds.map_max_y = max_h;
@@ -159,204 +346,196 @@ Mesh Terrain::GenerateTerrainMesh()
     float delta_x = (m_bounds.map_max_x - m_bounds.map_min_x) / m_grid_dim_x;
     float delta_z = (m_bounds.map_max_z - m_bounds.map_min_z) / m_grid_dim_z;
 
-    // 2. Pre-calculate Normals
-    std::vector<XMFLOAT3> grid_normals((m_grid_dim_z + 1) * (m_grid_dim_x + 1), XMFLOAT3(0, 1, 0));
-    
-    for (uint32_t z = 0; z < m_grid_dim_z - 1; z++) {
-        for (uint32_t x = 0; x < m_grid_dim_x - 1; x++) {
-            float y00 = grid[z][x];
-            float y10 = grid[z][x + 1];
-            float y01 = grid[z + 1][x];
-            
-            XMFLOAT3 p00(m_bounds.map_min_x + x * delta_x, y00, m_bounds.map_min_z + z * delta_z);
-            XMFLOAT3 p10(m_bounds.map_min_x + (x+1) * delta_x, y10, m_bounds.map_min_z + z * delta_z);
-            XMFLOAT3 p01(m_bounds.map_min_x + x * delta_x, y01, m_bounds.map_min_z + (z+1) * delta_z);
-            
-            XMFLOAT3 n = compute_normal(p00, p10, p01); 
-            
-            int idx00 = z * (m_grid_dim_x + 1) + x;
-            int idx10 = z * (m_grid_dim_x + 1) + x + 1;
-            int idx01 = (z + 1) * (m_grid_dim_x + 1) + x;
-            int idx11 = (z + 1) * (m_grid_dim_x + 1) + x + 1;
-
-            grid_normals[idx00] = AddXMFLOAT3(grid_normals[idx00], n);
-            grid_normals[idx10] = AddXMFLOAT3(grid_normals[idx10], n);
-            grid_normals[idx01] = AddXMFLOAT3(grid_normals[idx01], n);
-            grid_normals[idx11] = AddXMFLOAT3(grid_normals[idx11], n); 
+    // 2. Pre-calculate Normals of the quads. Each vertex sums the ones around it below, in the same order the
+    // quads used to scatter them, so rows can be done in parallel without changing the result.
+    const uint32_t normal_quads_x = m_grid_dim_x > 1 ? m_grid_dim_x - 1 : 0;
+    const uint32_t normal_quads_z = m_grid_dim_z > 1 ? m_grid_dim_z - 1 : 0;
+    std::vector<XMFLOAT3> quad_normals((size_t)normal_quads_z * normal_quads_x);
+
+    run_in_bands(normal_quads_z, 32, [&](uint32_t first_z, uint32_t last_z) {
+        for (uint32_t z = first_z; z < last_z; z++) {
+            for (uint32_t x = 0; x < normal_quads_x; x++) {
+                float y00 = grid[z][x];
+                float y10 = grid[z][x + 1];
+                float y01 = grid[z + 1][x];
+
+                XMFLOAT3 p00(m_bounds.map_min_x + x * delta_x, y00, m_bounds.map_min_z + z * delta_z);
+                XMFLOAT3 p10(m_bounds.map_min_x + (x+1) * delta_x, y10, m_bounds.map_min_z + z * delta_z);
+                XMFLOAT3 p01(m_bounds.map_min_x + x * delta_x, y01, m_bounds.map_min_z + (z+1) * delta_z);
+
+                quad_normals[(size_t)z * normal_quads_x + x] = compute_normal(p00, p10, p01);
+            }
         }
-    }
-    for(auto& n : grid_normals) n = NormalizeXMFLOAT3(n);
+    });
+
+    // 3. Generate Mesh. The quads share the vertices of the grid and only get their own indices. Their texture
+    // layers go to m_quad_layer_grid, which the pixel shader and GenerateUnsharedTerrainMesh get the UVs from.
+    std::vector<GWVertex> vertices((size_t)(m_grid_dim_z + 1) * (m_grid_dim_x + 1));
+
+    run_in_bands(m_grid_dim_z + 1, 32, [&](uint32_t first_z, uint32_t last_z) {
+        for (uint32_t z = first_z; z < last_z; z++) {
+            for (uint32_t x = 0; x <= m_grid_dim_x; x++) {
+                XMFLOAT3 n(0, 1, 0);
+                for (uint32_t qz = z > 0 ? z - 1 : 0; qz <= z && qz < normal_quads_z; qz++) {
+                    for (uint32_t qx = x > 0 ? x - 1 : 0; qx <= x && qx < normal_quads_x; qx++) {
+                        n = AddXMFLOAT3(n, quad_normals[(size_t)qz * normal_quads_x + qx]);
+                    }
+                }
 
-    // 3. Generate Mesh (Quads)
-    std::vector<GWVertex> vertices;
-    std::vector<uint32_t> indices;
-    
-    vertices.reserve((m_grid_dim_x - 1) * (m_grid_dim_z - 1) * 4);
-    indices.reserve((m_grid_dim_x - 1) * (m_grid_dim_z - 1) * 6);
+                GWVertex& v = vertices[(size_t)z * (m_grid_dim_x + 1) + x];
+                v.position = { m_bounds.map_min_x + x * delta_x, grid[z][x], m_bounds.map_min_z + z * delta_z };
+                v.normal = NormalizeXMFLOAT3(n);
+            }
+        }
+    });
+
+    m_quad_layer_grid = Grid2D<TerrainQuadLayers>(m_grid_dim_x, m_grid_dim_z, TerrainQuadLayers{});
 
     int chunks_in_x = (m_grid_dim_x - 1 + 31) / 32;
     int chunks_in_z = (m_grid_dim_z - 1 + 31) / 32;
-    
+    const std::vector<uint32_t> chunk_first_quad = get_chunk_first_quads(m_grid_dim_x, m_grid_dim_z, chunks_in_x, chunks_in_z);
+    std::vector<uint32_t> indices((size_t)chunk_first_quad.back() * 6);
+
+    TaskGroup tasks;
     // Process chunks Top-Down (PRNG Order)
     for (int cz = 0; cz < chunks_in_z; cz++) {
         for (int cx = 0; cx < chunks_in_x; cx++) {
-            
-            uint32_t seed_cx = cx;
-            uint32_t seed_cz = cz;
-            uint32_t seed = seed_cz ^ (seed_cx << 16);
-            uint32_t prng_state = seed;
-            
-            for (int lz = 0; lz < 32; lz++) {
-                for (int lx = 0; lx < 32; lx++) {
-                    uint32_t rnd = prng_next(prng_state);
-                    
-                    int grid_x = cx * 32 + lx;
-                    // Invert Z Index: Map Chunk (Top-Down) to Grid (Bottom-Up)
-                    // tex_tl is read from grid_z+1, which should map to file row (cz*32+lz)
-                    // File row F is stored at grid index (m_grid_dim_z - F)
-                    // So grid_z+1 = m_grid_dim_z - (cz*32+lz), thus grid_z = m_grid_dim_z - 1 - cz*32 - lz
-                    int grid_z = (m_grid_dim_z - 1) - (cz * 32 + lz);
-                    
-                    if (grid_x >= (int)m_grid_dim_x - 1 || grid_z < 0) {
-                        continue; 
+            tasks.run([&, cx, cz] {
+                uint32_t quad_idx = chunk_first_quad[(size_t)cz * chunks_in_x + cx];
+
+                uint32_t seed_cx = cx;
+                uint32_t seed_cz = cz;
+                uint32_t seed = seed_cz ^ (seed_cx << 16);
+                uint32_t prng_state = seed;
+
+                for (int lz = 0; lz < 32; lz++) {
+                    for (int lx = 0; lx < 32; lx++) {
+                        uint32_t rnd = prng_next(prng_state);
+
+                        int grid_x = cx * 32 + lx;
+                        // Invert Z Index: Map Chunk (Top-Down) to Grid (Bottom-Up)
+                        // tex_tl is read from grid_z+1, which should map to file row (cz*32+lz)
+                        // File row F is stored at grid index (m_grid_dim_z - F)
+                        // So grid_z+1 = m_grid_dim_z - (cz*32+lz), thus grid_z = m_grid_dim_z - 1 - cz*32 - lz
+                        int grid_z = (m_grid_dim_z - 1) - (cz * 32 + lz);
+
+                        if (grid_x >= (int)m_grid_dim_x - 1 || grid_z < 0) {
+                            continue;
+                        }
+
+                        int tex_bl = m_texture_index_grid[grid_z][grid_x];
+                        int tex_br = m_texture_index_grid[grid_z][grid_x + 1];
+                        int tex_tl = m_texture_index_grid[grid_z + 1][grid_x];
+                        int tex_tr = m_texture_index_grid[grid_z + 1][grid_x + 1];
+
+                        int prng_quadrant = rnd & 3;
+                        m_quad_layer_grid[grid_z][grid_x] = get_quad_layers(tex_tl, tex_tr, tex_bl, tex_br, prng_quadrant);
+
+                        uint32_t bl = grid_z * (m_grid_dim_x + 1) + grid_x;
+                        uint32_t br = bl + 1;
+                        uint32_t tl = bl + m_grid_dim_x + 1;
+                        uint32_t tr = tl + 1;
+
+                        uint32_t* quad_indices = &indices[(size_t)quad_idx * 6];
+                        quad_indices[0] = bl;
+                        quad_indices[1] = tl;
+                        quad_indices[2] = tr;
+
+                        quad_indices[3] = bl;
+                        quad_indices[4] = tr;
+                        quad_indices[5] = br;
+
+                        quad_idx++;
                     }
+                }
+            });
+        }
+    }
+    tasks.wait();
 
-                    int tex_bl = m_texture_index_grid[grid_z][grid_x];
-                    int tex_br = m_texture_index_grid[grid_z][grid_x + 1];
-                    int tex_tl = m_texture_index_grid[grid_z + 1][grid_x];
-                    int tex_tr = m_texture_index_grid[grid_z + 1][grid_x + 1];
-                    
-                    int prng_quadrant = rnd & 3;
-                    
-                    bool is_uniform = (tex_tl == tex_tr && tex_tl == tex_bl && tex_tl == tex_br);
-                    
-                    auto get_uvs_for_corner = [&](int corner) -> std::vector<XMFLOAT2> {
-                        std::vector<XMFLOAT2> layers;
-
-                        if (is_uniform) {
-                            layers.push_back(calculate_corner_uv(tex_tl, prng_quadrant, false, corner));
-                            layers.push_back(make_neutral_uv());
-                            layers.push_back(make_neutral_uv());
-                            return layers;
-                        }
+    m_per_terrain_cb = PerTerrainCB(m_grid_dim_x, m_grid_dim_z, m_bounds.map_min_x, m_bounds.map_max_x, m_bounds.map_min_y, m_bounds.map_max_y, m_bounds.map_min_z, m_bounds.map_max_z, 0, 0.03, 0.03, {0});
 
-                        // Build per-texture corner masks (matching Python's tex_corners)
-                        std::map<int, int> tex_to_corners;
-                        tex_to_corners[tex_tl] |= 1;  // TL = bit 0
-                        tex_to_corners[tex_tr] |= 2;  // TR = bit 1
-                        tex_to_corners[tex_bl] |= 4;  // BL = bit 2
-                        tex_to_corners[tex_br] |= 8;  // BR = bit 3
-
-                        // std::map iterates by key order (sorted texture indices)
-                        std::vector<std::pair<int, int>> tex_list;
-                        for (auto const& [tex, mask] : tex_to_corners) {
-                            tex_list.push_back({tex, mask});
-                        }
+    return Mesh(std::move(vertices), std::move(indices), {}, {}, {0}, { 0 }, { 0 }, { 0 }, true, BlendState::Opaque, 1, { 10000000, 10000000, 10000000 });
+}
 
-                        // Primary variants loop (matching Python exactly)
-                        for (size_t i = 0; i < tex_list.size(); i++) {
-                            int tex = tex_list[i].first;
-                            int mask = tex_list[i].second;
-
-                            auto entry = VARIANT_LOOKUP[mask];
-                            uint16_t primary = entry.first;
-
-                            if (i == 0) {
-                                // First texture uses random quadrant
-                                layers.push_back(calculate_corner_uv(tex, prng_quadrant, false, corner));
-                            } else {
-                                // Other textures use LUT quadrant with rotation
-                                int quad = primary & 0x3;
-                                bool rot = (primary & 0x8000) != 0;
-                                layers.push_back(calculate_corner_uv(tex, quad, rot, corner));
-                            }
-                        }
+Mesh Terrain::GenerateUnsharedTerrainMesh() const
+{
+    if (!mesh) {
+        return {};
+    }
 
-                        // Add secondary variant ONLY for 2-texture case (after loop, matching Python)
-                        if (tex_list.size() == 2) {
-                            int tex2 = tex_list[1].first;
-                            int mask2 = tex_list[1].second;
-                            int secondary = VARIANT_LOOKUP[mask2].second;
-
-                            if (secondary != -1) {
-                                int quad2 = secondary & 0x3;
-                                bool rot2 = (secondary & 0x8000) != 0;
-                                layers.push_back(calculate_corner_uv(tex2, quad2, rot2, corner));
-                            } else {
-                                layers.push_back(make_neutral_uv());
-                            }
-                        }
+    float delta_x = (m_bounds.map_max_x - m_bounds.map_min_x) / m_grid_dim_x;
+    float delta_z = (m_bounds.map_max_z - m_bounds.map_min_z) / m_grid_dim_z;
+
+    int chunks_in_x = (m_grid_dim_x - 1 + 31) / 32;
+    int chunks_in_z = (m_grid_dim_z - 1 + 31) / 32;
+    const std::vector<uint32_t> chunk_first_quad = get_chunk_first_quads(m_grid_dim_x, m_grid_dim_z, chunks_in_x, chunks_in_z);
+    std::vector<GWVertex> vertices((size_t)chunk_first_quad.back() * 4);
+    std::vector<uint32_t> indices((size_t)chunk_first_quad.back() * 6);
 
-                        // Pad to 3 variants
-                        while (layers.size() < 3) {
-                            layers.push_back(make_neutral_uv());
+    // Same quad order as the shared mesh, the normals are taken from its vertices
+    const std::vector<GWVertex>& grid_vertices = mesh->vertices;
+
+    TaskGroup tasks;
+    for (int cz = 0; cz < chunks_in_z; cz++) {
+        for (int cx = 0; cx < chunks_in_x; cx++) {
+            tasks.run([&, cx, cz] {
+                uint32_t quad_idx = chunk_first_quad[(size_t)cz * chunks_in_x + cx];
+
+                for (int lz = 0; lz < 32; lz++) {
+                    for (int lx = 0; lx < 32; lx++) {
+                        int grid_x = cx * 32 + lx;
+                        int grid_z = (m_grid_dim_z - 1) - (cz * 32 + lz);
+
+                        if (grid_x >= (int)m_grid_dim_x - 1 || grid_z < 0) {
+                            continue;
                         }
 
-                        return layers;
-                    }; 
-
-                    float xPos = m_bounds.map_min_x + grid_x * delta_x;
-                    float zPos = m_bounds.map_min_z + grid_z * delta_z;
-                    float xL = xPos;
-                    float xR = xPos + delta_x;
-                    float zB = zPos;
-                    float zT = zPos + delta_z;
-                    
-                    auto uvs_TL = get_uvs_for_corner(0);
-                    GWVertex vTL;
-                    vTL.position = { xL, grid[grid_z+1][grid_x], zT };
-                    vTL.normal = grid_normals[(grid_z+1)*(m_grid_dim_x+1) + grid_x];
-                    vTL.tex_coord0 = uvs_TL[0];
-                    vTL.tex_coord1 = uvs_TL[1];
-                    vTL.tex_coord2 = uvs_TL[2];
-                    vTL.tex_coord3 = {(float)lx/32.0f, (float)lz/32.0f}; 
-                    
-                    auto uvs_TR = get_uvs_for_corner(1);
-                    GWVertex vTR;
-                    vTR.position = { xR, grid[grid_z+1][grid_x+1], zT };
-                    vTR.normal = grid_normals[(grid_z+1)*(m_grid_dim_x+1) + grid_x+1];
-                    vTR.tex_coord0 = uvs_TR[0];
-                    vTR.tex_coord1 = uvs_TR[1];
-                    vTR.tex_coord2 = uvs_TR[2];
-                    vTR.tex_coord3 = {(float)(lx+1)/32.0f, (float)lz/32.0f};
-
-                    auto uvs_BL = get_uvs_for_corner(2);
-                    GWVertex vBL;
-                    vBL.position = { xL, grid[grid_z][grid_x], zB };
-                    vBL.normal = grid_normals[grid_z*(m_grid_dim_x+1) + grid_x];
-                    vBL.tex_coord0 = uvs_BL[0];
-                    vBL.tex_coord1 = uvs_BL[1];
-                    vBL.tex_coord2 = uvs_BL[2];
-                    vBL.tex_coord3 = {(float)lx/32.0f, (float)(lz+1)/32.0f};
-
-                    auto uvs_BR = get_uvs_for_corner(3);
-                    GWVertex vBR;
-                    vBR.position = { xR, grid[grid_z][grid_x+1], zB };
-                    vBR.normal = grid_normals[grid_z*(m_grid_dim_x+1) + grid_x+1];
-                    vBR.tex_coord0 = uvs_BR[0];
-                    vBR.tex_coord1 = uvs_BR[1];
-                    vBR.tex_coord2 = uvs_BR[2];
-                    vBR.tex_coord3 = {(float)(lx+1)/32.0f, (float)(lz+1)/32.0f};
-                    
-                    uint32_t base_idx = (uint32_t)vertices.size();
-                    vertices.push_back(vTL);
-                    vertices.push_back(vTR);
-                    vertices.push_back(vBL);
-                    vertices.push_back(vBR);
-                    
-                    indices.push_back(base_idx + 2);
-                    indices.push_back(base_idx + 0);
-                    indices.push_back(base_idx + 1);
-                    
-                    indices.push_back(base_idx + 2);
-                    indices.push_back(base_idx + 1);
-                    indices.push_back(base_idx + 3);
+                        const TerrainQuadLayers& layers = m_quad_layer_grid[grid_z][grid_x];
+
+                        float xPos = m_bounds.map_min_x + grid_x * delta_x;
+                        float zPos = m_bounds.map_min_z + grid_z * delta_z;
+                        float xL = xPos;
+                        float xR = xPos + delta_x;
+                        float zB = zPos;
+                        float zT = zPos + delta_z;
+
+                        uint32_t base_idx = quad_idx * 4;
+                        GWVertex* quad_vertices = &vertices[base_idx];
+
+                        auto set_corner = [&](GWVertex& v, int corner, float x, int vertex_grid_x, float z,
+                                              int vertex_grid_z, float u, float w) {
+                            XMFLOAT2 uvs[3];
+                            get_corner_uvs(layers, corner, uvs);
+                            v.position = { x, grid[vertex_grid_z][vertex_grid_x], z };
+                            v.normal = grid_vertices[(size_t)vertex_grid_z * (m_grid_dim_x + 1) + vertex_grid_x].normal;
+                            v.tex_coord0 = uvs[0];
+                            v.tex_coord1 = uvs[1];
+                            v.tex_coord2 = uvs[2];
+                            v.tex_coord3 = { u, w };
+                        };
+
+                        set_corner(quad_vertices[0], 0, xL, grid_x, zT, grid_z + 1, (float)lx/32.0f, (float)lz/32.0f);
+                        set_corner(quad_vertices[1], 1, xR, grid_x + 1, zT, grid_z + 1, (float)(lx+1)/32.0f, (float)lz/32.0f);
+                        set_corner(quad_vertices[2], 2, xL, grid_x, zB, grid_z, (float)lx/32.0f, (float)(lz+1)/32.0f);
+                        set_corner(quad_vertices[3], 3, xR, grid_x + 1, zB, grid_z, (float)(lx+1)/32.0f, (float)(lz+1)/32.0f);
+
+                        uint32_t* quad_indices = &indices[(size_t)quad_idx * 6];
+                        quad_indices[0] = base_idx + 2;
+                        quad_indices[1] = base_idx + 0;
+                        quad_indices[2] = base_idx + 1;
+
+                        quad_indices[3] = base_idx + 2;
+                        quad_indices[4] = base_idx + 1;
+                        quad_indices[5] = base_idx + 3;
+
+                        quad_idx++;
+                    }
                 }
-            }
+            });
         }
     }
-    
-    m_per_terrain_cb = PerTerrainCB(m_grid_dim_x, m_grid_dim_z, m_bounds.map_min_x, m_bounds.map_max_x, m_bounds.map_min_y, m_bounds.map_max_y, m_bounds.map_min_z, m_bounds.map_max_z, 0, 0.03, 0.03, {0});
+    tasks.wait();
 
-    return Mesh(vertices, indices, {}, {}, {0}, { 0 }, { 0 }, { 0 }, true, BlendState::Opaque, 1, { 10000000, 10000000, 10000000 });
+    return Mesh(std::move(vertices), std::move(indices), {}, {}, {0}, { 0 }, { 0 }, { 0 }, true, BlendState::Opaque, 1, { 10000000, 10000000, 10000000 });
 }
@@ -3,56 +3,81 @@
 #include <DirectXMath.h>
 #include "MeshInstance.h"
 #include "FFNA_MapFile.h"
+#include "Grid2D.h"
 #include "DXMathHelpers.h"
 #include "PerTerrainCB.h"
 
+// The texture layers of one terrain quad, a texel of the R16G16B16A16_UINT texture TerrainRevPixelShader
+// gets the atlas UVs from. Each layer holds the atlas slot (texture index + 1, 0 is the neutral tile) in
+// bits 0-8, the quadrant in bits 9-10 and whether it is rotated in bit 15. The 4th layer is unused.
+struct TerrainQuadLayers
+{
+    uint16_t layers[4];
+};
+
 class Terrain
 {
 public:
-    Terrain(int32_t grid_dim_x, uint32_t grid_dim_y, const std::vector<float>& height_map,
-            const std::vector<uint8_t>& terrain_texture_indices,
-            const std::vector<uint8_t>& terrain_shadow_map, const MapBounds& bounds)
+    // The arrays are only read while the mesh is generated, so they can point straight into the map
+    // file (see Chunk8View) as well as into a decoded Chunk8
+    Terrain(int32_t grid_dim_x, uint32_t grid_dim_y, UnalignedFloatSpan height_map,
+            std::span<const uint8_t> terrain_texture_indices,
+            std::span<const uint8_t> terrain_shadow_map, const MapBounds& bounds)
         : m_grid_dim_x(grid_dim_x)
         , m_grid_dim_z(grid_dim_y)
-        , m_height_map(height_map)
-        , m_terrain_texture_indices(terrain_texture_indices)
-        , m_terrain_shadow_map(terrain_shadow_map)
         , m_bounds(bounds),
-        grid(m_grid_dim_z + 1, std::vector<float>(m_grid_dim_x + 1, 0.0f))
+        grid(m_grid_dim_x + 1, m_grid_dim_z + 1, 0.0f)
     {
         // Generate terrain mesh
-        mesh = std::make_unique<Mesh>(GenerateTerrainMesh());
+        mesh = std::make_unique<Mesh>(GenerateTerrainMesh(height_map, terrain_texture_indices, terrain_shadow_map));
     }
 
+    Terrain(const Chunk8View& terrain_chunk, const MapBounds& bounds)
+        : Terrain(terrain_chunk.terrain_x_dims, terrain_chunk.terrain_y_dims, terrain_chunk.terrain_heightmap,
+                  terrain_chunk.terrain_texture_indices_maybe, terrain_chunk.terrain_shadow_map, bounds)
+    {
+    }
+
+    // One vertex per grid point shared by the quads around it. The vertices have no texture coordinates,
+    // TerrainRevPixelShader works them out from the world position and get_quad_layer_grid().
     Mesh* get_mesh() { return mesh.get(); }
 
-    const std::vector<std::vector<float>>& get_heightmap_grid() const {
+    // The same terrain with 4 vertices per quad and the atlas UVs of each layer in tex_coord0-2, and the
+    // position in the 32x32 chunk in tex_coord3. For exporters that need the UVs in the vertices.
+    Mesh GenerateUnsharedTerrainMesh() const;
+
+    const Grid2D<float>& get_heightmap_grid() const {
         return grid;
     }
 
+    // Bilinear height of the terrain under a world position
     float get_height_at(float world_x, float world_z) const;
+    // Same for many positions (x, z) at once, four at a time with SSE. heights must hold points.size() floats.
+    void get_heights_at(std::span<const XMFLOAT2> points, float* heights) const;
 
     uint32_t m_grid_dim_x;
     uint32_t m_grid_dim_z;
     MapBounds m_bounds;
     PerTerrainCB m_per_terrain_cb;
-    std::vector<std::vector<uint32_t>> m_texture_index_grid;
-    std::vector<std::vector<uint32_t>> m_terrain_shadow_map_grid;
+    // Same layout as the height grid, rows bottom-up. Uploaded as R8 textures straight from their rows.
+    Grid2D<uint8_t> m_texture_index_grid;
+    Grid2D<uint8_t> m_terrain_shadow_map_grid;
 
     void update_per_terrain_CB(PerTerrainCB& new_cb) { m_per_terrain_cb = new_cb; }
-    const std::vector<std::vector<uint32_t>>& get_texture_index_grid() const { return m_texture_index_grid; }
-    const std::vector<std::vector<uint32_t>>& get_terrain_shadow_map_grid() const
+    const Grid2D<uint8_t>& get_texture_index_grid() const { return m_texture_index_grid; }
+    const Grid2D<uint8_t>& get_terrain_shadow_map_grid() const
     {
         return m_terrain_shadow_map_grid;
     }
+    // Layers of the quad with bottom left corner (x, z), m_grid_dim_x by m_grid_dim_z
+    const Grid2D<TerrainQuadLayers>& get_quad_layer_grid() const { return m_quad_layer_grid; }
 
 private:
     // Generates a terrain mesh based on the height map data
-    Mesh GenerateTerrainMesh();
+    Mesh GenerateTerrainMesh(UnalignedFloatSpan height_map, std::span<const uint8_t> terrain_texture_indices,
+                             std::span<const uint8_t> terrain_shadow_map);
 
-    std::vector<float> m_height_map;
-    std::vector<std::vector<float>> grid;
-    std::vector<uint8_t> m_terrain_texture_indices;
-    std::vector<uint8_t> m_terrain_shadow_map;
+    Grid2D<float> grid;
+    Grid2D<TerrainQuadLayers> m_quad_layer_grid;
     std::unique_ptr<Mesh> mesh;
 };
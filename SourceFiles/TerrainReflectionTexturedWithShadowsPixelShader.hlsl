@@ -179,25 +179,19 @@ float4 main(PixelInputType input) : SV_TARGET0
     float4 finalColor = input.lightingColor;
 
 	// ------------ TEXTURE START ----------------
-    float2 texelSize = float2(1.0 / grid_dim_x, 1.0 / grid_dim_y);
+	// The terrain mesh shares its vertices between quads and has no UVs, so the tile is found from the
+	// world position the same way TerrainRevPixelShader does
+    float2 grid_pos = float2((input.world_position.x - min_x) / (max_x - min_x) * grid_dim_x,
+                             (input.world_position.z - min_z) / (max_z - min_z) * grid_dim_y);
 
 	// Calculate the tile index
-    float2 tileIndex = floor(input.tex_coords0 / texelSize);
+    float2 tileIndex = clamp(floor(grid_pos), float2(0, 0), float2(grid_dim_x - 2, grid_dim_y - 2));
 
-	// Compute the corner coordinates based on the tile index
-    float2 topLeftTexCoord = tileIndex * texelSize;
-    float2 topRightTexCoord = topLeftTexCoord + float2(texelSize.x, 0);
-    float2 bottomLeftTexCoord = topLeftTexCoord + float2(0, texelSize.y);
-    float2 bottomRightTexCoord = topLeftTexCoord + texelSize;
-
-	// Calculate the texture size
-    float2 textureSize = float2(grid_dim_x, grid_dim_y);
-
-	// Convert normalized texture coordinates to integer pixel coordinates
-    int2 topLeftCoord = int2(topLeftTexCoord * textureSize);
-    int2 topRightCoord = int2(topRightTexCoord * textureSize);
-    int2 bottomLeftCoord = int2(bottomLeftTexCoord * textureSize);
-    int2 bottomRightCoord = int2(bottomRightTexCoord * textureSize);
+	// Integer pixel coordinates of the corners in the index and shadow textures
+    int2 topLeftCoord = int2(tileIndex);
+    int2 topRightCoord = topLeftCoord + int2(1, 0);
+    int2 bottomLeftCoord = topLeftCoord + int2(0, 1);
+    int2 bottomRightCoord = topLeftCoord + int2(1, 1);
 
 	// Load the terrain_texture_indices without interpolation
     int topLeftTexIdx = int(terrain_texture_indices.Load(int3(topLeftCoord, 0)).r * 255.0);
@@ -212,8 +206,8 @@ float4 main(PixelInputType input) : SV_TARGET0
     float weight_br = terrain_shadow_map.Load(int3(bottomRightCoord, 0)).r;
 
 	// Calculate u and v
-    float u = frac(input.tex_coords0.x / texelSize.x); // Fractional part of the tile index in x
-    float v = frac(input.tex_coords0.y / texelSize.y); // Fractional part of the tile index in y
+    float u = saturate(grid_pos.x - tileIndex.x); // Fractional part of the tile index in x
+    float v = saturate(grid_pos.y - tileIndex.y); // Fractional part of the tile index in y
 
 	// Apply bilinear interpolation
     float blendedWeight = (1 - u) * (1 - v) * weight_tl +
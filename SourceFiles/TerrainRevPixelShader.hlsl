@@ -1,5 +1,6 @@
 Texture2DArray atlas : register(t0);
 Texture2D terrain_shadow_map_props : register(t3);
+Texture2D<uint4> terrain_quad_layers : register(t4);
 SamplerState samLinear : register(s0);
 SamplerComparisonState shadowSampler : register(s1);
 
@@ -50,6 +51,22 @@ cbuffer PerCameraCB : register(b2)
     float2 reflection_texel_size;
 };
 
+cbuffer PerTerrainCB : register(b3)
+{
+    int grid_dim_x;
+    int grid_dim_y;
+    float min_x;
+    float max_x;
+    float min_y;
+    float max_y;
+    float min_z;
+    float max_z;
+    float water_level;
+    float terrain_texture_pad_x;
+    float terrain_texture_pad_y;
+    float terrain_pad[1];
+};
+
 struct PixelInputType
 {
     float4 position : SV_POSITION;
@@ -98,21 +115,63 @@ float4 SampleAtlas(float2 uv, float2 dx, float2 dy)
     return atlas.SampleGrad(samLinear, float3(localUV, layerIndex), dx, dy);
 }
 
+// Atlas UV of one texture layer of a terrain quad (see TerrainQuadLayers in Terrain.h) at quad_pos, the
+// position inside the quad from (0, 0) at its bottom left to (1, 1) at its top right. Matches the UVs
+// calculate_corner_uv in Terrain.cpp gives the corners, interpolated over the quad.
+float2 GetLayerUV(uint layer, float2 quad_pos)
+{
+    const float border = 8.5f;
+    uint slot = layer & 0x1ff;
+    uint quadrant = (layer >> 9) & 3;
+    bool rotated = (layer & 0x8000) != 0;
+
+    // Rotated layers have their corners swapped diagonally. x runs left to right and y top to bottom.
+    float2 corner = rotated ? float2(1.0f - quad_pos.x, quad_pos.y) : float2(quad_pos.x, 1.0f - quad_pos.y);
+    float2 tile = float2(slot % 8, slot / 8) * 256.0f;
+    float2 quadrant_offset = float2(quadrant % 2, quadrant / 2) * 128.0f;
+    float2 local = border + (128.0f - 2.0f * border) * corner;
+
+    return (tile + quadrant_offset + local) / 2048.0f;
+}
+
+// Screen space derivative of GetLayerUV, from the derivative of quad_pos. Taken from the continuous grid
+// position so it doesn't jump where neighbouring pixels fall in different quads.
+float2 GetLayerUVDerivative(uint layer, float2 quad_pos_derivative)
+{
+    const float border = 8.5f;
+    float2 direction = (layer & 0x8000) != 0 ? float2(-1.0f, 1.0f) : float2(1.0f, -1.0f);
+    return quad_pos_derivative * direction * (128.0f - 2.0f * border) / 2048.0f;
+}
+
 PSOutput main(PixelInputType input)
 {
+    // The quad the pixel is in and the position inside it, the mesh shares its vertices between quads
+    // so the UVs of each layer are worked out here instead of interpolated
+    float2 grid_pos = float2((input.world_position.x - min_x) / (max_x - min_x) * grid_dim_x,
+                             (input.world_position.z - min_z) / (max_z - min_z) * grid_dim_y);
+    int2 quad = clamp((int2)floor(grid_pos), int2(0, 0), int2(grid_dim_x - 2, grid_dim_y - 1));
+    float2 quad_pos = grid_pos - quad;
+    uint4 layers = terrain_quad_layers.Load(int3(quad, 0));
+
+    float2 uv0 = GetLayerUV(layers.x, quad_pos);
+    float2 uv1 = GetLayerUV(layers.y, quad_pos);
+    float2 uv2 = GetLayerUV(layers.z, quad_pos);
+
     // Calculate derivatives for mipmapping (scaled for 256x256 tiles vs 2048x2048 atlas)
     // We calculate per-UV derivatives to handle rotation/scaling correctly
-    float2 dx0 = ddx(input.uv0) * 8.0f;
-    float2 dy0 = ddy(input.uv0) * 8.0f;
-    float2 dx1 = ddx(input.uv1) * 8.0f;
-    float2 dy1 = ddy(input.uv1) * 8.0f;
-    float2 dx2 = ddx(input.uv2) * 8.0f;
-    float2 dy2 = ddy(input.uv2) * 8.0f;
+    float2 grid_dx = ddx(grid_pos);
+    float2 grid_dy = ddy(grid_pos);
+    float2 dx0 = GetLayerUVDerivative(layers.x, grid_dx) * 8.0f;
+    float2 dy0 = GetLayerUVDerivative(layers.x, grid_dy) * 8.0f;
+    float2 dx1 = GetLayerUVDerivative(layers.y, grid_dx) * 8.0f;
+    float2 dy1 = GetLayerUVDerivative(layers.y, grid_dy) * 8.0f;
+    float2 dx2 = GetLayerUVDerivative(layers.z, grid_dx) * 8.0f;
+    float2 dy2 = GetLayerUVDerivative(layers.z, grid_dy) * 8.0f;
 
     // Sample all texture layers
-    float4 t0 = SampleAtlas(input.uv0, dx0, dy0);
-    float4 t1 = SampleAtlas(input.uv1, dx1, dy1);
-    float4 t2 = SampleAtlas(input.uv2, dx2, dy2);
+    float4 t0 = SampleAtlas(uv0, dx0, dy0);
+    float4 t1 = SampleAtlas(uv1, dx1, dy1);
+    float4 t2 = SampleAtlas(uv2, dx2, dy2);
 
     // Progressive alpha blending
     float4 result = t0;
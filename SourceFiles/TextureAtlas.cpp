@@ -0,0 +1,250 @@
+#include "pch.h"
+#include "TextureAtlas.h"
+
+namespace
+{
+    int AlignUp(int value, int alignment) { return (value + alignment - 1) / alignment * alignment; }
+
+    int NextPowerOfTwo(int value)
+    {
+        int result = 1;
+        while (result < value)
+            result *= 2;
+        return result;
+    }
+}
+
+TextureAtlas::TextureAtlas(int width, int height, int gutter, int maxSize)
+    : m_width(std::clamp(AlignUp(width, Alignment), Alignment, maxSize))
+    , m_height(std::clamp(AlignUp(height, Alignment), Alignment, maxSize))
+    , m_gutter(AlignUp(std::max(gutter, 0), Alignment))
+    , m_maxSize(maxSize)
+    , m_texels((size_t)m_width * m_height, RGBA{})
+{
+    m_skyline.push_back({0, 0, m_width});
+}
+
+TextureAtlas TextureAtlas::Pack(const std::vector<DatTexture>& textures, int gutter, int maxSize)
+{
+    const int paddedGutter = AlignUp(std::max(gutter, 0), Alignment);
+
+    // Start at the power of two size that would hold the textures if they packed perfectly, growing
+    // when they don't is cheaper than starting too big.
+    std::vector<int> order;
+    uint64_t area = 0;
+    int maxWidth = 0;
+    int maxHeight = 0;
+    for (int i = 0; i < (int)textures.size(); i++)
+    {
+        const DatTexture& texture = textures[i];
+        if (texture.width <= 0 || texture.height <= 0)
+            continue;
+
+        const int width = AlignUp(texture.width + 2 * paddedGutter, Alignment);
+        const int height = AlignUp(texture.height + 2 * paddedGutter, Alignment);
+        area += (uint64_t)width * height;
+        maxWidth = std::max(maxWidth, width);
+        maxHeight = std::max(maxHeight, height);
+        order.push_back(i);
+    }
+
+    const int width = NextPowerOfTwo(std::max(maxWidth, (int)std::ceil(std::sqrt((double)area))));
+    const int height = NextPowerOfTwo(std::max<int>(maxHeight, (int)((area + width - 1) / width)));
+    TextureAtlas atlas(width, height, gutter, maxSize);
+
+    // Tallest first keeps the skyline flat
+    std::stable_sort(order.begin(), order.end(), [&](int a, int b) {
+        return textures[a].height > textures[b].height;
+    });
+
+    atlas.m_rects.assign(textures.size(), AtlasRect{-1, -1, 0, 0});
+    for (int i : order)
+    {
+        AtlasRect rect;
+        if (atlas.Place(textures[i], rect))
+            atlas.m_rects[i] = rect;
+    }
+
+    return atlas;
+}
+
+int TextureAtlas::Insert(const DatTexture& texture)
+{
+    AtlasRect rect;
+    if (!Place(texture, rect))
+        return -1;
+
+    m_rects.push_back(rect);
+    return (int)m_rects.size() - 1;
+}
+
+AtlasUV TextureAtlas::GetUV(int index) const
+{
+    const AtlasRect& rect = m_rects[index];
+    if (rect.x < 0)
+        return {0.0f, 0.0f, 0.0f, 0.0f};
+
+    return {(float)rect.x / m_width, (float)rect.y / m_height, (float)(rect.x + rect.width) / m_width,
+            (float)(rect.y + rect.height) / m_height};
+}
+
+std::vector<AtlasUV> TextureAtlas::GetUVs() const
+{
+    std::vector<AtlasUV> uvs(m_rects.size());
+    for (int i = 0; i < (int)m_rects.size(); i++)
+        uvs[i] = GetUV(i);
+    return uvs;
+}
+
+DatTexture TextureAtlas::TakeTexture()
+{
+    DatTexture texture{};
+    texture.width = m_width;
+    texture.height = m_height;
+    texture.rgba_data = std::move(m_texels);
+    return texture;
+}
+
+bool TextureAtlas::Place(const DatTexture& texture, AtlasRect& rect)
+{
+    if (texture.width <= 0 || texture.height <= 0 || texture.rgba_data.size() < (size_t)texture.width * texture.height)
+        return false;
+
+    const int paddedWidth = AlignUp(texture.width + 2 * m_gutter, Alignment);
+    const int paddedHeight = AlignUp(texture.height + 2 * m_gutter, Alignment);
+
+    size_t node;
+    int y;
+    while (!FindPosition(paddedWidth, paddedHeight, node, y))
+    {
+        if (!Grow())
+            return false;
+    }
+
+    const int x = m_skyline[node].x;
+    AddSkylineLevel(node, y, paddedWidth, paddedHeight);
+    CopyWithGutter(texture, x, y, paddedWidth, paddedHeight);
+
+    rect = {x + m_gutter, y + m_gutter, texture.width, texture.height};
+    return true;
+}
+
+// Bottom-left rule: the position where the top of the texture ends up lowest, on the narrowest
+// skyline segment if there is a tie.
+bool TextureAtlas::FindPosition(int width, int height, size_t& bestNode, int& bestY) const
+{
+    int bestTop = INT_MAX;
+    int bestWidth = INT_MAX;
+
+    for (size_t i = 0; i < m_skyline.size(); i++)
+    {
+        if (m_skyline[i].x + width > m_width)
+            break;
+
+        // The texture rests on the highest segment it spans
+        int y = 0;
+        int remaining = width;
+        for (size_t j = i; remaining > 0; j++)
+        {
+            y = std::max(y, m_skyline[j].y);
+            remaining -= m_skyline[j].width;
+        }
+
+        if (y + height > m_height)
+            continue;
+
+        if (y + height < bestTop || (y + height == bestTop && m_skyline[i].width < bestWidth))
+        {
+            bestTop = y + height;
+            bestWidth = m_skyline[i].width;
+            bestNode = i;
+            bestY = y;
+        }
+    }
+
+    return bestTop != INT_MAX;
+}
+
+void TextureAtlas::AddSkylineLevel(size_t node, int y, int width, int height)
+{
+    const SkylineNode level{m_skyline[node].x, y + height, width};
+    m_skyline.insert(m_skyline.begin() + node, level);
+
+    // Cut the segments now under the texture
+    const int right = level.x + level.width;
+    for (size_t i = node + 1; i < m_skyline.size();)
+    {
+        SkylineNode& next = m_skyline[i];
+        if (next.x >= right)
+            break;
+
+        const int covered = right - next.x;
+        if (covered >= next.width)
+        {
+            m_skyline.erase(m_skyline.begin() + i);
+            continue;
+        }
+
+        next.x += covered;
+        next.width -= covered;
+        break;
+    }
+
+    for (size_t i = 1; i < m_skyline.size();)
+    {
+        if (m_skyline[i - 1].y == m_skyline[i].y)
+        {
+            m_skyline[i - 1].width += m_skyline[i].width;
+            m_skyline.erase(m_skyline.begin() + i);
+        }
+        else
+        {
+            i++;
+        }
+    }
+}
+
+// Doubles the smaller side. The texels of the placed textures keep their position.
+bool TextureAtlas::Grow()
+{
+    const bool growWidth = m_width <= m_height ? m_width < m_maxSize : m_height >= m_maxSize;
+    const int newWidth = growWidth ? std::min(m_width * 2, m_maxSize) : m_width;
+    const int newHeight = growWidth ? m_height : std::min(m_height * 2, m_maxSize);
+    if (newWidth == m_width && newHeight == m_height)
+        return false;
+
+    std::vector<RGBA> texels((size_t)newWidth * newHeight, RGBA{});
+    for (int y = 0; y < m_height; y++)
+        std::copy_n(m_texels.data() + (size_t)y * m_width, m_width, texels.data() + (size_t)y * newWidth);
+
+    if (newWidth > m_width)
+    {
+        if (m_skyline.back().y == 0)
+            m_skyline.back().width += newWidth - m_width;
+        else
+            m_skyline.push_back({m_width, 0, newWidth - m_width});
+    }
+
+    m_texels = std::move(texels);
+    m_width = newWidth;
+    m_height = newHeight;
+    return true;
+}
+
+// The gutter, and the alignment padding after the texture, repeat the nearest edge texel so that the
+// filtered texels next to the edge keep the texture's own colour.
+void TextureAtlas::CopyWithGutter(const DatTexture& texture, int x, int y, int paddedWidth, int paddedHeight)
+{
+    const int right = paddedWidth - m_gutter - texture.width;
+
+    for (int row = 0; row < paddedHeight; row++)
+    {
+        const int srcRow = std::clamp(row - m_gutter, 0, texture.height - 1);
+        const RGBA* src = texture.rgba_data.data() + (size_t)srcRow * texture.width;
+        RGBA* dst = m_texels.data() + (size_t)(y + row) * m_width + x;
+
+        std::fill_n(dst, m_gutter, src[0]);
+        std::copy_n(src, texture.width, dst + m_gutter);
+        std::fill_n(dst + m_gutter + texture.width, right, src[texture.width - 1]);
+    }
+}
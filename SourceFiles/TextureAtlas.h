@@ -0,0 +1,80 @@
+#pragma once
+#include "AtexReader.h"
+#include <vector>
+
+// Where a texture was placed in a TextureAtlas, in texels. Excludes the gutter around it.
+struct AtlasRect
+{
+    int x;
+    int y;
+    int width;
+    int height;
+};
+
+// Texture coordinates of an AtlasRect, (u0, v0) is the top left corner
+struct AtlasUV
+{
+    float u0;
+    float v0;
+    float u1;
+    float v1;
+};
+
+// Packs textures of any size into one RGBA image with a skyline bottom-left packer. Each texture is
+// surrounded by a gutter of its own edge texels so that sampling and the first mip levels don't bleed
+// in texels from its neighbours, and starts on a multiple of Alignment so it stays on whole 4x4 blocks
+// when the atlas is block compressed. Textures can be added at any time, the ones already placed never
+// move. When a texture doesn't fit the atlas doubles its smaller side (up to maxSize), which changes
+// the UVs but not the AtlasRect of the existing textures.
+class TextureAtlas
+{
+public:
+    static constexpr int Alignment = 4;
+    static constexpr int DefaultGutter = 4;
+    static constexpr int DefaultMaxSize = 16384; // D3D11_REQ_TEXTURE2D_U_OR_V_DIMENSION
+
+    // The gutter is rounded up to a multiple of Alignment
+    TextureAtlas(int width, int height, int gutter = DefaultGutter, int maxSize = DefaultMaxSize);
+
+    // Packs all the textures, tallest first, into an atlas just big enough for them. The index of a
+    // texture in GetRects()/GetUVs() is its index in textures, textures that were empty or didn't fit
+    // have an x of -1.
+    static TextureAtlas Pack(const std::vector<DatTexture>& textures, int gutter = DefaultGutter,
+                             int maxSize = DefaultMaxSize);
+
+    // Adds a texture and returns its index, or -1 if it is empty or the atlas can't grow enough to fit it
+    int Insert(const DatTexture& texture);
+
+    int GetWidth() const { return m_width; }
+    int GetHeight() const { return m_height; }
+    const std::vector<RGBA>& GetTexels() const { return m_texels; }
+    const std::vector<AtlasRect>& GetRects() const { return m_rects; }
+
+    AtlasUV GetUV(int index) const;
+    std::vector<AtlasUV> GetUVs() const;
+
+    // Moves the image out of the atlas. The rects and UVs stay valid, but nothing can be inserted afterwards.
+    DatTexture TakeTexture();
+
+private:
+    struct SkylineNode
+    {
+        int x;
+        int y; // Top of the free space above [x, x + width)
+        int width;
+    };
+
+    int m_width;
+    int m_height;
+    int m_gutter;
+    int m_maxSize;
+    std::vector<RGBA> m_texels;
+    std::vector<AtlasRect> m_rects;
+    std::vector<SkylineNode> m_skyline;
+
+    bool Place(const DatTexture& texture, AtlasRect& rect);
+    bool FindPosition(int width, int height, size_t& bestNode, int& bestY) const;
+    void AddSkylineLevel(size_t node, int y, int width, int height);
+    bool Grow();
+    void CopyWithGutter(const DatTexture& texture, int x, int y, int paddedWidth, int paddedHeight);
+};
@@ -0,0 +1,370 @@
+#include "pch.h"
+#include "TextureDiskCache.h"
+#include <fstream>
+#include <thread>
+
+namespace
+{
+    constexpr uint32_t cache_magic = 'GWTC';
+    // Bump when the decoders' output changes so files written by older builds are ignored
+    constexpr uint32_t cache_version = 1;
+    constexpr const wchar_t* cache_extension = L".gwtex";
+}
+
+struct TextureDiskCache::Header
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t murmurhash3;
+    uint32_t file_size;
+    uint32_t kind;
+    int32_t width;
+    int32_t height;
+    uint32_t texture_type;
+    uint32_t block_format;
+    uint32_t premultiply_alpha;
+    uint64_t payload_size;
+};
+
+std::optional<std::filesystem::path> TextureDiskCache::get_default_directory()
+{
+    const auto exe_dir_opt = get_executable_directory();
+    if (! exe_dir_opt)
+    {
+        return std::nullopt;
+    }
+
+    return *exe_dir_opt / L"texture_cache";
+}
+
+void TextureDiskCache::configure(const std::filesystem::path& directory, uint64_t max_bytes)
+{
+    std::lock_guard lock(m_mutex);
+
+    m_lru.clear();
+    m_entries.clear();
+    m_total_bytes = 0;
+    m_directory.clear();
+    m_max_bytes = 0;
+
+    if (directory.empty() || max_bytes == 0)
+    {
+        return;
+    }
+
+    std::error_code ec;
+    std::filesystem::create_directories(directory, ec);
+    if (ec)
+    {
+        return;
+    }
+
+    struct FoundFile
+    {
+        std::wstring filename;
+        uint64_t size;
+        std::filesystem::file_time_type last_used;
+    };
+
+    std::vector<FoundFile> found;
+    for (const auto& item : std::filesystem::directory_iterator(directory, ec))
+    {
+        std::error_code item_ec;
+        if (! item.is_regular_file(item_ec))
+        {
+            continue;
+        }
+
+        // Left behind by a write that didn't finish
+        if (item.path().extension() == L".tmp")
+        {
+            std::filesystem::remove(item.path(), item_ec);
+            continue;
+        }
+
+        if (item.path().extension() != cache_extension)
+        {
+            continue;
+        }
+
+        const uint64_t size = item.file_size(item_ec);
+        const auto last_used = item.last_write_time(item_ec);
+        if (! item_ec)
+        {
+            found.push_back({item.path().filename().wstring(), size, last_used});
+        }
+    }
+
+    std::sort(found.begin(), found.end(),
+              [](const FoundFile& a, const FoundFile& b) { return a.last_used > b.last_used; });
+
+    for (auto& file : found)
+    {
+        m_lru.push_back({std::move(file.filename), file.size});
+        m_entries[m_lru.back().filename] = std::prev(m_lru.end());
+        m_total_bytes += file.size;
+    }
+
+    m_directory = directory;
+    m_max_bytes = max_bytes;
+    evict_locked();
+}
+
+bool TextureDiskCache::is_enabled() const
+{
+    std::lock_guard lock(m_mutex);
+    return m_max_bytes > 0;
+}
+
+uint64_t TextureDiskCache::get_size_bytes() const
+{
+    std::lock_guard lock(m_mutex);
+    return m_total_bytes;
+}
+
+std::wstring TextureDiskCache::get_filename(uint32_t murmurhash3, uint32_t file_size, Kind kind)
+{
+    return std::format(L"{:08x}_{:08x}_{}{}", murmurhash3, file_size, (uint32_t)kind, cache_extension);
+}
+
+template <typename Read>
+bool TextureDiskCache::read_file(uint32_t murmurhash3, uint32_t file_size, Kind kind, const Read& read)
+{
+    const std::wstring filename = get_filename(murmurhash3, file_size, kind);
+    std::filesystem::path path;
+    {
+        std::lock_guard lock(m_mutex);
+        if (m_max_bytes == 0 || ! m_entries.contains(filename))
+        {
+            return false;
+        }
+        path = m_directory / filename;
+    }
+
+    // FILE_SHARE_DELETE lets another thread evict the file while it is being read
+    HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING,
+                              FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+
+    bool result = false;
+    LARGE_INTEGER size;
+    if (GetFileSizeEx(file, &size) && (uint64_t)size.QuadPart >= sizeof(Header) && (uint64_t)size.QuadPart <= SIZE_MAX)
+    {
+        if (HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr))
+        {
+            if (const auto* view = (const uint8_t*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0))
+            {
+                Header header;
+                memcpy(&header, view, sizeof(Header));
+
+                if (header.magic == cache_magic && header.version == cache_version &&
+                    header.murmurhash3 == murmurhash3 && header.file_size == file_size &&
+                    header.kind == (uint32_t)kind && header.payload_size == (uint64_t)size.QuadPart - sizeof(Header))
+                {
+                    result = read(header, std::span<const uint8_t>(view + sizeof(Header), (size_t)header.payload_size));
+                }
+
+                UnmapViewOfFile(view);
+            }
+            CloseHandle(mapping);
+        }
+    }
+    CloseHandle(file);
+
+    if (result)
+    {
+        touch(filename);
+    }
+    return result;
+}
+
+std::optional<DatTexture> TextureDiskCache::load(uint32_t murmurhash3, uint32_t file_size)
+{
+    std::optional<DatTexture> texture;
+    read_file(murmurhash3, file_size, Kind::RGBA, [&](const Header& header, std::span<const uint8_t> payload) {
+        const size_t num_texels = (size_t)header.width * header.height;
+        if (header.width <= 0 || header.height <= 0 || payload.size() != num_texels * sizeof(RGBA))
+        {
+            return false;
+        }
+
+        DatTexture result{};
+        result.width = header.width;
+        result.height = header.height;
+        result.texture_type = (TextureType)header.texture_type;
+        result.rgba_data.resize(num_texels);
+        memcpy(result.rgba_data.data(), payload.data(), payload.size());
+        texture = std::move(result);
+        return true;
+    });
+
+    return texture;
+}
+
+void TextureDiskCache::store(uint32_t murmurhash3, uint32_t file_size, const DatTexture& texture)
+{
+    const size_t num_texels = (size_t)texture.width * texture.height;
+    if (texture.width <= 0 || texture.height <= 0 || texture.rgba_data.size() != num_texels)
+    {
+        return;
+    }
+
+    Header header{};
+    header.murmurhash3 = murmurhash3;
+    header.file_size = file_size;
+    header.kind = (uint32_t)Kind::RGBA;
+    header.width = texture.width;
+    header.height = texture.height;
+    header.texture_type = texture.texture_type;
+    header.payload_size = num_texels * sizeof(RGBA);
+    write_file(header, texture.rgba_data.data());
+}
+
+std::optional<DatCompressedTexture> TextureDiskCache::load_blocks(uint32_t murmurhash3, uint32_t file_size)
+{
+    std::optional<DatCompressedTexture> texture;
+    read_file(murmurhash3, file_size, Kind::Blocks, [&](const Header& header, std::span<const uint8_t> payload) {
+        DatCompressedTexture result;
+        result.width = header.width;
+        result.height = header.height;
+        result.texture_type = (TextureType)header.texture_type;
+        result.block_format = (BlockFormat)header.block_format;
+        result.premultiply_alpha = header.premultiply_alpha != 0;
+        if (header.width <= 0 || header.height <= 0 || header.block_format > (uint32_t)BlockFormat::BC3 ||
+            payload.size() != result.row_pitch() * (header.height / 4))
+        {
+            return false;
+        }
+
+        result.blocks.assign(payload.begin(), payload.end());
+        texture = std::move(result);
+        return true;
+    });
+
+    return texture;
+}
+
+void TextureDiskCache::store_blocks(uint32_t murmurhash3, uint32_t file_size, const DatCompressedTexture& texture)
+{
+    if (texture.width <= 0 || texture.height <= 0 || texture.blocks.size() != texture.row_pitch() * (texture.height / 4))
+    {
+        return;
+    }
+
+    Header header{};
+    header.murmurhash3 = murmurhash3;
+    header.file_size = file_size;
+    header.kind = (uint32_t)Kind::Blocks;
+    header.width = texture.width;
+    header.height = texture.height;
+    header.texture_type = texture.texture_type;
+    header.block_format = (uint32_t)texture.block_format;
+    header.premultiply_alpha = texture.premultiply_alpha;
+    header.payload_size = texture.blocks.size();
+    write_file(header, texture.blocks.data());
+}
+
+void TextureDiskCache::clear()
+{
+    std::lock_guard lock(m_mutex);
+
+    std::error_code ec;
+    for (const auto& entry : m_lru)
+    {
+        std::filesystem::remove(m_directory / entry.filename, ec);
+    }
+
+    m_lru.clear();
+    m_entries.clear();
+    m_total_bytes = 0;
+}
+
+void TextureDiskCache::write_file(const Header& header_in, const void* payload)
+{
+    Header header = header_in;
+    header.magic = cache_magic;
+    header.version = cache_version;
+
+    const std::wstring filename = get_filename(header.murmurhash3, header.file_size, (Kind)header.kind);
+    std::filesystem::path directory;
+    {
+        std::lock_guard lock(m_mutex);
+        if (m_max_bytes == 0 || m_entries.contains(filename))
+        {
+            return;
+        }
+        directory = m_directory;
+    }
+
+    // Written under a temporary name and renamed so readers never see a partial file
+    const auto path = directory / filename;
+    const auto temp_path = directory / std::format(L"{}.{:x}.tmp", filename, std::hash<std::thread::id>{}(std::this_thread::get_id()));
+    {
+        std::ofstream out(temp_path, std::ios::binary | std::ios::trunc);
+        out.write((const char*)&header, sizeof(Header));
+        out.write((const char*)payload, (std::streamsize)header.payload_size);
+        if (! out)
+        {
+            out.close();
+            std::error_code ec;
+            std::filesystem::remove(temp_path, ec);
+            return;
+        }
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(temp_path, path, ec);
+    if (ec)
+    {
+        std::filesystem::remove(temp_path, ec);
+        return;
+    }
+
+    std::lock_guard lock(m_mutex);
+    if (m_max_bytes == 0 || m_entries.contains(filename))
+    {
+        return;
+    }
+
+    const uint64_t size = sizeof(Header) + header.payload_size;
+    m_lru.push_front({filename, size});
+    m_entries[filename] = m_lru.begin();
+    m_total_bytes += size;
+    evict_locked();
+}
+
+void TextureDiskCache::touch(const std::wstring& filename)
+{
+    std::filesystem::path path;
+    {
+        std::lock_guard lock(m_mutex);
+        const auto it = m_entries.find(filename);
+        if (it == m_entries.end())
+        {
+            return;
+        }
+
+        m_lru.splice(m_lru.begin(), m_lru, it->second);
+        path = m_directory / filename;
+    }
+
+    // The write time is the last use, so the next session evicts in the same order
+    std::error_code ec;
+    std::filesystem::last_write_time(path, std::filesystem::file_time_type::clock::now(), ec);
+}
+
+void TextureDiskCache::evict_locked()
+{
+    std::error_code ec;
+    while (m_total_bytes > m_max_bytes && ! m_lru.empty())
+    {
+        const Entry& oldest = m_lru.back();
+        std::filesystem::remove(m_directory / oldest.filename, ec);
+        m_total_bytes -= oldest.size;
+        m_entries.erase(oldest.filename);
+        m_lru.pop_back();
+    }
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include "AtexReader.h"
+#include <filesystem>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+
+// Decoded ATEX/ATTX textures saved to disk, so textures decoded in an earlier session are read back
+// instead of being decoded again. Entries are keyed by the murmurhash3 and size of the decompressed
+// file, which identify the texture whichever DAT (or DAT version) it comes from, so one cache is
+// shared by every DATManager. Each texture is one file, read through a file mapping. When the files
+// grow past the size limit the least recently used ones are deleted, their write time is the last use.
+// Thread safe.
+class TextureDiskCache
+{
+public:
+    static constexpr uint64_t default_max_bytes = 2ull * 1024 * 1024 * 1024;
+
+    static TextureDiskCache& shared()
+    {
+        static TextureDiskCache cache;
+        return cache;
+    }
+
+    // Default directory, next to the executable like the DAT index sidecars
+    static std::optional<std::filesystem::path> get_default_directory();
+
+    // Uses directory for the cache, creating it if needed, and evicts down to max_bytes.
+    // An empty directory or a max_bytes of 0 disables the cache.
+    void configure(const std::filesystem::path& directory, uint64_t max_bytes);
+
+    bool is_enabled() const;
+    uint64_t get_size_bytes() const;
+
+    std::optional<DatTexture> load(uint32_t murmurhash3, uint32_t file_size);
+    void store(uint32_t murmurhash3, uint32_t file_size, const DatTexture& texture);
+
+    std::optional<DatCompressedTexture> load_blocks(uint32_t murmurhash3, uint32_t file_size);
+    void store_blocks(uint32_t murmurhash3, uint32_t file_size, const DatCompressedTexture& texture);
+
+    // Deletes every cached texture
+    void clear();
+
+private:
+    enum class Kind : uint32_t
+    {
+        RGBA,
+        Blocks
+    };
+
+    struct Header;
+
+    struct Entry
+    {
+        std::wstring filename;
+        uint64_t size;
+    };
+
+    mutable std::mutex m_mutex;
+    std::filesystem::path m_directory;
+    uint64_t m_max_bytes = 0;
+    uint64_t m_total_bytes = 0;
+
+    // Most recently used first
+    std::list<Entry> m_lru;
+    std::unordered_map<std::wstring, std::list<Entry>::iterator> m_entries;
+
+    static std::wstring get_filename(uint32_t murmurhash3, uint32_t file_size, Kind kind);
+
+    // Maps the file and checks its header, calls read(header, payload) while it is mapped
+    template <typename Read>
+    bool read_file(uint32_t murmurhash3, uint32_t file_size, Kind kind, const Read& read);
+    void write_file(const Header& header, const void* payload);
+
+    void touch(const std::wstring& filename);
+    void evict_locked();
+};
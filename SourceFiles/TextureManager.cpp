@@ -178,7 +178,7 @@ HRESULT TextureManager::SaveTextureToFile(ID3D11ShaderResourceView* srv, const w
     return hr;
 }
 DatTexture TextureManager::BuildTextureAtlas(const std::vector<DatTexture>& terrain_dat_textures,
-                                             int num_cols, int num_rows)
+                                             int num_cols, int num_rows, std::vector<AtlasUV>* uvs_out)
 {
     // Check if the input vector is empty
     if (terrain_dat_textures.empty())
@@ -186,6 +186,17 @@ DatTexture TextureManager::BuildTextureAtlas(const std::vector<DatTexture>& terr
         return {};
     }
 
+    // Without a fixed grid, pack the textures so small ones don't take a whole cell
+    if (num_cols == -1 || num_rows == -1)
+    {
+        TextureAtlas atlas = TextureAtlas::Pack(terrain_dat_textures);
+        if (uvs_out)
+        {
+            *uvs_out = atlas.GetUVs();
+        }
+        return atlas.TakeTexture();
+    }
+
     // Find the maximum dimensions among all textures
     int maxTexWidth = 0;
     int maxTexHeight = 0;
@@ -196,48 +207,45 @@ DatTexture TextureManager::BuildTextureAtlas(const std::vector<DatTexture>& terr
         maxTexHeight = std::max(maxTexHeight, texture.height);
     }
 
-    // If either num_cols or num_rows is -1, compute them automatically
-    if (num_cols == -1 || num_rows == -1)
-    {
-        int numTextures = static_cast<int>(terrain_dat_textures.size());
-        num_cols = static_cast<int>(std::ceil(std::sqrt(numTextures)));
-        num_rows = static_cast<int>(std::ceil(static_cast<double>(numTextures) / num_cols));
-    }
-
     unsigned int atlasWidth = maxTexWidth * num_cols;
     unsigned int atlasHeight = maxTexHeight * num_rows;
 
     std::vector<RGBA> atlasData(atlasWidth * atlasHeight, {0, 0, 0, 0});
 
-    int numTextures = static_cast<int>(terrain_dat_textures.size());
+    int numTextures = std::min(static_cast<int>(terrain_dat_textures.size()), num_cols * num_rows);
 
-    for (int row = 0; row < num_rows; ++row)
+    if (uvs_out)
     {
-        for (int col = 0; col < num_cols; ++col)
-        {
-            int textureIndex = row * num_cols + col;
+        uvs_out->assign(terrain_dat_textures.size(), AtlasUV{0.0f, 0.0f, 0.0f, 0.0f});
+    }
 
-            if (textureIndex < numTextures)
-            {
-                const auto& texture = terrain_dat_textures[textureIndex];
-                const std::vector<RGBA>& textureData = texture.rgba_data;
-                int texWidth = texture.width;
-                int texHeight = texture.height;
+    for (int textureIndex = 0; textureIndex < numTextures; ++textureIndex)
+    {
+        const int col = textureIndex % num_cols;
+        const int row = textureIndex / num_cols;
 
-                for (int y = 0; y < texHeight; ++y)
-                {
-                    for (int x = 0; x < texWidth; ++x)
-                    {
-                        int atlasX = col * maxTexWidth + x;
-                        int atlasY = row * maxTexHeight + y;
+        const auto& texture = terrain_dat_textures[textureIndex];
+        const int texWidth = texture.width;
+        const int texHeight = texture.height;
+        if (texWidth <= 0 || texHeight <= 0 || texture.rgba_data.size() < static_cast<size_t>(texWidth) * texHeight)
+        {
+            continue;
+        }
 
-                        int atlasOffset = atlasY * atlasWidth + atlasX;
-                        int textureOffset = y * texWidth + x;
+        // Copy a row at a time
+        for (int y = 0; y < texHeight; ++y)
+        {
+            const RGBA* src = texture.rgba_data.data() + static_cast<size_t>(y) * texWidth;
+            RGBA* dst = atlasData.data() + static_cast<size_t>(row * maxTexHeight + y) * atlasWidth + col * maxTexWidth;
+            std::copy_n(src, texWidth, dst);
+        }
 
-                        atlasData[atlasOffset] = textureData[textureOffset];
-                    }
-                }
-            }
+        if (uvs_out)
+        {
+            (*uvs_out)[textureIndex] = {static_cast<float>(col * maxTexWidth) / atlasWidth,
+                                        static_cast<float>(row * maxTexHeight) / atlasHeight,
+                                        static_cast<float>(col * maxTexWidth + texWidth) / atlasWidth,
+                                        static_cast<float>(row * maxTexHeight + texHeight) / atlasHeight};
         }
     }
 
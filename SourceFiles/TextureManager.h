@@ -1,5 +1,9 @@
 #pragma once
 #include "AtexReader.h"
+#include "BCEncoder.h"
+#include "MipChain.h"
+#include "PngWriter.h"
+#include "TextureAtlas.h"
 #include "DirectXTex/DirectXTex.h"
 
 inline UINT BytesPerPixel(DXGI_FORMAT format)
@@ -14,11 +18,28 @@ inline UINT BytesPerPixel(DXGI_FORMAT format)
 	case DXGI_FORMAT_R8G8B8A8_UNORM:
 	case DXGI_FORMAT_B8G8R8A8_UNORM:
 		return 4;
+	case DXGI_FORMAT_R16G16B16A16_UINT:
+		return 8;
 	default:
 		return 0; // Return 0 for unsupported formats
 	}
 }
 
+inline DXGI_FORMAT GetBlockFormatDXGI(BlockFormat format)
+{
+	switch (format)
+	{
+	case BlockFormat::BC1:
+		return DXGI_FORMAT_BC1_UNORM;
+	case BlockFormat::BC2:
+		return DXGI_FORMAT_BC2_UNORM;
+	case BlockFormat::BC3:
+		return DXGI_FORMAT_BC3_UNORM;
+	default:
+		return DXGI_FORMAT_UNKNOWN;
+	}
+}
+
 struct TextureData
 {
 	int textureID;
@@ -36,8 +57,10 @@ public:
 
 	~TextureManager() { Clear(); }
 
+	// row_pitch is the distance between rows of data in bytes, 0 for tightly packed rows. Textures with a
+	// file_hash are cached from data as if it were tightly packed, pass -1 with a larger pitch.
 	int AddTexture(const void* data, UINT width, UINT height, DXGI_FORMAT format, int file_hash,
-	               bool autoGenerateMipMaps = true)
+	               bool autoGenerateMipMaps = true, UINT row_pitch = 0)
 	{
 		if (cached_textures.contains(file_hash))
 			return cached_textures[file_hash].textureID;
@@ -57,14 +80,16 @@ public:
 		texDesc.CPUAccessFlags = 0;
 		texDesc.MiscFlags = autoGenerateMipMaps ? D3D11_RESOURCE_MISC_GENERATE_MIPS : 0;
 
+		if (row_pitch == 0)
+			row_pitch = width * BytesPerPixel(format);
+
 		D3D11_SUBRESOURCE_DATA* pInitData = nullptr;
 		D3D11_SUBRESOURCE_DATA initData = {};
 		if (!autoGenerateMipMaps)
 		{
 			initData.pSysMem = data;
-			UINT bytesPerPixel = BytesPerPixel(format);
-			initData.SysMemPitch = width * bytesPerPixel;
-			initData.SysMemSlicePitch = width * height * bytesPerPixel;
+			initData.SysMemPitch = row_pitch;
+			initData.SysMemSlicePitch = row_pitch * height;
 			pInitData = &initData;
 		}
 
@@ -74,8 +99,7 @@ public:
 
 		if (autoGenerateMipMaps)
 		{
-			UINT bytesPerPixel = BytesPerPixel(format);
-			m_deviceContext->UpdateSubresource(texture2D.Get(), 0, nullptr, data, width * bytesPerPixel, 0);
+			m_deviceContext->UpdateSubresource(texture2D.Get(), 0, nullptr, data, row_pitch, 0);
 		}
 
 		D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
@@ -262,8 +286,11 @@ public:
 	                                     int file_hash);
 	HRESULT SaveTextureToFile(ID3D11ShaderResourceView* srv, const wchar_t* filename);
 
+	// With num_cols and num_rows the textures are laid out on a grid of cells the size of the largest
+	// texture, the layout the terrain export expects. With -1 they are bin packed (see TextureAtlas).
+	// uvs_out, if given, receives the UV rectangle of each texture in the atlas.
 	DatTexture BuildTextureAtlas(const std::vector<DatTexture>& terrain_dat_textures, int num_cols,
-	                             int num_rows);
+	                             int num_rows, std::vector<AtlasUV>* uvs_out = nullptr);
 
 	void Clear() { 
 		m_textures.clear(); 
@@ -277,55 +304,6 @@ private:
 	std::unordered_map<int, TextureData> cached_textures;
 
 	std::unordered_map<int, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>> m_textures;
-
-	void GenerateMipmapLevel(const std::vector<uint8_t>& higherLevelData,
-                         std::vector<uint8_t>& lowerLevelData,
-                         UINT higherWidth, UINT higherHeight, UINT bytesPerPixel)
-{
-    if (bytesPerPixel != 4)
-    {
-        return; // Unsupported format
-    }
-
-    UINT lowerWidth = higherWidth / 2;
-    UINT lowerHeight = higherHeight / 2;
-    lowerLevelData.resize(lowerWidth * lowerHeight * bytesPerPixel);
-
-    const uint8_t* src = higherLevelData.data();
-    uint8_t* dst = lowerLevelData.data();
-
-    for (UINT y = 0; y < lowerHeight; ++y)
-    {
-        for (UINT x = 0; x < lowerWidth; ++x)
-        {
-            UINT dstIdx = 4 * (y * lowerWidth + x);
-
-            for (UINT channel = 0; channel < 4; ++channel)
-            {
-                std::vector<uint8_t> values;
-                for (int dy = -1; dy <= 1; dy++)
-                {
-                    for (int dx = -1; dx <= 1; dx++)
-                    {
-                        int nx = 2 * x + dx;
-                        int ny = 2 * y + dy;
-
-                        if (nx < 0 || ny < 0 || nx >= higherWidth || ny >= higherHeight)
-                            continue;
-
-                        UINT srcIdx = 4 * (ny * higherWidth + nx);
-                        values.push_back(src[srcIdx + channel]);
-                    }
-                }
-
-                // Sort and find the median
-                std::sort(values.begin(), values.end());
-                dst[dstIdx + channel] = values[values.size() / 2];
-            }
-        }
-    }
-}
-
 };
 
 inline bool SaveTextureToPng(ID3D11ShaderResourceView* texture, std::wstring& filename,
@@ -341,6 +319,52 @@ inline bool SaveTextureToPng(ID3D11ShaderResourceView* texture, std::wstring& fi
 	return true;
 }
 
+// Writes a DatTexture to a PNG file on the CPU, without going through a D3D texture
+inline bool SaveTextureToPng(const DatTexture& texture, const std::wstring& filename)
+{
+	if (texture.width <= 0 || texture.height <= 0 ||
+		texture.rgba_data.size() < static_cast<size_t>(texture.width) * texture.height)
+	{
+		return false;
+	}
+
+	return WritePng(filename, texture.rgba_data.data(), texture.width, texture.height, PngPixelOrder::BGRA);
+}
+
+// Decodes the top level of a DDS file to B8G8R8A8 texels on the CPU, the layout of DatTexture
+inline bool DecodeDDSTexture(const uint8_t* dds_data, size_t dds_data_size, DatTexture& texture_out)
+{
+	DirectX::TexMetadata metadata;
+	DirectX::ScratchImage image;
+	HRESULT hr = DirectX::LoadFromDDSMemory(dds_data, dds_data_size, DirectX::DDS_FLAGS_NONE, &metadata, image);
+	if (FAILED(hr) || metadata.width == 0 || metadata.height == 0)
+		return false;
+
+	constexpr DXGI_FORMAT targetFormat = DXGI_FORMAT_B8G8R8A8_UNORM;
+	if (metadata.format != targetFormat)
+	{
+		DirectX::ScratchImage converted;
+		if (DirectX::IsCompressed(metadata.format))
+			hr = DirectX::Decompress(*image.GetImage(0, 0, 0), targetFormat, converted);
+		else
+			hr = DirectX::Convert(*image.GetImage(0, 0, 0), targetFormat, DirectX::TEX_FILTER_DEFAULT,
+				DirectX::TEX_THRESHOLD_DEFAULT, converted);
+		if (FAILED(hr))
+			return false;
+		image = std::move(converted);
+	}
+
+	const DirectX::Image* top = image.GetImage(0, 0, 0);
+	texture_out.width = static_cast<int>(top->width);
+	texture_out.height = static_cast<int>(top->height);
+	texture_out.texture_type = DDSt;
+	texture_out.rgba_data.resize(top->width * top->height);
+	for (size_t y = 0; y < top->height; y++)
+		std::memcpy(texture_out.rgba_data.data() + y * top->width, top->pixels + y * top->rowPitch, top->width * sizeof(RGBA));
+
+	return true;
+}
+
 enum class CompressionFormat {
 	None,
 	BC1, // DXGI_FORMAT_BC1_UNORM
@@ -349,60 +373,136 @@ enum class CompressionFormat {
 };
 
 
-inline bool SaveTextureToDDS(const TextureData& textureData, const std::wstring& filename, CompressionFormat compressionFormat)
+// Writes the blocks of an ATEX texture to a DDS file as they are stored in the DAT, without decoding and
+// re-encoding them. Only has the top mip level.
+inline bool SaveCompressedTextureToDDS(const DatCompressedTexture& texture, const std::wstring& filename)
 {
-	size_t totalSize = textureData.rgba_data.size() * sizeof(RGBA);
-	std::vector<uint8_t> pixelData(totalSize);
-
-	// Copy the pixel data
-	std::memcpy(pixelData.data(), textureData.rgba_data.data(), totalSize);
+	if (texture.width <= 0 || texture.height <= 0 || texture.blocks.size() < texture.row_pitch() * (texture.height / 4))
+		return false;
 
-	// Create the Image structure
 	DirectX::Image image;
-	image.width = static_cast<size_t>(textureData.width);
-	image.height = static_cast<size_t>(textureData.height);
-	image.format = DXGI_FORMAT_B8G8R8A8_UNORM;
-	image.rowPitch = textureData.width * sizeof(RGBA);
-	image.slicePitch = image.rowPitch * textureData.height;
-	image.pixels = pixelData.data();
-
-	// Create a ScratchImage to hold the initial texture
-	DirectX::ScratchImage scratchImage;
-	HRESULT hr = scratchImage.InitializeFromImage(image);
-	if (FAILED(hr)) {
+	image.width = static_cast<size_t>(texture.width);
+	image.height = static_cast<size_t>(texture.height);
+	image.format = GetBlockFormatDXGI(texture.block_format);
+	image.rowPitch = texture.row_pitch();
+	image.slicePitch = image.rowPitch * (texture.height / 4);
+	image.pixels = const_cast<uint8_t*>(texture.blocks.data());
+
+	HRESULT hr = DirectX::SaveToDDSFile(image, DirectX::DDS_FLAGS_NONE, filename.c_str());
+	return SUCCEEDED(hr);
+}
+
+// True if the blocks the DAT stores for a texture can be the top level of a DDS file in compressionFormat
+inline bool CanReuseCompressedBlocks(const DatCompressedTexture& blocks, const TextureData& textureData,
+	CompressionFormat compressionFormat)
+{
+	const bool sameFormat = (compressionFormat == CompressionFormat::BC1 && blocks.block_format == BlockFormat::BC1) ||
+		(compressionFormat == CompressionFormat::BC3 && blocks.block_format == BlockFormat::BC3);
+
+	// 'L' textures are premultiplied after decoding, their blocks don't hold the texels textureData has
+	return sameFormat && !blocks.premultiply_alpha && blocks.width == textureData.width &&
+		blocks.height == textureData.height && blocks.width % 4 == 0 && blocks.height % 4 == 0 &&
+		blocks.blocks.size() >= blocks.row_pitch() * (blocks.height / 4);
+}
+
+// True if the texels are colours, whose mips are averaged in linear space. BC5 and normal maps hold
+// vectors, those are averaged as stored.
+inline bool HasColorTexels(CompressionFormat compressionFormat, TextureType textureType)
+{
+	return compressionFormat != CompressionFormat::BC5 && textureType != TextureType::NormalMap;
+}
+
+// Saves the texture with a full mip chain, averaged in linear space if srgbMips (see HasColorTexels). The
+// block compressed formats are encoded by BCEncoder, on the TaskPool across the blocks of every level. If
+// sourceBlocks, the texture's blocks from the DAT (see DATManager::parse_ffna_texture_blocks), are already in
+// the requested format they are written as the top level as they are and only the smaller levels are encoded.
+inline bool SaveTextureToDDS(const TextureData& textureData, const std::wstring& filename, CompressionFormat compressionFormat,
+	bool srgbMips, const DatCompressedTexture* sourceBlocks = nullptr, BCQuality quality = BCQuality::Normal)
+{
+	if (textureData.width <= 0 || textureData.height <= 0 ||
+		textureData.rgba_data.size() < static_cast<size_t>(textureData.width) * textureData.height)
+	{
 		return false;
 	}
 
 	// Generate mipmaps
-	DirectX::ScratchImage mipmappedImage;
-	hr = DirectX::GenerateMipMaps(*scratchImage.GetImage(0, 0, 0), DirectX::TEX_FILTER_DEFAULT, 0, mipmappedImage);
-	if (FAILED(hr)) {
-		return false;
-	}
+	const MipChain mipChain = GenerateMipChain(textureData.rgba_data.data(), textureData.width, textureData.height,
+		MipFilter::Box, srgbMips);
 
-	DirectX::ScratchImage finalImage;
+	DXGI_FORMAT format;
+	BCEncodeFormat encodeFormat = BCEncodeFormat::BC1;
 	switch (compressionFormat) {
 	case CompressionFormat::None:
-		finalImage = std::move(mipmappedImage);
+		format = DXGI_FORMAT_B8G8R8A8_UNORM;
 		break;
 	case CompressionFormat::BC1:
-		hr = DirectX::Compress(mipmappedImage.GetImages(), mipmappedImage.GetImageCount(), mipmappedImage.GetMetadata(), DXGI_FORMAT_BC1_UNORM, DirectX::TEX_COMPRESS_DEFAULT, DirectX::TEX_THRESHOLD_DEFAULT, finalImage);
+		format = DXGI_FORMAT_BC1_UNORM;
+		encodeFormat = BCEncodeFormat::BC1;
 		break;
 	case CompressionFormat::BC3:
-		hr = DirectX::Compress(mipmappedImage.GetImages(), mipmappedImage.GetImageCount(), mipmappedImage.GetMetadata(), DXGI_FORMAT_BC3_UNORM, DirectX::TEX_COMPRESS_DEFAULT, DirectX::TEX_THRESHOLD_DEFAULT, finalImage);
+		format = DXGI_FORMAT_BC3_UNORM;
+		encodeFormat = BCEncodeFormat::BC3;
 		break;
 	case CompressionFormat::BC5:
-		hr = DirectX::Compress(mipmappedImage.GetImages(), mipmappedImage.GetImageCount(), mipmappedImage.GetMetadata(), DXGI_FORMAT_BC5_UNORM, DirectX::TEX_COMPRESS_DEFAULT, DirectX::TEX_THRESHOLD_DEFAULT, finalImage);
+		format = DXGI_FORMAT_BC5_UNORM;
+		encodeFormat = BCEncodeFormat::BC5;
 		break;
 
 	default:
 		return false;
 	}
 
+	DirectX::ScratchImage finalImage;
+	HRESULT hr = finalImage.Initialize2D(format, textureData.width, textureData.height, 1, mipChain.levels.size());
 	if (FAILED(hr)) {
 		return false;
 	}
 
+	if (compressionFormat == CompressionFormat::None) {
+		for (size_t level = 0; level < mipChain.levels.size(); level++) {
+			const DirectX::Image* image = finalImage.GetImage(level, 0, 0);
+			const std::span<const RGBA> texels = mipChain.GetLevel(level);
+			const size_t rowSize = image->width * sizeof(RGBA);
+			for (size_t y = 0; y < image->height; y++) {
+				std::memcpy(image->pixels + y * image->rowPitch, texels.data() + y * image->width, rowSize);
+			}
+		}
+	}
+	else if (sourceBlocks && CanReuseCompressedBlocks(*sourceBlocks, textureData, compressionFormat)) {
+		const DirectX::Image* top = finalImage.GetImage(0, 0, 0);
+		for (int y = 0; y < sourceBlocks->height / 4; y++) {
+			std::memcpy(top->pixels + y * top->rowPitch, sourceBlocks->blocks.data() + y * sourceBlocks->row_pitch(),
+				sourceBlocks->row_pitch());
+		}
+
+		std::vector<uint8_t> blocks;
+		for (size_t level = 1; level < mipChain.levels.size(); level++) {
+			const DirectX::Image* image = finalImage.GetImage(level, 0, 0);
+			const MipLevel& mip = mipChain.levels[level];
+			blocks.resize(GetBCEncodedSize(encodeFormat, mip.width, mip.height));
+			EncodeBC(mipChain.GetLevel(level).data(), mip.width, mip.height, encodeFormat, quality, blocks.data());
+
+			const size_t rowSize = ((mip.width + 3) / 4) * GetBCBlockSize(encodeFormat);
+			const size_t blockRows = (mip.height + 3) / 4;
+			for (size_t y = 0; y < blockRows; y++) {
+				std::memcpy(image->pixels + y * image->rowPitch, blocks.data() + y * rowSize, rowSize);
+			}
+		}
+	}
+	else {
+		const BCMipChain encoded = EncodeBCMipChain(mipChain, encodeFormat, quality);
+		for (size_t level = 0; level < mipChain.levels.size(); level++) {
+			const DirectX::Image* image = finalImage.GetImage(level, 0, 0);
+			const MipLevel& mip = mipChain.levels[level];
+			const size_t rowSize = ((mip.width + 3) / 4) * GetBCBlockSize(encodeFormat);
+			const size_t blockRows = (mip.height + 3) / 4;
+			const uint8_t* blocks = encoded.blocks.data() + encoded.levelOffsets[level];
+			for (size_t y = 0; y < blockRows; y++) {
+				std::memcpy(image->pixels + y * image->rowPitch, blocks + y * rowSize, rowSize);
+			}
+		}
+	}
+
 	// Save the final texture (compressed or uncompressed) to a DDS file
 	hr = DirectX::SaveToDDSFile(finalImage.GetImages(), finalImage.GetImageCount(), finalImage.GetMetadata(), DirectX::DDS_FLAGS_NONE, filename.c_str());
 	return SUCCEEDED(hr);
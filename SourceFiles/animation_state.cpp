@@ -475,7 +475,8 @@ static bool CheckFileForMatchingAnimation(
 /**
  * @brief Executes one animation search request.
  *
- * Runs on the background worker thread and aborts early when a newer request
+ * Runs on the background worker thread. The files are searched by tasks on the
+ * shared TaskPool, one per DatReadRange, which stop early when a newer request
  * has been queued or cancellation was requested.
  */
 static void RunAnimationSearchRequest(const AnimationSearchRequest& request)
@@ -506,96 +507,111 @@ static void RunAnimationSearchRequest(const AnimationSearchRequest& request)
     }
 
     std::vector<AnimationSearchResult> localResults;
-    if (request.mode == AnimationSearchMode::AutoFirstMatch)
-    {
-        localResults.reserve(1);
-    }
+    std::mutex resultsMutex;
+    std::vector<std::unique_ptr<DatReadScheduler>> schedulers;
+    TaskGroup tasks;
 
-    // Search each DAT.
-    for (const auto& pair : dat_managers)
+    const auto shouldStop = [&tasks]()
     {
         if (s_abortActiveSearch.load() || HasPendingSearchRequest())
         {
-            return;
+            tasks.cancel();
         }
+        return tasks.is_cancelled();
+    };
 
-        DATManager* manager = pair.second.get();
-        int datAlias = pair.first;
+    const auto searchRange = [&](DATManager* manager, int datAlias, const DatReadScheduler& scheduler, const DatReadRange& range)
+    {
+        const auto& mft = manager->get_MFT();
 
-        if (!manager)
+        // Skip files that cannot contain model animation chunks.
+        const auto canContainAnimation = [&mft](int i)
         {
-            continue;
-        }
+            return mft[i].uncompressedSize >= 57 && mft[i].type == FFNA_Type2;
+        };
 
-        const auto& mft = manager->get_MFT();
-        for (size_t i = 0; i < mft.size(); ++i)
+        for (int i : scheduler.indices(range))
         {
-            if (s_abortActiveSearch.load() || HasPendingSearchRequest())
-            {
-                return;
-            }
-
-            const auto& entry = mft[i];
-
-            // Skip files that cannot contain model animation chunks.
-            if (entry.uncompressedSize < 57 || entry.type != FFNA_Type2)
+            if (!canContainAnimation(i))
             {
                 g_animationState.filesProcessed.fetch_add(1);
-                continue;
             }
+        }
 
-            try
-            {
-                uint8_t* fileData = manager->read_file(static_cast<int>(i));
-                if (!fileData)
+        HANDLE fileHandle = manager->open_read_handle();
+        try
+        {
+            manager->for_each_file_in_range(scheduler, range, fileHandle,
+                [&](int i) { return canContainAnimation(i) && !shouldStop(); },
+                [&](int i, std::span<const uint8_t> data)
                 {
-                    g_animationState.filesProcessed.fetch_add(1);
-                    continue;
-                }
+                    AnimationSearchResult result;
+                    if (!data.empty() &&
+                        CheckFileForMatchingAnimation(data.data(), data.size(), request.targetHash0, request.targetHash1, result))
+                    {
+                        result.fileId = mft[i].Hash;
+                        result.mftIndex = i;
+                        result.datAlias = datAlias;
 
-                AnimationSearchResult result;
-                bool found = CheckFileForMatchingAnimation(
-                    fileData,
-                    entry.uncompressedSize,
-                    request.targetHash0,
-                    request.targetHash1,
-                    result);
+                        std::lock_guard<std::mutex> lock(resultsMutex);
+                        localResults.push_back(result);
 
-                if (found)
-                {
-                    result.fileId = entry.Hash;
-                    result.mftIndex = static_cast<int>(i);
-                    result.datAlias = datAlias;
-                    localResults.push_back(result);
-
-                    if (request.mode == AnimationSearchMode::AutoFirstMatch)
-                    {
-                        delete[] fileData;
-                        g_animationState.filesProcessed.fetch_add(1);
-                        if (s_abortActiveSearch.load() || HasPendingSearchRequest())
+                        if (request.mode == AnimationSearchMode::AutoFirstMatch)
                         {
-                            return;
+                            tasks.cancel();
                         }
-                        PublishCompletedSearch(request, std::move(localResults));
-                        return;
                     }
-                }
 
-                delete[] fileData;
-            }
-            catch (...)
-            {
-                // Ignore errors for individual files.
-            }
+                    g_animationState.filesProcessed.fetch_add(1);
+                });
+        }
+        catch (...)
+        {
+            // Ignore errors for individual files.
+        }
 
-            g_animationState.filesProcessed.fetch_add(1);
+        if (fileHandle)
+        {
+            CloseHandle(fileHandle);
+        }
+    };
+
+    // Search each DAT.
+    for (const auto& pair : dat_managers)
+    {
+        DATManager* manager = pair.second.get();
+        int datAlias = pair.first;
+
+        if (!manager)
+        {
+            continue;
+        }
+
+        DatReadScheduler* scheduler = schedulers.emplace_back(std::make_unique<DatReadScheduler>(manager->get_MFT())).get();
+        DatReadRange range;
+        while (scheduler->next_range(range))
+        {
+            tasks.run([&searchRange, manager, datAlias, scheduler, range]() { searchRange(manager, datAlias, *scheduler, range); });
         }
     }
+    tasks.wait();
 
     if (s_abortActiveSearch.load() || HasPendingSearchRequest())
     {
         return;
     }
+
+    // Tasks finish in any order, report results in DAT then MFT order like a sequential scan would.
+    // An auto-first-match search may have found several matches before the others stopped, keep the first.
+    std::sort(localResults.begin(), localResults.end(),
+        [](const AnimationSearchResult& a, const AnimationSearchResult& b)
+        {
+            return a.datAlias != b.datAlias ? a.datAlias < b.datAlias : a.mftIndex < b.mftIndex;
+        });
+    if (request.mode == AnimationSearchMode::AutoFirstMatch && localResults.size() > 1)
+    {
+        localResults.resize(1);
+    }
     PublishCompletedSearch(request, std::move(localResults));
 }
 
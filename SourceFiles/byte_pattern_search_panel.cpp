@@ -100,6 +100,7 @@ struct SearchResult {
 static std::vector<std::optional<uint8_t>> g_search_pattern;
 static std::vector<SearchResult> g_search_results;
 static std::atomic<bool> g_search_in_progress{ false };
+static CancellationSource g_search_cancellation;
 static std::atomic<int> g_files_processed{ 0 };
 static std::atomic<int> g_total_files{ 0 };
 static std::atomic<int> g_matches_found{ 0 };
@@ -177,55 +178,50 @@ void initialize_file_types(std::map<int, std::unique_ptr<DATManager>>& dat_manag
 	g_types_initialized = true;
 }
 
-void search_dat_files_worker(DATManager* dat_manager, int dat_alias,
-	const BytePatternMatcher& matcher) {
+// Searches the files of one range of a DAT, one task on the shared pool
+void search_dat_files_in_range(DATManager* dat_manager, int dat_alias, const DatReadScheduler& scheduler,
+	const DatReadRange& range, const BytePatternMatcher& matcher, const TaskGroup& tasks) {
 	const auto& mft = dat_manager->get_MFT();
 	const size_t current_pattern_size = matcher.get_pattern_size();
 
-	for (size_t j = 0; j < mft.size(); ++j) {
-		if (!g_search_in_progress.load(std::memory_order_relaxed)) {
-			break;
-		}
-
+	enum class SkipReason { None, TooSmall, TypeDisabled };
+	const auto get_skip_reason = [&](int j) {
 		const auto& entry = mft[j];
 
 		if (entry.uncompressedSize <= 0 || (current_pattern_size > 0 && static_cast<size_t>(entry.uncompressedSize) < current_pattern_size)) {
-			g_files_processed.fetch_add(1, std::memory_order_relaxed);
-			continue;
+			return SkipReason::TooSmall;
 		}
 
 		// Check if this file type should be searched
-		std::string type_str = typeToString(entry.type);
-		if (g_enabled_types.find(type_str) == g_enabled_types.end()) {
-			g_files_processed.fetch_add(1, std::memory_order_relaxed);
-			g_files_skipped.fetch_add(1, std::memory_order_relaxed);
-			continue;
+		if (g_enabled_types.find(typeToString(entry.type)) == g_enabled_types.end()) {
+			return SkipReason::TypeDisabled;
 		}
 
-		uint8_t* file_data = nullptr;
-		try {
-			file_data = dat_manager->read_file(static_cast<int>(j));
-			if (!file_data) {
-				g_files_processed.fetch_add(1, std::memory_order_relaxed);
-				continue;
-			}
+		return SkipReason::None;
+	};
 
-			auto matches = matcher.search(file_data, entry.uncompressedSize);
-
-			if (!matches.empty()) {
-				SearchResult current_result;
-				current_result.file_id = entry.Hash;
-				current_result.dat_alias = dat_alias;
-				current_result.match_positions = std::move(matches);
-				current_result.uncompressed_size = entry.uncompressedSize;
-				current_result.type = type_str;
-				current_result.id = static_cast<int32_t>(j);
-				current_result.murmurhash3 = entry.murmurhash3;
+	const auto search_file = [&](int j, std::span<const uint8_t> file_data) {
+		const auto& entry = mft[j];
 
-				{
-					std::lock_guard<std::mutex> lock(g_results_mutex);
-					g_search_results.emplace_back(std::move(current_result));
-					g_matches_found.fetch_add(g_search_results.back().match_positions.size(), std::memory_order_relaxed);
+		try {
+			if (!file_data.empty()) {
+				auto matches = matcher.search(file_data.data(), file_data.size());
+
+				if (!matches.empty()) {
+					SearchResult current_result;
+					current_result.file_id = entry.Hash;
+					current_result.dat_alias = dat_alias;
+					current_result.match_positions = std::move(matches);
+					current_result.uncompressed_size = entry.uncompressedSize;
+					current_result.type = typeToString(entry.type);
+					current_result.id = static_cast<int32_t>(j);
+					current_result.murmurhash3 = entry.murmurhash3;
+
+					{
+						std::lock_guard<std::mutex> lock(g_results_mutex);
+						g_search_results.emplace_back(std::move(current_result));
+						g_matches_found.fetch_add(g_search_results.back().match_positions.size(), std::memory_order_relaxed);
+					}
 				}
 			}
 		}
@@ -234,15 +230,35 @@ void search_dat_files_worker(DATManager* dat_manager, int dat_alias,
 		catch (...) {
 		}
 
-		if (file_data) {
-			delete[] file_data;
-		}
 		g_files_processed.fetch_add(1, std::memory_order_relaxed);
+	};
+
+	for (int j : scheduler.indices(range)) {
+		const auto reason = get_skip_reason(j);
+		if (reason != SkipReason::None) {
+			g_files_processed.fetch_add(1, std::memory_order_relaxed);
+		}
+		if (reason == SkipReason::TypeDisabled) {
+			g_files_skipped.fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+
+	HANDLE file_handle = dat_manager->open_read_handle();
+	try {
+		// Checking for cancellation per file keeps Cancel responsive even on ranges of big files
+		dat_manager->for_each_file_in_range(scheduler, range, file_handle,
+			[&](int j) { return !tasks.is_cancelled() && get_skip_reason(j) == SkipReason::None; }, search_file);
+	}
+	catch (...) {
+	}
+
+	if (file_handle) {
+		CloseHandle(file_handle);
 	}
 }
 
 void perform_pattern_search(std::map<int, std::unique_ptr<DATManager>>& dat_managers) {
-	if (g_search_pattern.empty()) {
+	if (g_search_pattern.empty() || g_search_cancellation.is_cancelled()) {
 		g_search_in_progress.store(false);
 		return;
 	}
@@ -272,50 +288,27 @@ void perform_pattern_search(std::map<int, std::unique_ptr<DATManager>>& dat_mana
 
 	BytePatternMatcher matcher(g_search_pattern);
 
-	const size_t max_threads = std::min(static_cast<size_t>(std::thread::hardware_concurrency()), static_cast<size_t>(4));
-	std::vector<std::future<void>> active_futures;
-	active_futures.reserve(max_threads);
+	// Every range of every DAT is a task on the shared pool, so all cores are busy until the
+	// last range is searched instead of one thread per DAT waiting on the largest one.
+	// The DATs are read in offset order, see DatReadScheduler.
+	std::vector<std::unique_ptr<DatReadScheduler>> schedulers;
+	TaskGroup tasks(g_search_cancellation.token());
 
 	for (const auto& pair_entry : dat_managers) {
 		DATManager* manager_ptr = pair_entry.second.get();
 		int alias_val = pair_entry.first;
 
-		if (!g_search_in_progress.load(std::memory_order_relaxed)) break;
 		if (!manager_ptr) continue;
 
-		while (active_futures.size() >= max_threads) {
-			bool slot_freed = false;
-			for (auto it = active_futures.begin(); it != active_futures.end(); ) {
-				if (it->wait_for(std::chrono::milliseconds(1)) == std::future_status::ready) {
-					try { it->get(); }
-					catch (const std::exception&) {}
-					catch (...) {}
-					it = active_futures.erase(it);
-					slot_freed = true;
-					break;
-				}
-				else {
-					++it;
-				}
-			}
-			if (!g_search_in_progress.load(std::memory_order_relaxed)) break;
-
-			if (!slot_freed && active_futures.size() >= max_threads) {
-				std::this_thread::sleep_for(std::chrono::milliseconds(10));
-			}
-		}
-		if (!g_search_in_progress.load(std::memory_order_relaxed)) break;
-
-		active_futures.emplace_back(std::async(std::launch::async, search_dat_files_worker, manager_ptr, alias_val, std::ref(matcher)));
-	}
-
-	for (auto& future : active_futures) {
-		if (future.valid()) {
-			try { future.get(); }
-			catch (const std::exception&) {}
-			catch (...) {}
+		DatReadScheduler* scheduler = schedulers.emplace_back(std::make_unique<DatReadScheduler>(manager_ptr->get_MFT())).get();
+		DatReadRange range;
+		while (scheduler->next_range(range)) {
+			tasks.run([manager_ptr, alias_val, scheduler, range, &matcher, &tasks] {
+				search_dat_files_in_range(manager_ptr, alias_val, *scheduler, range, matcher, tasks);
+			});
 		}
 	}
+	tasks.wait();
 
 	{
 		std::lock_guard<std::mutex> lock(g_results_mutex);
@@ -438,14 +431,18 @@ void draw_byte_pattern_search_panel(std::map<int, std::unique_ptr<DATManager>>&
 			!g_search_in_progress.load() && !g_enabled_types.empty();
 
 		if (g_search_in_progress.load()) {
-			if (ImGui::Button("Cancel Search")) {
-				g_search_in_progress.store(false);
+			// The search stays in progress until its running tasks have noticed the cancellation
+			ImGui::BeginDisabled(g_search_cancellation.is_cancelled());
+			if (ImGui::Button(g_search_cancellation.is_cancelled() ? "Cancelling..." : "Cancel Search")) {
+				g_search_cancellation.cancel();
 			}
+			ImGui::EndDisabled();
 		}
 		else {
 			ImGui::BeginDisabled(!can_start_search);
 			if (ImGui::Button("Start Search")) {
 				g_search_pattern = current_parsed_pattern;
+				g_search_cancellation = CancellationSource();
 				g_search_in_progress.store(true);
 				g_files_processed.store(0);
 				g_matches_found.store(0);
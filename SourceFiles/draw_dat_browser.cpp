@@ -113,7 +113,7 @@ bool parse_file(DATManager* dat_manager, int index, MapRenderer* map_renderer,
 {
 	bool success = false;
 
-	const auto MFT = dat_manager->get_MFT();
+	const auto& MFT = dat_manager->get_MFT();
 	if (index >= MFT.size())
 		return false;
 
@@ -1631,41 +1631,46 @@ bool parse_file(DATManager* dat_manager, int index, MapRenderer* map_renderer,
 			success = true;
 		}
 
-		// Load models
-		std::vector<int> selected_map_file{};
-		for (int i = 0; i < selected_ffna_map_file.prop_filenames_chunk.array.size(); i++)
+		// Load models. They are read and decompressed in the background all at once and
+		// parsed here in order as they arrive, instead of one full read after another.
+		std::vector<int> map_model_indices;
+		const auto add_map_model = [&](const FileName& filename)
 		{
-			auto decoded_filename =
-				decode_filename(selected_ffna_map_file.prop_filenames_chunk.array[i].filename.id0,
-					selected_ffna_map_file.prop_filenames_chunk.array[i].filename.id1);
+			auto decoded_filename = decode_filename(filename.id0, filename.id1);
 			auto mft_entry_it = hash_index.find(decoded_filename);
 			if (mft_entry_it != hash_index.end())
 			{
 				auto type = dat_manager->get_MFT()[mft_entry_it->second.at(0)].type;
 				if (type == FFNA_Type2)
 				{
-					selected_map_files.emplace_back(
-						dat_manager->parse_ffna_model_file(mft_entry_it->second.at(0)));
+					map_model_indices.push_back(mft_entry_it->second.at(0));
 				}
 			}
+		};
+
+		for (int i = 0; i < selected_ffna_map_file.prop_filenames_chunk.array.size(); i++)
+		{
+			add_map_model(selected_ffna_map_file.prop_filenames_chunk.array[i].filename);
 		}
 
-		// Load models
 		for (int i = 0; i < selected_ffna_map_file.more_filnames_chunk.array.size(); i++)
 		{
-			auto decoded_filename =
-				decode_filename(selected_ffna_map_file.more_filnames_chunk.array[i].filename.id0,
-					selected_ffna_map_file.more_filnames_chunk.array[i].filename.id1);
-			auto mft_entry_it = hash_index.find(decoded_filename);
-			if (mft_entry_it != hash_index.end())
+			add_map_model(selected_ffna_map_file.more_filnames_chunk.array[i].filename);
+		}
+
+		auto map_model_data = dat_manager->read_files_async(map_model_indices);
+		for (int i = 0; i < map_model_indices.size(); i++)
+		{
+			auto data = map_model_data[i].get();
+			if (data.empty())
 			{
-				auto type = dat_manager->get_MFT()[mft_entry_it->second.at(0)].type;
-				if (type == FFNA_Type2)
-				{
-					auto map_model = dat_manager->parse_ffna_model_file(mft_entry_it->second.at(0));
-					selected_map_files.emplace_back(map_model);
-				}
+				// Same behaviour as before for files that can't be read in the background
+				selected_map_files.emplace_back(dat_manager->parse_ffna_model_file(map_model_indices[i]));
+				continue;
 			}
+
+			std::span<unsigned char> file_data(data);
+			selected_map_files.emplace_back(FFNA_ModelFile(0, file_data));
 		}
 
 		for (int i = 0; i < selected_ffna_map_file.props_info_chunk.prop_array.props_info.size(); i++)
@@ -2315,7 +2320,7 @@ void draw_data_browser(DATManager* dat_manager, MapRenderer* map_renderer, const
 					encode_filehash(entry.Hash, filename_id_0, filename_id_1);
 
 					DatBrowserItem new_item{
-						i, entry.Hash, static_cast<FileType>(entry.type), entry.Size, entry.uncompressedSize, filename_id_0, filename_id_1, {}, {}, {}, entry.murmurhash3, entry.chunk_ids
+						i, entry.Hash, static_cast<FileType>(entry.type), entry.Size, entry.uncompressedSize, filename_id_0, filename_id_1, {}, {}, {}, entry.murmurhash3, dat_manager->get_chunk_ids(i)
 					};
 					auto custom_file_info_it = custom_file_info_map.find(entry.Hash);
 					if (custom_file_info_it == custom_file_info_map.end()) {
@@ -3078,8 +3083,8 @@ void draw_data_browser(DATManager* dat_manager, MapRenderer* map_renderer, const
 									if (!savePath.empty())
 									{
 										parse_file(dat_manager, item.id, map_renderer, hash_index);
-										const auto& terrain_mesh = terrain.get()->get_mesh();
-										const auto obj_file_str = write_obj_str(terrain_mesh);
+										const auto terrain_mesh = terrain.get()->GenerateUnsharedTerrainMesh();
+										const auto obj_file_str = write_obj_str(&terrain_mesh);
 
 										std::string savePathStr(savePath.begin(), savePath.end());
 
@@ -3208,6 +3213,9 @@ void draw_data_browser(DATManager* dat_manager, MapRenderer* map_renderer, const
 									const auto compression_format = CompressionFormat::None;
 									ExportDDS2(dat_manager, item, map_renderer, hash_index, compression_format);
 								}
+								else if (ImGui::MenuItem("Export texture as DDS (original blocks, no mipmaps)")) {
+									ExportOriginalBlocksDDS(dat_manager, item);
+								}
 								else if (ImGui::MenuItem("Export texture as png")) {
 
 									parse_file(dat_manager, item.id, map_renderer, hash_index);
@@ -3436,7 +3444,11 @@ void ExportDDS2(DATManager* dat_manager, DatBrowserItem& item, MapRenderer* map_
 		if (texture_data.has_value()) {
 			std::wstring filename = std::format(L"texture_0x{:X}.dds", item.hash);
 
-			if (SaveTextureToDDS(texture_data.value(), savePath, compression_format))
+			// The DAT's blocks are used as they are when they already have the requested format, and
+			// tell whether the texture is a normal map
+			const DatCompressedTexture source_blocks = dat_manager->parse_ffna_texture_blocks(item.id);
+			const bool srgb_mips = HasColorTexels(compression_format, source_blocks.texture_type);
+			if (SaveTextureToDDS(texture_data.value(), savePath, compression_format, srgb_mips, &source_blocks))
 			{
 				// Success
 			}
@@ -3448,6 +3460,17 @@ void ExportDDS2(DATManager* dat_manager, DatBrowserItem& item, MapRenderer* map_
 	}
 }
 
+// Saves the BC blocks stored in the DAT without decoding the texture, so the file has exactly the game's texels
+void ExportOriginalBlocksDDS(DATManager* dat_manager, const DatBrowserItem& item)
+{
+	std::wstring savePath = OpenFileDialog(std::format(L"texture_0x{:X}", item.hash), L"dds");
+	if (!savePath.empty())
+	{
+		const auto texture = dat_manager->parse_ffna_texture_blocks(item.id);
+		SaveCompressedTextureToDDS(texture, savePath);
+	}
+}
+
 void ExportDDS(DATManager* dat_manager, int mft_file_index, int file_id, MapRenderer* map_renderer, std::unordered_map<int, std::vector<int>>& hash_index, const CompressionFormat& compression_format)
 {
 	std::wstring saveDir = OpenDirectoryDialog();
@@ -3473,7 +3496,17 @@ void ExportDDS(DATManager* dat_manager, int mft_file_index, int file_id, MapRend
 				// Append the filename to the saveDir
 				std::wstring savePath = saveDir + L"\\" + filename;
 
-				if (SaveTextureToDDS(texture_data.value(), savePath, compression_format))
+				// The DAT's blocks are used as they are when they already have the requested format, and
+				// tell whether the texture is a normal map
+				DatCompressedTexture source_blocks;
+				const auto mft_entry_it = hash_index.find(decoded_filename);
+				if (mft_entry_it != hash_index.end())
+				{
+					source_blocks = dat_manager->parse_ffna_texture_blocks(mft_entry_it->second.at(0));
+				}
+				const bool srgb_mips = HasColorTexels(compression_format, source_blocks.texture_type);
+
+				if (SaveTextureToDDS(texture_data.value(), savePath, compression_format, srgb_mips, &source_blocks))
 				{
 					// Success
 				}
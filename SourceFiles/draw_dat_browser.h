@@ -42,7 +42,7 @@ struct DatBrowserItem
 
 	uint32_t murmurhash3;
 
-	std::vector<uint32_t> chunk_ids;  // Chunk IDs found in FFNA files
+	std::span<const uint32_t> chunk_ids;  // Chunk IDs found in FFNA files, owned by the DATManager
 
 	static const ImGuiTableSortSpecs* s_current_sort_specs;
 
@@ -64,6 +64,7 @@ void draw_data_browser(DATManager* dat_manager, MapRenderer* map_renderer, bool
 	std::vector<std::vector<std::string>>& csv_data, bool custom_file_info_changed);
 
 void ExportDDS2(DATManager* dat_manager, DatBrowserItem& item, MapRenderer* map_renderer, std::unordered_map<int, std::vector<int>>& hash_index, const CompressionFormat& compression_format);
+void ExportOriginalBlocksDDS(DATManager* dat_manager, const DatBrowserItem& item);
 
 void ExportDDS(DATManager* dat_manager, int mft_file_index, int file_id, MapRenderer* map_renderer, std::unordered_map<int, std::vector<int>>& hash_index, const CompressionFormat& compression_format);
 
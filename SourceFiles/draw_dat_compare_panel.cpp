@@ -18,6 +18,7 @@ void add_dat_manager(const std::wstring& filepath, std::map<int, std::unique_ptr
 {
 	if (dat_managers.find(filepath_to_alias[filepath]) == dat_managers.end()) {
 		auto new_dat_manager = std::make_unique<DATManager>();
+		new_dat_manager->set_quick_type_scan(GuiGlobalConstants::quick_type_scan);
 		if (new_dat_manager->Init(filepath)) {
 			dat_managers[filepath_to_alias[filepath]] = std::move(new_dat_manager);
 		}
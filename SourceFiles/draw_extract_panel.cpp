@@ -9,6 +9,80 @@
 
 constexpr int max_pixel_per_tile_dir = 16384;
 
+// "Extract selected file types" running on the shared task pool, one task per DatReadRange
+struct FileExtractionJob
+{
+	explicit FileExtractionJob(const std::vector<MFTEntry>& mft)
+		: scheduler(mft)
+	{
+	}
+
+	DatReadScheduler scheduler;
+	std::map<int, bool> selected_types;
+	std::wstring save_dir;
+	bool save_to_subfolders = false;
+	bool use_mp3_extension = false;
+	bool use_txt_extension = false;
+	bool use_dds_extension = false;
+
+	// Declared last so it waits for the tasks before anything they use is destroyed
+	TaskGroup tasks;
+
+	bool is_selected(const MFTEntry& entry) const
+	{
+		const auto it = selected_types.find(entry.type);
+		return it != selected_types.end() && it->second;
+	}
+
+	std::filesystem::path get_output_path(const MFTEntry& entry, int i) const
+	{
+		std::wstring subfolder = L"";
+		if (save_to_subfolders) {
+			subfolder = typeToWString(entry.type);
+		}
+
+		std::wstring extension = L".gwraw";
+		if (use_mp3_extension && (entry.type == AMP || entry.type == SOUND)) {
+			extension = L".mp3";
+		}
+		else if (use_txt_extension && (entry.type == TEXT)) {
+			extension = L".txt";
+		}
+		else if (use_dds_extension && (entry.type == DDS)) {
+			extension = L".dds";
+		}
+
+		const auto filename = std::format(L"{}_{}_{}_{}{}", i, entry.Hash, entry.murmurhash3, typeToWString(entry.type), extension);
+		return std::filesystem::path(save_dir) / subfolder / filename;
+	}
+
+	void extract_range(DATManager* dat_manager, const DatReadRange& range)
+	{
+		const auto& mft = dat_manager->get_MFT();
+		HANDLE file_handle = dat_manager->open_read_handle();
+		dat_manager->for_each_file_in_range(scheduler, range, file_handle,
+			[&](int i) {
+				return !tasks.is_cancelled() && is_selected(mft[i]) && !std::filesystem::exists(get_output_path(mft[i], i));
+			},
+			[&](int i, std::span<const uint8_t> data) {
+				if (data.empty()) {
+					return;
+				}
+
+				const auto path = get_output_path(mft[i], i);
+				std::filesystem::create_directories(path.parent_path());
+				DATManager::save_raw_data_to_file(data, path);
+			});
+
+		if (file_handle) {
+			CloseHandle(file_handle);
+		}
+
+		const auto indices = scheduler.indices(range);
+		tasks.add_completed(std::count_if(indices.begin(), indices.end(), [&](int i) { return is_selected(mft[i]); }));
+	}
+};
+
 void draw_extract_panel(ExtractPanelInfo& extract_panel_info, DATManager* dat_manager)
 {
 	if (GuiGlobalConstants::is_extract_panel_open) {
@@ -113,41 +187,39 @@ void draw_extract_panel(ExtractPanelInfo& extract_panel_info, DATManager* dat_ma
 
 				ImGui::Text(num_files_to_extract_ui_str.c_str());
 
-				if (ImGui::Button("Extract selected file types")) {
+				// Runs in the background, the panel only shows its progress
+				static std::unique_ptr<FileExtractionJob> file_extraction;
+				if (file_extraction && file_extraction->tasks.is_done()) {
+					file_extraction.reset();
+				}
+
+				if (file_extraction) {
+					ImGui::Text("Extracting: %zu / %zu", file_extraction->tasks.get_completed(), file_extraction->tasks.get_total());
+					ImGui::SameLine();
+					ImGui::BeginDisabled(file_extraction->tasks.is_cancelled());
+					if (ImGui::Button("Cancel##extract_files")) {
+						file_extraction->tasks.cancel();
+					}
+					ImGui::EndDisabled();
+				}
+				else if (ImGui::Button("Extract selected file types")) {
 					std::wstring saveDir = OpenDirectoryDialog();
 					if (!saveDir.empty()) {
-						const auto num_threads = std::thread::hardware_concurrency();
-						std::vector<std::jthread> threads(num_threads);
-
-						for (std::size_t t = 0; t < num_threads; ++t) {
-							threads[t] = std::jthread([&, t]() {
-								for (std::size_t i = t; i < mft.size(); i += num_threads) {
-									const auto& entry = mft[i];
-									if (fileTypeSelections[entry.type]) {
-										std::wstring subfolder = L"";
-										if (saveToSubfolders) {
-											subfolder = typeToWString(entry.type);
-											std::filesystem::create_directories(std::filesystem::path(saveDir) / subfolder);
-										}
-
-										std::wstring extension = L".gwraw";
-										if (useMP3Extension && (entry.type == AMP || entry.type == SOUND)) {
-											extension = L".mp3";
-										}
-										else if (useTxtExtension && (entry.type == TEXT)) {
-											extension = L".txt";
-										}
-										else if (useDdsExtension && (entry.type == DDS)) {
-											extension = L".dds";
-										}
-
-										const auto filename = std::format(L"{}_{}_{}_{}{}", i, entry.Hash, entry.murmurhash3, typeToWString(entry.type), extension);
-										if (!std::filesystem::exists(std::filesystem::path(saveDir) / subfolder / filename)) {
-											dat_manager->save_raw_decompressed_data_to_file(i, std::filesystem::path(saveDir) / subfolder / filename);
-										}
-									}
-								}
-								});
+						// Tasks take neighbouring files in the order they are stored in the DAT
+						file_extraction = std::make_unique<FileExtractionJob>(mft);
+						file_extraction->selected_types = fileTypeSelections;
+						file_extraction->save_dir = saveDir;
+						file_extraction->save_to_subfolders = saveToSubfolders;
+						file_extraction->use_mp3_extension = useMP3Extension;
+						file_extraction->use_txt_extension = useTxtExtension;
+						file_extraction->use_dds_extension = useDdsExtension;
+						file_extraction->tasks.add_total(std::count_if(mft.begin(), mft.end(),
+							[](const MFTEntry& entry) { return file_extraction->is_selected(entry); }));
+
+						FileExtractionJob* job = file_extraction.get();
+						DatReadRange range;
+						while (job->scheduler.next_range(range)) {
+							job->tasks.run([job, dat_manager, range] { job->extract_range(dat_manager, range); });
 						}
 					}
 				}
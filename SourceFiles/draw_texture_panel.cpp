@@ -75,7 +75,8 @@ void draw_texture_panel(MapRenderer* map_renderer)
                     std::wstring savePath = OpenFileDialog(std::format(L"texture_{}", selected_dat_texture.file_id), L"dds");
 
                     const auto compression_format = CompressionFormat::BC1;
-                    TexPanelExportDDS(texture_data, savePath, compression_format);
+                    TexPanelExportDDS(texture_data, savePath, compression_format,
+                        HasColorTexels(compression_format, selected_dat_texture.dat_texture.texture_type));
                 }
             }
             ImGui::SameLine();
@@ -85,7 +86,8 @@ void draw_texture_panel(MapRenderer* map_renderer)
                     std::wstring savePath = OpenFileDialog(std::format(L"texture_{}", selected_dat_texture.file_id), L"dds");
 
                     const auto compression_format = CompressionFormat::BC3;
-                    TexPanelExportDDS(texture_data, savePath, compression_format);
+                    TexPanelExportDDS(texture_data, savePath, compression_format,
+                        HasColorTexels(compression_format, selected_dat_texture.dat_texture.texture_type));
                 }
             }
             ImGui::SameLine();
@@ -95,7 +97,8 @@ void draw_texture_panel(MapRenderer* map_renderer)
                     std::wstring savePath = OpenFileDialog(std::format(L"texture_{}", selected_dat_texture.file_id), L"dds");
 
                     const auto compression_format = CompressionFormat::BC5;
-                    TexPanelExportDDS(texture_data, savePath, compression_format);
+                    TexPanelExportDDS(texture_data, savePath, compression_format,
+                        HasColorTexels(compression_format, selected_dat_texture.dat_texture.texture_type));
                 }
             }
             ImGui::SameLine();
@@ -105,7 +108,8 @@ void draw_texture_panel(MapRenderer* map_renderer)
                     std::wstring savePath = OpenFileDialog(std::format(L"texture_{}", selected_dat_texture.file_id), L"dds");
 
                     const auto compression_format = CompressionFormat::None;
-                    TexPanelExportDDS(texture_data, savePath, compression_format);
+                    TexPanelExportDDS(texture_data, savePath, compression_format,
+                        HasColorTexels(compression_format, selected_dat_texture.dat_texture.texture_type));
                 }
             }
         }
@@ -218,9 +222,9 @@ void draw_texture_panel(MapRenderer* map_renderer)
     ImGui::End();
 }
 
-void TexPanelExportDDS(const std::optional<TextureData>& texture_data, std::wstring& savePath, const CompressionFormat compression_format)
+void TexPanelExportDDS(const std::optional<TextureData>& texture_data, std::wstring& savePath, const CompressionFormat compression_format, bool srgb_mips)
 {
-    if (SaveTextureToDDS(texture_data.value(), savePath, compression_format))
+    if (SaveTextureToDDS(texture_data.value(), savePath, compression_format, srgb_mips))
     {
         // Success
     }
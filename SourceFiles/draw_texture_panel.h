@@ -4,7 +4,7 @@
 
 void draw_texture_panel(MapRenderer* map_renderer);
 
-void TexPanelExportDDS(const std::optional<TextureData>& texture_data, std::wstring& savePath, const CompressionFormat compression_format);
+void TexPanelExportDDS(const std::optional<TextureData>& texture_data, std::wstring& savePath, const CompressionFormat compression_format, bool srgb_mips);
 
 // Storage for inline texture GPU resources (inventory icons, created when an "other" model is loaded)
 struct InlineTextureDisplay
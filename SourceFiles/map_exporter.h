@@ -174,24 +174,27 @@ public:
 
 private:
     static bool generate_gwmb_map(const std::wstring& save_directory, gwmb_map& map, int map_mft_index, DATManager* dat_manager, std::unordered_map<int, std::vector<int>>& hash_index, TextureManager* texture_manager, int map_filehash) {
-        auto map_file = dat_manager->parse_ffna_map_file(map_mft_index);
+        // Only the terrain, map info and prop chunks are exported, the others are never decoded.
+        // The terrain is read in place, see Chunk8View.
+        auto map_file = dat_manager->parse_ffna_map_file_view(map_mft_index);
 
         map.filehash = map_filehash;
 
-        if (map_file.terrain_chunk.terrain_heightmap.size() > 0 &&
-            map_file.terrain_chunk.terrain_heightmap.size() ==
-            map_file.terrain_chunk.terrain_x_dims *
-            map_file.terrain_chunk.terrain_y_dims)
+        const Chunk8View terrain_chunk = map_file.terrain_chunk_view();
+        if (terrain_chunk.terrain_heightmap.size() > 0 &&
+            terrain_chunk.terrain_heightmap.size() ==
+            terrain_chunk.terrain_x_dims *
+            terrain_chunk.terrain_y_dims)
         {
             // First add terrain textures
             gwmb_terrain new_terrain;
-            const auto& terrain_texture_filenames = map_file.terrain_texture_filenames.array;
+            const auto& terrain_texture_filenames = map_file.terrain_texture_filenames().array;
             std::vector<DatTexture> terrain_dat_textures;
             for (int i = 0; i < terrain_texture_filenames.size(); i++)
             {
                 auto decoded_filename =
-                    decode_filename(map_file.terrain_texture_filenames.array[i].filename.id0,
-                        map_file.terrain_texture_filenames.array[i].filename.id1);
+                    decode_filename(map_file.terrain_texture_filenames().array[i].filename.id0,
+                        map_file.terrain_texture_filenames().array[i].filename.id1);
 
                 // Jade Quarry, Island of Jade. Each on them uses a normal map as their first texture.
                 if (decoded_filename == 0x25e09 || decoded_filename == 0x00028615)
@@ -204,11 +207,6 @@ private:
                 {
                     const DatTexture dat_texture =
                         dat_manager->parse_ffna_texture_file(mft_entry_it->second.at(0));
-                    int texture_id = -1;
-                    auto HR = texture_manager->CreateTextureFromRGBA(dat_texture.width,
-                        dat_texture.height, dat_texture.rgba_data.data(), &texture_id,
-                        decoded_filename);
-
                     if (dat_texture.width > 0 && dat_texture.height > 0) {
                         gwmb_texture gwmb_texture_i;
                         gwmb_texture_i.file_hash = decoded_filename;
@@ -216,12 +214,9 @@ private:
                         gwmb_texture_i.width = dat_texture.width;
                         gwmb_texture_i.texture_type = dat_texture.texture_type;
 
-                        ID3D11ShaderResourceView* texture = texture_manager->GetTexture(texture_id);
-
                         std::wstring texture_save_path = save_directory + L"\\" + std::to_wstring(gwmb_texture_i.file_hash) + L".png";
-                        std::wstring texture_save_pathw = std::wstring(texture_save_path.begin(), texture_save_path.end());
 
-                        if (!SaveTextureToPng(texture, texture_save_pathw, texture_manager))
+                        if (!SaveTextureToPng(dat_texture, texture_save_path))
                         {
                             throw "Unable to save texture to png while creating terrain texture";
                         }
@@ -242,47 +237,24 @@ private:
             terrain_dat_textures.insert(terrain_dat_textures.begin(), neutral_texture);
 
             // Save terrain textures in texture atlas
-            int terrain_tex_atlas_tex_id = -1;
             const auto terrain_tex_atlas = texture_manager->BuildTextureAtlas(terrain_dat_textures, 8, 8);
 
-            if (terrain_tex_atlas.width > 0 && terrain_tex_atlas.height > 0)
+            if (terrain_tex_atlas.width <= 0 || terrain_tex_atlas.height <= 0)
             {
-                texture_manager->CreateTextureFromRGBA(
-                    terrain_tex_atlas.width,
-                    terrain_tex_atlas.height,
-                    terrain_tex_atlas.rgba_data.data(), 
-                    &terrain_tex_atlas_tex_id,
-                    -1);
-            }
-            else {
                 throw "terrain texture atlas could not be created";
             }
 
-            ID3D11ShaderResourceView* texture =
-                texture_manager->GetTexture(terrain_tex_atlas_tex_id);
-
             std::wstring texture_save_path = save_directory + L"\\" + L"atlas_" + std::to_wstring(map_filehash) + L".png";
-            std::wstring texture_save_pathw = std::wstring(texture_save_path.begin(), texture_save_path.end());
 
-            if (!SaveTextureToPng(texture, texture_save_pathw, texture_manager))
+            if (!SaveTextureToPng(terrain_tex_atlas, texture_save_path))
             {
                 throw "Unable to save texture to png while terrain texture atlas";
             }
 
 
-            // Now add the terrain mesh
-            auto& terrain_texture_indices =
-                map_file.terrain_chunk.terrain_texture_indices_maybe;
-
-            auto& terrain_shadow_map =
-                map_file.terrain_chunk.terrain_shadow_map;
-
-            // Create terrain
-            const auto terrain = std::make_unique<Terrain>(map_file.terrain_chunk.terrain_x_dims,
-                map_file.terrain_chunk.terrain_y_dims,
-                map_file.terrain_chunk.terrain_heightmap,
-                terrain_texture_indices, terrain_shadow_map,
-                map_file.map_info_chunk.map_bounds);
+            // Now add the terrain mesh, built straight from the file data without copying the arrays
+            const auto terrain = std::make_unique<Terrain>(terrain_chunk,
+                map_file.map_info_chunk().map_bounds);
 
             map.min_x = terrain->m_bounds.map_min_x;
             map.max_x = terrain->m_bounds.map_max_x;
@@ -291,10 +263,11 @@ private:
             map.min_z = terrain->m_bounds.map_min_z;
             map.max_z = terrain->m_bounds.map_max_z;
 
-            const auto terrain_mesh = terrain->get_mesh();
-            new_terrain.vertices.resize(terrain_mesh->vertices.size());
-            for (int i = 0; i < terrain_mesh->vertices.size(); i++) {
-                const auto& vertex = terrain_mesh->vertices[i];
+            // The rendered mesh shares vertices between quads, the export keeps 4 per quad with their UVs
+            const Mesh terrain_mesh = terrain->GenerateUnsharedTerrainMesh();
+            new_terrain.vertices.resize(terrain_mesh.vertices.size());
+            for (int i = 0; i < terrain_mesh.vertices.size(); i++) {
+                const auto& vertex = terrain_mesh.vertices[i];
 
                 gwmb_map_vertex new_gwmb_map_vertex;
                 new_gwmb_map_vertex.pos = { vertex.position.x, vertex.position.y, vertex.position.z };
@@ -309,19 +282,19 @@ private:
                 new_terrain.vertices[i] = new_gwmb_map_vertex;
             }
 
-            new_terrain.indices.resize(terrain->get_mesh()->indices.size());
-            for (int i = 0; i < terrain_mesh->indices.size(); i++) {
-                const auto index = terrain_mesh->indices[i];
+            new_terrain.indices.resize(terrain_mesh.indices.size());
+            for (int i = 0; i < terrain_mesh.indices.size(); i++) {
+                const auto index = terrain_mesh.indices[i];
                 new_terrain.indices[i] = index;
             }
 
             // Now export all the models into their own separate JSON files.
             std::vector<int> model_hashes;
-            for (int i = 0; i < map_file.prop_filenames_chunk.array.size(); i++)
+            for (int i = 0; i < map_file.prop_filenames_chunk().array.size(); i++)
             {
                 auto decoded_filename =
-                    decode_filename(map_file.prop_filenames_chunk.array[i].filename.id0,
-                        map_file.prop_filenames_chunk.array[i].filename.id1);
+                    decode_filename(map_file.prop_filenames_chunk().array[i].filename.id0,
+                        map_file.prop_filenames_chunk().array[i].filename.id1);
                 auto mft_entry_it = hash_index.find(decoded_filename);
                 if (mft_entry_it != hash_index.end())
                 {
@@ -334,11 +307,11 @@ private:
                 }
             }
 
-            for (int i = 0; i < map_file.more_filnames_chunk.array.size(); i++)
+            for (int i = 0; i < map_file.more_filnames_chunk().array.size(); i++)
             {
                 auto decoded_filename =
-                    decode_filename(map_file.more_filnames_chunk.array[i].filename.id0,
-                        map_file.more_filnames_chunk.array[i].filename.id1);
+                    decode_filename(map_file.more_filnames_chunk().array[i].filename.id0,
+                        map_file.more_filnames_chunk().array[i].filename.id1);
                 auto mft_entry_it = hash_index.find(decoded_filename);
                 if (mft_entry_it != hash_index.end())
                 {
@@ -352,9 +325,9 @@ private:
             }
 
             // Finally add the model transform info to the map
-            for (int i = 0; i < map_file.props_info_chunk.prop_array.props_info.size(); i++)
+            for (int i = 0; i < map_file.props_info_chunk().prop_array.props_info.size(); i++)
             {
-                PropInfo prop_info = map_file.props_info_chunk.prop_array.props_info[i];
+                PropInfo prop_info = map_file.props_info_chunk().prop_array.props_info[i];
                 const int model_filename_index = prop_info.filename_index;
                 const int model_hash = model_hashes[model_filename_index];
 
@@ -316,23 +316,15 @@ private:
                 if (!entry)
                     return false;
 
-                int texture_id = -1;
-                DatTexture dat_texture;
+                DatTexture dat_texture{};
                 if (entry->type == DDS)
                 {
                     const auto ddsData = dat_manager->parse_dds_file(file_index);
-                    size_t ddsDataSize = ddsData.size();
-                    const auto hr = texture_manager->
-                        CreateTextureFromDDSInMemory(ddsData.data(), ddsDataSize, &texture_id, &dat_texture.width,
-                            &dat_texture.height, dat_texture.rgba_data, entry->Hash);
-                    dat_texture.texture_type = DDSt;
+                    DecodeDDSTexture(ddsData.data(), ddsData.size(), dat_texture);
                 }
                 else
                 {
                     dat_texture = dat_manager->parse_ffna_texture_file(file_index);
-                    auto HR = texture_manager->CreateTextureFromRGBA(dat_texture.width,
-                        dat_texture.height, dat_texture.rgba_data.data(), &texture_id,
-                        decoded_filename);
                 }
 
                 gwmb_texture gwmb_texture_i;
@@ -341,12 +333,10 @@ private:
                 gwmb_texture_i.width = dat_texture.width;
                 gwmb_texture_i.texture_type = dat_texture.texture_type;
 
-                ID3D11ShaderResourceView* texture =
-                    texture_manager->GetTexture(texture_id);
-
                 std::wstring texture_save_path = save_dir + L"\\" + std::to_wstring(gwmb_texture_i.file_hash) + L".png";
 
-                if (!SaveTextureToPng(texture, texture_save_path, texture_manager))
+                // Encoded on the CPU, the export doesn't need the GPU for textures
+                if (!SaveTextureToPng(dat_texture, texture_save_path))
                 {
                     throw "Unable to save texture to png while exporting model";
                 }
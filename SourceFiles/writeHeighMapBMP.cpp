@@ -3,22 +3,19 @@
 #include "stb_image_write.h""
 #include "tinytiff/tinytiffwriter.h"
 
-bool write_heightmap_png(const std::vector<std::vector<float>>& heightmap, const char* filename)
+bool write_heightmap_png(const Grid2D<float>& heightmap, const char* filename)
 {
-	int width = heightmap[0].size();
-	int height = heightmap.size();
+	int width = heightmap.width();
+	int height = heightmap.height();
 	std::vector<unsigned char> pixels(width * height);
 
 	// Find min and max values in heightmap
 	float min = FLT_MAX;
 	float max = FLT_MIN;
-	for (const auto& row : heightmap)
+	for (float value : heightmap.cells())
 	{
-		for (float value : row)
-		{
-			if (value < min) min = value;
-			if (value > max) max = value;
-		}
+		if (value < min) min = value;
+		if (value > max) max = value;
 	}
 
 	// Scale float values to 8-bit
@@ -40,9 +37,9 @@ bool write_heightmap_png(const std::vector<std::vector<float>>& heightmap, const
 	return true;
 }
 
-bool write_heightmap_tiff(const std::vector<std::vector<float>>& heightmap, const char* filename) {
-	int width = heightmap[0].size();
-	int height = heightmap.size();
+bool write_heightmap_tiff(const Grid2D<float>& heightmap, const char* filename) {
+	int width = heightmap.width();
+	int height = heightmap.height();
 
 	// Create a TIFF file with 32-bit depth, 1 sample per pixel (grayscale), and float format
 	TinyTIFFWriterFile* tif = TinyTIFFWriter_open(filename, 32, TinyTIFFWriter_Float, 1, width, height,
@@ -53,11 +50,9 @@ bool write_heightmap_tiff(const std::vector<std::vector<float>>& heightmap, cons
 
 	float min = FLT_MAX;
 	float max = FLT_MIN;
-	for (const auto& row : heightmap) {
-		for (float value : row) {
-			if (value < min) min = value;
-			if (value > max) max = value;
-		}
+	for (float value : heightmap.cells()) {
+		if (value < min) min = value;
+		if (value > max) max = value;
 	}
 
 	std::vector<float> scaledData(width * height);
@@ -76,9 +71,9 @@ bool write_heightmap_tiff(const std::vector<std::vector<float>>& heightmap, cons
 	return true;
 }
 
-bool write_terrain_ints_tiff(const std::vector<std::vector<uint32_t>>& terrain_indices, const char* filename) {
-	int width = terrain_indices[0].size();
-	int height = terrain_indices.size();
+bool write_terrain_ints_tiff(const Grid2D<uint8_t>& terrain_indices, const char* filename) {
+	int width = terrain_indices.width();
+	int height = terrain_indices.height();
 
 	// Create a TIFF file with 8-bit depth, 1 sample per pixel (grayscale), and unsigned int format
 	TinyTIFFWriterFile* tif = TinyTIFFWriter_open(filename, 8, TinyTIFFWriter_UInt, 1, width, height,
@@ -87,15 +82,8 @@ bool write_terrain_ints_tiff(const std::vector<std::vector<uint32_t>>& terrain_i
 		return false; // Error opening TIFF file
 	}
 
-	std::vector<uint8_t> imageData(width * height);
-	for (int y = 0; y < height; y++) {
-		for (int x = 0; x < width; x++) {
-			imageData[y * width + x] = static_cast<uint8_t>(terrain_indices[y][x]); // Copy value as 8-bit and flip y-axis
-		}
-	}
-
-	// Write the entire image to TIFF
-	TinyTIFFWriter_writeImage(tif, imageData.data());
+	// The grid is already 8 bit and row-major, written as it is
+	TinyTIFFWriter_writeImage(tif, terrain_indices.data());
 
 	// Close the TIFF file
 	TinyTIFFWriter_close(tif);
@@ -1,7 +1,7 @@
 #pragma once
 #define STB_IMAGE_WRITE_IMPLEMENTATION
-#include <vector>
+#include "Grid2D.h"
 
-bool write_heightmap_png(const std::vector<std::vector<float>>& heightmap, const char* filename);
-bool write_heightmap_tiff(const std::vector<std::vector<float>>& heightmap, const char* filename);
-bool write_terrain_ints_tiff(const std::vector<std::vector<uint32_t>>& terrain_indices, const char* filename);
+bool write_heightmap_png(const Grid2D<float>& heightmap, const char* filename);
+bool write_heightmap_tiff(const Grid2D<float>& heightmap, const char* filename);
+bool write_terrain_ints_tiff(const Grid2D<uint8_t>& terrain_indices, const char* filename);
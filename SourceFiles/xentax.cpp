@@ -1,5 +1,8 @@
 #include "pch.h"
+#include "xentax.h"
 #include <memory.h>
+#include <climits>
+#include <functional>
 
 unsigned char TableData1[112] = {
   0x00, 0x00, 0x00, 0xA0, 0x02, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x60, 0x06, 0x00, 0x00, 0x00,
@@ -97,18 +100,246 @@ struct HuffmanData
     unsigned int Var1, Var2;
 };
 
+// Table driven decoding. A code of up to FastLookupBits bits, and a second literal if it fits as
+// well, is resolved with a single lookup on the top bits of a 64-bit bit buffer.
+constexpr int FastLookupBits = 11;
+constexpr int FastLookupSize = 1 << FastLookupBits;
+// Building the tables costs about as much as decoding a few thousand symbols the old way
+constexpr int FastDecodeMinOutput = 0x1000;
+
+struct FastHuffmanEntry
+{
+    unsigned short Symbol;
+    unsigned char Length;
+    unsigned char Flags;
+    unsigned char Symbol2;
+    unsigned char PairLength;
+};
+
+enum FastHuffmanFlags : unsigned char
+{
+    FastEntrySlow = 1, // Code is longer than FastLookupBits, use LookupSymbol
+    FastEntryPair = 2, // Two literals, Symbol and Symbol2, in PairLength bits
+};
+
+// The lookup DecompressFile does inline. Bits holds the next 32 bits of the stream.
+static bool LookupSymbol(const HuffmanData& HData, unsigned int Bits, unsigned int& Length, unsigned int& Symbol)
+{
+    int i = (Bits >> 0x18) * 2;
+    Length = HData.HuffmanTable[i];
+    Symbol = HData.HuffmanTable[i + 1];
+
+    if (Length == -1)
+    {
+        i = 0;
+        while (Bits < HData.HelperArray[i])
+        {
+            i += 3;
+            if (i + 2 >= 0x48)
+            {
+                return false;
+            }
+        }
+
+        Length = HData.HelperArray[i + 2];
+        if (Length == 0 || Length >= 0x20)
+        {
+            return false;
+        }
+        Symbol = HData.HelperArray[i + 1] - ((unsigned int)(Bits - HData.HelperArray[i]) >> (0x20 - Length));
+
+        if (Symbol >= HData.Var2 || ! HData.TempArray)
+        {
+            return false;
+        }
+
+        Symbol = HData.TempArray[Symbol];
+    }
+
+    return Length < 0x20;
+}
+
+static void BuildFastTable(const HuffmanData& HData, FastHuffmanEntry* Table)
+{
+    constexpr int SubPrefixes = 1 << (FastLookupBits - 8);
+
+    // Codes of up to 8 bits come straight from HuffmanTable, longer ones need the helper lookup
+    for (unsigned int i = 0; i < 0x100; i++)
+    {
+        const unsigned int Length = HData.HuffmanTable[i * 2];
+        const unsigned int Symbol = HData.HuffmanTable[i * 2 + 1];
+        for (unsigned int j = 0; j < SubPrefixes; j++)
+        {
+            FastHuffmanEntry& Entry = Table[i * SubPrefixes + j];
+            Entry = {};
+            if (Length != -1)
+            {
+                if (Symbol > 0xFFFF)
+                {
+                    Entry.Flags = FastEntrySlow;
+                    continue;
+                }
+                Entry.Symbol = (unsigned short)Symbol;
+                Entry.Length = (unsigned char)Length;
+                continue;
+            }
+
+            // Codes are canonical, so if the code fits in the prefix any bits after it give the same result
+            unsigned int LongLength, LongSymbol;
+            const unsigned int Bits = (i * SubPrefixes + j) << (0x20 - FastLookupBits);
+            if (! LookupSymbol(HData, Bits, LongLength, LongSymbol) || LongLength > FastLookupBits ||
+                LongSymbol > 0xFFFF)
+            {
+                Entry.Flags = FastEntrySlow;
+                continue;
+            }
+            Entry.Symbol = (unsigned short)LongSymbol;
+            Entry.Length = (unsigned char)LongLength;
+        }
+    }
+
+    // A code only depends on its own bits, so the rest of the prefix decides if a second literal fits
+    for (unsigned int Prefix = 0; Prefix < FastLookupSize; Prefix++)
+    {
+        FastHuffmanEntry& Entry = Table[Prefix];
+        if (Entry.Flags & FastEntrySlow || Entry.Symbol >= 0x100)
+        {
+            continue;
+        }
+
+        const FastHuffmanEntry& Next = Table[(Prefix << Entry.Length) & (FastLookupSize - 1)];
+        if (! (Next.Flags & FastEntrySlow) && Next.Symbol < 0x100 && Entry.Length + Next.Length <= FastLookupBits)
+        {
+            Entry.Flags = FastEntryPair;
+            Entry.Symbol2 = (unsigned char)Next.Symbol;
+            Entry.PairLength = (unsigned char)(Entry.Length + Next.Length);
+        }
+    }
+}
+
+// Next input bits, MSB first. Reads zeros past the end of the input like the ESIplus8 reader.
+struct FastBitReader
+{
+    unsigned long long Buffer;
+    int Count; // Valid bits at the top of Buffer, always at least 32
+    const unsigned int* Ptr;
+    const unsigned int* End;
+
+    unsigned int Peek32() const
+    {
+        return (unsigned int)(Buffer >> 0x20);
+    }
+
+    unsigned int Peek(int n) const
+    {
+        return (unsigned int)(Buffer >> (0x40 - n));
+    }
+
+    void Skip(int n)
+    {
+        Buffer <<= n;
+        Count -= n;
+        if (Count < 0x20)
+        {
+            if (Ptr != End)
+            {
+                Buffer |= (unsigned long long)Ptr[0] << (0x20 - Count);
+                Ptr++;
+            }
+            Count += 0x20;
+        }
+    }
+};
+
 class Decompress
 {
 public:
     unsigned int ESIplus8, ESIplusC, ESIplus10;
-    unsigned int *ptrInputData, *InputDataEnd;
+    const unsigned int *ptrInputData, *InputDataEnd;
+
+    // Partial decompression. MaxOutput >= 0 stops decoding after that many output bytes.
+    // If NextOutputTarget is set it is called whenever that point is reached and returns
+    // the next output size to decode up to; decoding stops once it returns a size that is
+    // not past the current position or past the end of the file.
+    int MaxOutput = -1;
+    std::function<int(const unsigned char* output, int produced)> NextOutputTarget;
+    int FullOutSize = 0;
+    bool Stopped = false;
+
+    // Decode full files with DecodeBlockFast. Off gives the original bit by bit decoder.
+    bool UseFastDecoder = true;
+
+    // Scratch storage, defaults to the context of the calling thread
+    GWDecompressContext* Context = nullptr;
+    // Decode into this instead of a new[] buffer, DecompressFile then returns its data()
+    std::vector<unsigned char>* OutputStorage = nullptr;
+
+    unsigned char* AllocOutput(int Size)
+    {
+        if (OutputStorage)
+        {
+            // Every byte gets written. resize only zero fills the bytes past the current size, so a caller that
+            // keeps the vector between files (without clearing it) pays for that only when a file is larger
+            OutputStorage->resize(Size);
+            return OutputStorage->data();
+        }
+        return new unsigned char[Size];
+    }
 
-    unsigned char* DecompressFile(unsigned int* Input, int InputSize, int& outsize)
+    void FreeOutput(unsigned char* Output)
+    {
+        if (OutputStorage)
+        {
+            OutputStorage->clear();
+        }
+        else
+        {
+            delete[] Output;
+        }
+    }
+
+    static unsigned int* AllocScratch(std::vector<unsigned int>& Storage, unsigned int Size)
+    {
+        if (Storage.size() < Size)
+        {
+            Storage.resize(Size);
+        }
+        memset(Storage.data(), 0, Size * 4);
+        return Storage.data();
+    }
+
+    bool ContinueOutput(unsigned char* Output, unsigned char* ptrOutput, unsigned char* ptrOutputEnd,
+                        unsigned char*& ptrOutputStop)
+    {
+        if (Stopped || ! NextOutputTarget)
+        {
+            Stopped = true;
+            return false;
+        }
+
+        int produced = (int)(ptrOutput - Output);
+        int target = NextOutputTarget(Output, produced);
+        if (target <= produced || target > FullOutSize || Output + target > ptrOutputEnd)
+        {
+            Stopped = true;
+            return false;
+        }
+
+        ptrOutputStop = Output + target;
+        return true;
+    }
+
+    unsigned char* DecompressFile(const unsigned int* Input, int InputSize, int& outsize)
     {
         int _counter1;
         unsigned int _data, EBPminus8, _temp;
         int EBPminus18, EBPminus1c = 0;
 
+        if (! Context)
+        {
+            Context = &GWDecompressContext::ForCurrentThread();
+        }
+
         HuffmanData HuffmanTree;
         memset(&HuffmanTree, 0, sizeof(HuffmanTree));
         HuffmanData HuffmanTree2;
@@ -134,10 +365,21 @@ public:
         //cmpdecompress part ends here
 
         outsize = Input[(InputSize >> 2) - 1];
-        unsigned char* Output = new unsigned char[outsize];
-        memset(Output, 0, outsize);
+        FullOutSize = outsize;
+        Stopped = false;
+
+        const bool IsPartial = MaxOutput >= 0 && MaxOutput < FullOutSize;
+        // A plain prefix decode only needs room for the prefix, a header walk may need everything
+        if (IsPartial && ! NextOutputTarget)
+        {
+            outsize = MaxOutput;
+        }
+
+        // Not cleared up front, a full decode writes every byte and a bad match clears what's left
+        unsigned char* Output = AllocOutput(outsize);
         unsigned char* ptrOutput = Output;
         unsigned char* ptrOutputEnd = Output + outsize;
+        unsigned char* ptrOutputStop = IsPartial ? Output + MaxOutput : ptrOutputEnd;
 
         EBPminus18 = ESIplusC >> 0x1c;
         ESIplusC = (ESIplus10 >> 0x1c) | (ESIplusC << 4);
@@ -154,22 +396,14 @@ public:
 
         do
         {
-            if (! SetupNodesandTree(HuffmanTree))
+            if (! SetupNodesandTree(HuffmanTree, Context->TreeValues[0]))
             {
-                if (HuffmanTree.TempArray)
-                {
-                    delete[] HuffmanTree.TempArray;
-                }
-                delete[] Output;
+                FreeOutput(Output);
                 return 0;
             }
-            if (! SetupNodesandTree(HuffmanTree2))
+            if (! SetupNodesandTree(HuffmanTree2, Context->TreeValues[1]))
             {
-                if (HuffmanTree2.TempArray)
-                {
-                    delete[] HuffmanTree2.TempArray;
-                }
-                delete[] Output;
+                FreeOutput(Output);
                 return 0;
             }
 
@@ -198,10 +432,28 @@ public:
 
             _counter1 = ((unsigned int)(_counter1 + 1) << 0xc) - 1;
 
+            if (UseFastDecoder && ! IsPartial && ! NextOutputTarget && FullOutSize >= FastDecodeMinOutput)
+            {
+                int result = DecodeBlockFast(HuffmanTree, HuffmanTree2, _counter1, EBPminus18, Output, ptrOutput,
+                                             ptrOutputEnd);
+                if (result == FastBlockError)
+                {
+                    FreeOutput(Output);
+                    return 0;
+                }
+                if (result == FastBlockBadMatch)
+                {
+                    memset(ptrOutput, 0, ptrOutputEnd - ptrOutput);
+                    return Output;
+                }
+                _counter1 = -1;
+            }
+
             if (_counter1 > -1)
                 do
                 {
-                    if (ptrOutput == ptrOutputEnd)
+                    if (ptrOutput >= ptrOutputStop &&
+                        ! ContinueOutput(Output, ptrOutput, ptrOutputEnd, ptrOutputStop))
                     {
                         break;
                     }
@@ -226,12 +478,13 @@ public:
                         {
                             //printf( "Error\n" );
                             //throw error
+                            FreeOutput(Output);
                             return 0;
                         }
 
                         if (! HuffmanTree.TempArray)
                         {
-                            delete[] Output;
+                            FreeOutput(Output);
                             return 0;
                         }
 
@@ -241,6 +494,7 @@ public:
                     {
                         //printf( "Error\n" );
                         //throw error
+                        FreeOutput(Output);
                         return 0;
                     }
                     if (_temp)
@@ -286,6 +540,7 @@ public:
                             {
                                 //printf( "Error\n" );
                                 //throw error
+                                FreeOutput(Output);
                                 return 0;
                             }
                             ESIplusC = (ESIplus10 >> (0x20 - _temp)) | (ESIplusC << _temp);
@@ -334,6 +589,7 @@ public:
                             {
                                 //printf( "Error\n" );
                                 //throw error
+                                FreeOutput(Output);
                                 return 0;
                             }
 
@@ -344,6 +600,7 @@ public:
                         {
                             //printf("Error\n");
                             //throw error
+                            FreeOutput(Output);
                             return 0;
                         }
 
@@ -386,6 +643,7 @@ public:
                             {
                                 //printf("Error\n");
                                 //throw error
+                                FreeOutput(Output);
                                 return 0;
                             }
 
@@ -415,17 +673,17 @@ public:
                             backtrack = _data;
                         }
 
+                        if (IsPartial && ! NextOutputTarget && ptrOutput + EBPminus1c > ptrOutputEnd &&
+                            backtrack < (int)(ptrOutput - Output))
+                        {
+                            // Only a prefix was requested, cut the last match at the end of it
+                            EBPminus1c = (int)(ptrOutputEnd - ptrOutput);
+                        }
+
                         if (ptrOutput + EBPminus1c > ptrOutputEnd || backtrack >= (int)(ptrOutput - Output))
                         {
                             //this shouldn't ever be called
-                            if (HuffmanTree2.TempArray)
-                            {
-                                delete[] HuffmanTree2.TempArray;
-                            }
-                            if (HuffmanTree.TempArray)
-                            {
-                                delete[] HuffmanTree.TempArray;
-                            }
+                            memset(ptrOutput, 0, ptrOutputEnd - ptrOutput);
                             return Output;
                         }
                         else
@@ -442,30 +700,161 @@ public:
 
                 } while (_counter1 >= 0);
 
-            if (HuffmanTree2.TempArray)
-            {
-                delete[] HuffmanTree2.TempArray;
-            }
-
             HuffmanTree2.TempArray = 0;
             HuffmanTree2.Var1 = 0;
             HuffmanTree2.Var2 = 0;
 
-            if (HuffmanTree.TempArray)
-            {
-                delete[] HuffmanTree.TempArray;
-            }
-
             HuffmanTree.TempArray = 0;
             HuffmanTree.Var1 = 0;
             HuffmanTree.Var2 = 0;
 
-        } while (ptrOutputEnd != ptrOutput);
+        } while (ptrOutput < ptrOutputStop || ContinueOutput(Output, ptrOutput, ptrOutputEnd, ptrOutputStop));
+
+        if (IsPartial)
+        {
+            outsize = (int)(ptrOutput - Output);
+        }
 
         return Output;
     }
 
-    bool SetupNodesandTree(HuffmanData& HData)
+    enum FastBlockResult
+    {
+        FastBlockDone,
+        FastBlockError,
+        FastBlockBadMatch, // DecompressFile returns what it has so far
+    };
+
+    // Same as the symbol loop in DecompressFile, for full (not partial) decompression
+    int DecodeBlockFast(const HuffmanData& Tree, const HuffmanData& Tree2, int Counter, int MatchBase,
+                        unsigned char* Output, unsigned char*& ptrOutput, unsigned char* ptrOutputEnd)
+    {
+        FastHuffmanEntry FastTable[FastLookupSize];
+        FastHuffmanEntry FastTable2[FastLookupSize];
+        BuildFastTable(Tree, FastTable);
+        BuildFastTable(Tree2, FastTable2);
+
+        FastBitReader Bits;
+        Bits.Buffer = ((unsigned long long)ESIplusC << 0x20) | ESIplus10;
+        Bits.Count = 0x20 + ESIplus8;
+        Bits.Ptr = ptrInputData;
+        Bits.End = InputDataEnd;
+
+        unsigned char* Out = ptrOutput;
+        int Result = FastBlockDone;
+
+        while (Counter >= 0)
+        {
+            if (Out >= ptrOutputEnd)
+            {
+                Stopped = true;
+                break;
+            }
+
+            const FastHuffmanEntry& Entry = FastTable[Bits.Buffer >> (0x40 - FastLookupBits)];
+            unsigned int Length, Symbol;
+            if (Entry.Flags & FastEntryPair && Counter >= 1 && ptrOutputEnd - Out >= 2)
+            {
+                Out[0] = (unsigned char)Entry.Symbol;
+                Out[1] = Entry.Symbol2;
+                Out += 2;
+                Bits.Skip(Entry.PairLength);
+                Counter -= 2;
+                continue;
+            }
+
+            if (Entry.Flags & FastEntrySlow)
+            {
+                if (! LookupSymbol(Tree, Bits.Peek32(), Length, Symbol))
+                {
+                    Result = FastBlockError;
+                    break;
+                }
+            }
+            else
+            {
+                Length = Entry.Length;
+                Symbol = Entry.Symbol;
+            }
+            Bits.Skip(Length);
+
+            if (Symbol < 0x100)
+            {
+                Out++[0] = (unsigned char)Symbol;
+                Counter--;
+                continue;
+            }
+
+            unsigned int Extra = Table4[Symbol];
+            int MatchLength = Table3[Symbol];
+            if (Extra)
+            {
+                MatchLength |= Bits.Peek(Extra);
+                Bits.Skip(Extra);
+            }
+            MatchLength = MatchBase + MatchLength + 1;
+
+            const FastHuffmanEntry& Entry2 = FastTable2[Bits.Buffer >> (0x40 - FastLookupBits)];
+            if (Entry2.Flags & FastEntrySlow)
+            {
+                if (! LookupSymbol(Tree2, Bits.Peek32(), Length, Symbol))
+                {
+                    Result = FastBlockError;
+                    break;
+                }
+            }
+            else
+            {
+                Length = Entry2.Length;
+                Symbol = Entry2.Symbol;
+            }
+            Bits.Skip(Length);
+
+            Extra = Table5[Symbol];
+            int Backtrack = Table6[Symbol];
+            if (Extra)
+            {
+                Backtrack |= Bits.Peek(Extra);
+                Bits.Skip(Extra);
+            }
+
+            if (MatchLength > ptrOutputEnd - Out || Backtrack >= (int)(Out - Output))
+            {
+                Result = FastBlockBadMatch;
+                break;
+            }
+
+            const unsigned char* Source = Out - Backtrack - 1;
+            if (Backtrack + 1 >= MatchLength)
+            {
+                memcpy(Out, Source, MatchLength);
+                Out += MatchLength;
+            }
+            else if (Backtrack == 0)
+            {
+                memset(Out, Source[0], MatchLength);
+                Out += MatchLength;
+            }
+            else
+            {
+                for (int x = 0; x < MatchLength; x++)
+                {
+                    Out++[0] = Source[x];
+                }
+            }
+            Counter--;
+        }
+
+        ptrOutput = Out;
+        ESIplusC = (unsigned int)(Bits.Buffer >> 0x20);
+        ESIplus10 = (unsigned int)Bits.Buffer;
+        ESIplus8 = Bits.Count - 0x20;
+        ptrInputData = Bits.Ptr;
+        return Result;
+    }
+
+    // Values is the storage HData.TempArray points into, it stays in use until the block is decoded
+    bool SetupNodesandTree(HuffmanData& HData, std::vector<unsigned int>& Values)
     {
         unsigned int EBPminus128[0x40];
         unsigned int *EBPminus20, *EBPminus18, EBPminus10, EBPminus8, EBPminus14;
@@ -500,8 +889,7 @@ public:
             ESIplus10 = ESIplus10 << 0x10;
         }
 
-        EBPminus20 = new unsigned int[EBPminus14];
-        memset(EBPminus20, 0, EBPminus14 * 4);
+        EBPminus20 = AllocScratch(Context->Nodes, EBPminus14);
         EBPminus1C = 0;
 
         memset(EBPminus128, 0, 0x80);
@@ -529,7 +917,6 @@ public:
                 {
                     //printf( "Error\n" );
                     //throw error
-                    delete[] EBPminus20;
                     return false;
                 }
                 if (j)
@@ -564,14 +951,12 @@ public:
                 {
                     //printf( "Error\n" );
                     //throw error
-                    delete[] EBPminus20;
                     return false;
                 }
 
                 if ((unsigned)j > EBPminus8)
                 {
                     //this returns
-                    delete[] EBPminus20;
                     return true;
                 }
 
@@ -588,7 +973,6 @@ public:
                         {
                             //printf( "Error\n" );
                             //throw error
-                            delete[] EBPminus20;
                             return false;
                         }
 
@@ -637,7 +1021,6 @@ public:
                     if ((unsigned)EBPminus8 >= EBPminus10 || (unsigned)v >= EBPminus14)
                     {
                         //return here too
-                        delete[] EBPminus20;
                         return true;
                     }
 
@@ -651,7 +1034,6 @@ public:
                             {
                                 //printf( "Error\n" );
                                 //throw error
-                                delete[] EBPminus20;
                                 return false;
                             }
                             HData.HuffmanTable[(EBPminus28 | i) * 2] = arg_0;
@@ -676,7 +1058,6 @@ public:
         {
             //printf( "Error\n" );
             // throw error
-            delete[] EBPminus20;
             return false;
         }
 
@@ -690,12 +1071,7 @@ public:
 
             if (HData.Var1 != EBPminus10)
             {
-                if (HData.TempArray)
-                {
-                    delete[] HData.TempArray;
-                }
-                HData.TempArray = new unsigned int[EBPminus10];
-                memset(HData.TempArray, 0, EBPminus10 * 4);
+                HData.TempArray = AllocScratch(Values, EBPminus10);
                 HData.Var1 = EBPminus10;
             }
             if (HData.Var2 < EBPminus10)
@@ -722,7 +1098,6 @@ public:
                                 {
                                     //Wrapperx
                                     //return here too
-                                    delete[] EBPminus20;
                                     return true;
                                 }
                                 HData.HuffmanTable[(EBPminus8 >> (arg_0 - 8)) * 2] = -1;
@@ -730,7 +1105,6 @@ public:
                                 {
                                     //printf( "Error\n" );
                                     //throw error
-                                    delete[] EBPminus20;
                                     return false;
                                 }
                                 HData.TempArray[v] = e;
@@ -750,17 +1124,82 @@ public:
                     arg_0++;
                     EBPminus8 += EBPminus8 + 1;
                 } while (arg_0 <= 0x1f);
-                delete[] EBPminus20;
                 return true;
             }
         }
-        delete[] EBPminus20;
         return true;
     }
 };
 
-void UnpackGWDat(unsigned char* input, int insize, unsigned char*& output, int& outsize)
+void UnpackGWDat(const unsigned char* input, int insize, unsigned char*& output, int& outsize)
 {
     Decompress d;
-    output = d.DecompressFile((unsigned int*)input, insize, outsize);
+    output = d.DecompressFile((const unsigned int*)input, insize, outsize);
+}
+
+bool UnpackGWDat(const unsigned char* input, int insize, std::vector<unsigned char>& output)
+{
+    Decompress d;
+    d.OutputStorage = &output;
+    int outsize = 0;
+    // An empty vector may have no data(), every failure happens after the size is known
+    return d.DecompressFile((const unsigned int*)input, insize, outsize) || outsize == 0;
+}
+
+GWDecompressContext& GWDecompressContext::ForCurrentThread()
+{
+    thread_local GWDecompressContext context;
+    return context;
+}
+
+void UnpackGWDatReference(const unsigned char* input, int insize, unsigned char*& output, int& outsize)
+{
+    Decompress d;
+    d.UseFastDecoder = false;
+    output = d.DecompressFile((const unsigned int*)input, insize, outsize);
+}
+
+void UnpackGWDatPrefix(const unsigned char* input, int insize, int max_output, unsigned char*& output,
+                       int& outsize, int& full_outsize)
+{
+    Decompress d;
+    d.MaxOutput = std::max(max_output, 0);
+    output = d.DecompressFile((const unsigned int*)input, insize, outsize);
+    full_outsize = d.FullOutSize;
+}
+
+bool UnpackGWDatFFNAChunkHeaders(const unsigned char* input, int insize, std::vector<uint32_t>& chunk_ids,
+                                 int& full_outsize)
+{
+    chunk_ids.clear();
+
+    // The bitstream has to be decoded in order and matches may reference payload bytes, so payloads
+    // can't be skipped. What we can skip is everything after the last chunk header.
+    int64_t next_header = 5; // Skip FFNA header (4 bytes 'ffna' + 1 byte type)
+
+    Decompress d;
+    d.MaxOutput = (int)next_header + 8;
+    d.NextOutputTarget = [&](const unsigned char* output, int produced)
+    {
+        while (next_header + 8 <= produced)
+        {
+            uint32_t chunk_id = *reinterpret_cast<const uint32_t*>(&output[next_header]);
+            uint32_t chunk_size = *reinterpret_cast<const uint32_t*>(&output[next_header + 4]);
+            chunk_ids.push_back(chunk_id);
+            next_header += 8 + (int64_t)chunk_size;
+        }
+
+        return (int)std::min<int64_t>(next_header + 8, INT_MAX);
+    };
+
+    int outsize = 0;
+    unsigned char* output = d.DecompressFile((const unsigned int*)input, insize, outsize);
+    full_outsize = d.FullOutSize;
+    if (! output)
+    {
+        return false;
+    }
+
+    delete[] output;
+    return true;
 }
@@ -1,3 +1,40 @@
 #pragma once
+#include <cstdint>
+#include <vector>
 
-void UnpackGWDat(unsigned char* input, int insize, unsigned char*& output, int& outsize);
+// Reusable storage for decompression. UnpackGWDat keeps its Huffman tables in the context of the
+// calling thread, so only the output is allocated per file. Input and Output are there for callers
+// that want to reuse their read and decompression buffers as well, see GWDat::readFile.
+// Not thread safe, use one per thread.
+class GWDecompressContext
+{
+public:
+    std::vector<unsigned char> Input;
+    std::vector<unsigned char> Output;
+
+    static GWDecompressContext& ForCurrentThread();
+
+private:
+    friend class Decompress;
+
+    std::vector<unsigned int> Nodes;
+    std::vector<unsigned int> TreeValues[2];
+};
+
+void UnpackGWDat(const unsigned char* input, int insize, unsigned char*& output, int& outsize);
+
+// Decompresses into output, reusing its capacity. Returns false if the data is corrupt.
+bool UnpackGWDat(const unsigned char* input, int insize, std::vector<unsigned char>& output);
+
+// The original bit by bit decoder. Produces the same output as UnpackGWDat, kept for verification and
+// benchmarking.
+void UnpackGWDatReference(const unsigned char* input, int insize, unsigned char*& output, int& outsize);
+
+// Decompresses only the first max_output bytes. outsize receives the number of bytes produced
+// and full_outsize the size of the whole file.
+void UnpackGWDatPrefix(const unsigned char* input, int insize, int max_output, unsigned char*& output,
+                       int& outsize, int& full_outsize);
+
+// Decompresses an FFNA file only as far as its last chunk header and returns the chunk ids.
+bool UnpackGWDatFFNAChunkHeaders(const unsigned char* input, int insize, std::vector<uint32_t>& chunk_ids,
+                                 int& full_outsize);